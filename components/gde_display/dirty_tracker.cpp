@@ -0,0 +1,131 @@
+#include "dirty_tracker.h"
+
+#include <algorithm>
+
+namespace epd {
+namespace {
+
+DirtyArea join(const DirtyArea &a, const DirtyArea &b) {
+    DirtyArea joined;
+    joined.x1 = std::min(a.x1, b.x1);
+    joined.y1 = std::min(a.y1, b.y1);
+    joined.x2 = std::max(a.x2, b.x2);
+    joined.y2 = std::max(a.y2, b.y2);
+    return joined;
+}
+
+bool contains(const DirtyArea &outer, const DirtyArea &inner) {
+    return outer.x1 <= inner.x1 && outer.y1 <= inner.y1 && outer.x2 >= inner.x2 &&
+           outer.y2 >= inner.y2;
+}
+
+}  // namespace
+
+DirtyTracker::DirtyTracker(int32_t width, int32_t height, size_t window_overhead_bytes)
+    : width_(width),
+      height_(height),
+      window_overhead_(static_cast<int64_t>(window_overhead_bytes)) {}
+
+void DirtyTracker::clear() {
+    count_ = 0;
+    invalidated_pixels_ = 0;
+}
+
+int64_t DirtyTracker::pixels(const DirtyArea &area) {
+    if (area.x2 < area.x1 || area.y2 < area.y1) {
+        return 0;
+    }
+    return static_cast<int64_t>(area.x2 - area.x1 + 1) * (area.y2 - area.y1 + 1);
+}
+
+/** @brief Bytes of the 1bpp window covering @p area plus the cost of programming it. */
+int64_t DirtyTracker::cost(const DirtyArea &area) const {
+    return pixels(area) / 8 + window_overhead_;
+}
+
+DirtyArea DirtyTracker::add(const DirtyArea &area) {
+    DirtyArea clipped;
+    clipped.x1 = std::max(area.x1, 0);
+    clipped.y1 = std::max(area.y1, 0);
+    clipped.x2 = std::min(area.x2, width_ - 1);
+    clipped.y2 = std::min(area.y2, height_ - 1);
+    if (clipped.x2 < clipped.x1 || clipped.y2 < clipped.y1) {
+        return DirtyArea{};
+    }
+    invalidated_pixels_ += static_cast<uint64_t>(pixels(clipped));
+
+    DirtyArea snapped = clipped;
+    snapped.x1 &= ~7;
+    snapped.x2 = std::min(snapped.x2 | 7, width_ - 1);
+
+    for (size_t i = 0; i < count_; ++i) {
+        if (contains(areas_[i], snapped)) {
+            return areas_[i];
+        }
+    }
+
+    size_t index = count_;
+    if (count_ == kMaxAreas) {
+        // Out of slots: grow the area that takes the new one in for the fewest extra bytes.
+        int64_t best_growth = INT64_MAX;
+        for (size_t i = 0; i < count_; ++i) {
+            const int64_t growth = cost(join(areas_[i], snapped)) - cost(areas_[i]);
+            if (growth < best_growth) {
+                best_growth = growth;
+                index = i;
+            }
+        }
+        areas_[index] = join(areas_[index], snapped);
+    } else {
+        areas_[count_++] = snapped;
+    }
+    index = mergeInto(index);
+    return areas_[index];
+}
+
+size_t DirtyTracker::mergeInto(size_t index) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < count_; ++i) {
+            if (i == index) {
+                continue;
+            }
+            const DirtyArea joined = join(areas_[index], areas_[i]);
+            if (cost(joined) > cost(areas_[index]) + cost(areas_[i])) {
+                continue;
+            }
+            areas_[index] = joined;
+            remove(i);
+            if (index == count_) {
+                index = i;  // remove() moved it into the freed slot
+            }
+            merged = true;
+            break;
+        }
+    }
+    return index;
+}
+
+/** @brief Drop area @p index by moving the last area into its slot. */
+void DirtyTracker::remove(size_t index) {
+    areas_[index] = areas_[--count_];
+}
+
+uint64_t DirtyTracker::trackedPixels() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count_; ++i) {
+        total += static_cast<uint64_t>(pixels(areas_[i]));
+    }
+    return total;
+}
+
+uint64_t DirtyTracker::trackedCost() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < count_; ++i) {
+        total += static_cast<uint64_t>(cost(areas_[i]));
+    }
+    return total;
+}
+
+}  // namespace epd
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace epd {
+
+/** @brief Inclusive pixel rectangle, same convention as LVGL's lv_area_t. */
+struct DirtyArea {
+    int32_t x1 = 0;
+    int32_t y1 = 0;
+    int32_t x2 = -1;
+    int32_t y2 = -1;
+};
+
+/**
+ * @brief Collects the areas invalidated during one frame and merges them by upload cost.
+ *
+ * Areas are snapped to whole bytes of 1bpp pixels (8-pixel columns) and clipped to the screen.
+ * Two areas are merged when their bounding box costs no more bytes than uploading both plus the
+ * overhead of one more RAM window (kWindowOverheadBytes), so a handful of small label boxes
+ * stays a handful of windows while boxes on the same rows fold into one. The tracker never holds
+ * more than kMaxAreas; past that a new area joins the one it grows least.
+ */
+class DirtyTracker {
+  public:
+    static constexpr size_t kMaxAreas = 16;
+
+    DirtyTracker(int32_t width, int32_t height, size_t window_overhead_bytes);
+
+    /** @brief Start a new frame: forget the tracked areas and the pixel counters. */
+    void clear();
+
+    /**
+     * @brief Record @p area and return the tracked area that now covers it.
+     *
+     * The returned area may be larger than @p area when it was merged with earlier ones;
+     * an area entirely off screen comes back empty (x2 < x1).
+     */
+    DirtyArea add(const DirtyArea &area);
+
+    size_t count() const { return count_; }
+    const DirtyArea &area(size_t index) const { return areas_[index]; }
+
+    /** @brief Pixels passed to add() this frame, after clipping but before any merging. */
+    uint64_t invalidatedPixels() const { return invalidated_pixels_; }
+    /** @brief Pixels covered by the tracked areas, i.e. what the frame will redraw. */
+    uint64_t trackedPixels() const;
+    /** @brief Upload cost of the tracked areas in bytes, window overhead included. */
+    uint64_t trackedCost() const;
+
+    static int64_t pixels(const DirtyArea &area);
+
+  private:
+    int64_t cost(const DirtyArea &area) const;
+    /** @brief Fold area @p index into every other area it is worth merging with. */
+    size_t mergeInto(size_t index);
+    void remove(size_t index);
+
+    int32_t width_;
+    int32_t height_;
+    int64_t window_overhead_;
+    std::array<DirtyArea, kMaxAreas> areas_{};
+    size_t count_ = 0;
+    uint64_t invalidated_pixels_ = 0;
+};
+
+}  // namespace epd
@@ -0,0 +1,438 @@
+#include "display_service.h"
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+namespace epd {
+namespace {
+
+constexpr const char *TAG = "display_service";
+/** Poll interval while deinit() waits for the task to finish its queue. */
+constexpr TickType_t kStopPollTicks = pdMS_TO_TICKS(10);
+
+/** @brief Raise a high-water mark; only the producer writes it, so no CAS loop is needed. */
+void raiseMax(std::atomic<uint32_t> &mark, uint32_t value) {
+    if (value > mark.load(std::memory_order_relaxed)) {
+        mark.store(value, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace
+
+DisplayService::~DisplayService() {
+    deinit();
+}
+
+esp_err_t DisplayService::init(const ServiceConfig &config) {
+    ESP_RETURN_ON_FALSE(pool_ == nullptr, ESP_ERR_INVALID_STATE, TAG, "already initialised");
+    ESP_RETURN_ON_FALSE(config.buffer_count != 0 && config.buffer_count <= kMaxBuffers,
+                        ESP_ERR_INVALID_ARG, TAG, "buffer_count must be 1..%u",
+                        static_cast<unsigned>(kMaxBuffers));
+    ESP_RETURN_ON_FALSE(config.buffer_bytes != 0, ESP_ERR_INVALID_ARG, TAG, "empty buffers");
+
+    const size_t buffer_bytes =
+        (config.buffer_bytes + kDmaAlignment - 1) / kDmaAlignment * kDmaAlignment;
+    work_ = xSemaphoreCreateCounting(kCommandSlots, 0);
+    progress_ = xSemaphoreCreateBinary();
+    pool_ = static_cast<uint8_t *>(heap_caps_aligned_alloc(
+        kDmaAlignment, config.buffer_count * buffer_bytes, MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
+    if (work_ == nullptr || progress_ == nullptr || pool_ == nullptr) {
+        deinit();
+        ESP_LOGE(TAG, "out of memory for %u x %u byte buffers",
+                 static_cast<unsigned>(config.buffer_count),
+                 static_cast<unsigned>(config.buffer_bytes));
+        return ESP_ERR_NO_MEM;
+    }
+
+    cfg_ = config;
+    cfg_.buffer_bytes = buffer_bytes;
+    for (size_t i = 0; i < cfg_.buffer_count; ++i) {
+        free_buffers_.push(static_cast<uint8_t>(i));
+    }
+    return ESP_OK;
+}
+
+esp_err_t DisplayService::start() {
+    ESP_RETURN_ON_FALSE(pool_ != nullptr, ESP_ERR_INVALID_STATE, TAG, "service not initialised");
+    ESP_RETURN_ON_FALSE(task_ == nullptr, ESP_ERR_INVALID_STATE, TAG, "already running");
+    stop_requested_ = false;
+    task_exited_ = false;
+    if (xTaskCreate(&DisplayService::taskEntry, "display_svc", cfg_.task_stack_bytes, this,
+                    cfg_.task_priority, &task_) != pdPASS) {
+        task_ = nullptr;
+        ESP_LOGW(TAG, "no service task; the producer has to drain() commands itself");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return ESP_OK;
+}
+
+void DisplayService::deinit() {
+    if (task_ != nullptr) {
+        stop_requested_ = true;
+        xSemaphoreGive(work_);
+        while (!task_exited_) {
+            xSemaphoreTake(progress_, kStopPollTicks);
+        }
+        task_ = nullptr;
+    }
+
+    // Whatever is left refers to pool memory that is about to go away. Producers waiting on a
+    // strip still hear back, so they do not block forever.
+    Command command;
+    while (commands_.pop(command)) {
+        if (command.type == CommandType::kStrip && strip_done_ != nullptr) {
+            strip_done_(strip_ctx_);
+        }
+    }
+    uint8_t index;
+    while (free_buffers_.pop(index)) {
+    }
+    if (held_count_ > 0) {
+        driver_.abortFrame();
+    }
+    held_count_ = 0;
+    frame_failed_ = false;
+    buffers_in_use_ = 0;
+
+    if (work_ != nullptr) {
+        vSemaphoreDelete(work_);
+        work_ = nullptr;
+    }
+    if (progress_ != nullptr) {
+        vSemaphoreDelete(progress_);
+        progress_ = nullptr;
+    }
+    heap_caps_free(pool_);
+    pool_ = nullptr;
+}
+
+uint8_t *DisplayService::acquireBuffer(TickType_t timeout) {
+    if (pool_ == nullptr) {
+        return nullptr;
+    }
+
+    uint8_t index = 0;
+    if (!free_buffers_.pop(index)) {
+        ++buffer_waits_;
+        const int64_t started = esp_timer_get_time();
+        const TickType_t started_tick = xTaskGetTickCount();
+        bool found = false;
+        while (!found) {
+            if (!running()) {
+                // Every buffer is queued or staged; running the queue frees them.
+                if (runPending() == 0) {
+                    break;
+                }
+            } else {
+                const TickType_t waited = xTaskGetTickCount() - started_tick;
+                if (timeout != portMAX_DELAY && waited >= timeout) {
+                    break;
+                }
+                xSemaphoreTake(progress_, timeout == portMAX_DELAY ? portMAX_DELAY
+                                                                   : timeout - waited);
+            }
+            found = free_buffers_.pop(index);
+        }
+        producer_wait_us_ += esp_timer_get_time() - started;
+        if (!found) {
+            return nullptr;
+        }
+    }
+
+    raiseMax(max_buffers_in_use_, ++buffers_in_use_);
+    return pool_ + static_cast<size_t>(index) * cfg_.buffer_bytes;
+}
+
+int DisplayService::bufferIndex(const uint8_t *data) const {
+    if (pool_ == nullptr || data < pool_ ||
+        data >= pool_ + cfg_.buffer_count * cfg_.buffer_bytes) {
+        return -1;
+    }
+    return static_cast<int>(static_cast<size_t>(data - pool_) / cfg_.buffer_bytes);
+}
+
+esp_err_t DisplayService::releaseBuffer(uint8_t *buffer) {
+    const int index = bufferIndex(buffer);
+    ESP_RETURN_ON_FALSE(index >= 0, ESP_ERR_INVALID_ARG, TAG, "buffer not from the pool");
+    Command command;
+    command.type = CommandType::kRelease;
+    command.buffer = static_cast<uint8_t>(index);
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitRegion(const Region &region) {
+    const int index = bufferIndex(region.data);
+    ESP_RETURN_ON_FALSE(index >= 0, ESP_ERR_INVALID_ARG, TAG, "region data not from the pool");
+    Command command;
+    command.type = CommandType::kRegion;
+    command.buffer = static_cast<uint8_t>(index);
+    command.region = region;
+    return submit(command);
+}
+
+void DisplayService::setStripHandlers(StripConverter convert, StripDoneCallback done,
+                                      void *user_ctx) {
+    strip_convert_ = convert;
+    strip_done_ = done;
+    strip_ctx_ = user_ctx;
+}
+
+esp_err_t DisplayService::submitStrip(const Strip &strip, uint8_t *buffer) {
+    ESP_RETURN_ON_FALSE(strip_convert_ != nullptr, ESP_ERR_INVALID_STATE, TAG,
+                        "no strip converter");
+    const int index = bufferIndex(buffer);
+    ESP_RETURN_ON_FALSE(index >= 0, ESP_ERR_INVALID_ARG, TAG, "strip buffer not from the pool");
+    Command command;
+    command.type = CommandType::kStrip;
+    command.buffer = static_cast<uint8_t>(index);
+    command.strip = strip;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitCommit(RefreshMode mode) {
+    Command command;
+    command.type = CommandType::kCommit;
+    command.mode = mode;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitAbort() {
+    Command command;
+    command.type = CommandType::kAbort;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitGrayRegion(const Region &region) {
+    const int index = bufferIndex(region.data);
+    ESP_RETURN_ON_FALSE(index >= 0, ESP_ERR_INVALID_ARG, TAG, "region data not from the pool");
+    Command command;
+    command.type = CommandType::kGrayRegion;
+    command.buffer = static_cast<uint8_t>(index);
+    command.region = region;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitGrayRefresh() {
+    Command command;
+    command.type = CommandType::kGrayRefresh;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitCleaning() {
+    Command command;
+    command.type = CommandType::kCleaning;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitReadTemperature() {
+    Command command;
+    command.type = CommandType::kReadTemperature;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submitSleep() {
+    Command command;
+    command.type = CommandType::kSleep;
+    return submit(command);
+}
+
+esp_err_t DisplayService::submit(const Command &command) {
+    ESP_RETURN_ON_FALSE(pool_ != nullptr, ESP_ERR_INVALID_STATE, TAG, "service not initialised");
+
+    if (!commands_.push(command)) {
+        ++queue_full_waits_;
+        const int64_t started = esp_timer_get_time();
+        while (!commands_.push(command)) {
+            if (running()) {
+                xSemaphoreTake(progress_, portMAX_DELAY);
+            } else {
+                runPending();
+            }
+        }
+        producer_wait_us_ += esp_timer_get_time() - started;
+    }
+
+    ++submitted_;
+    raiseMax(max_queue_depth_, static_cast<uint32_t>(commands_.size()));
+    xSemaphoreGive(work_);
+    return ESP_OK;
+}
+
+size_t DisplayService::drain() {
+    if (pool_ == nullptr || running()) {
+        return 0;
+    }
+    return runPending();
+}
+
+ServiceStats DisplayService::stats() const {
+    ServiceStats stats;
+    stats.submitted = submitted_;
+    stats.executed = executed_;
+    stats.errors = errors_;
+    stats.last_error = last_error_;
+    stats.queue_full_waits = queue_full_waits_;
+    stats.buffer_waits = buffer_waits_;
+    stats.producer_wait_us = producer_wait_us_;
+    stats.dropped_regions = dropped_regions_;
+    stats.max_queue_depth = max_queue_depth_;
+    stats.max_buffers_in_use = max_buffers_in_use_;
+    stats.dma_bounce_transfers = dma_bounce_transfers_;
+    stats.partial_window_bytes = partial_window_bytes_;
+    stats.last_refresh_start_us = driver_.lastRefreshStartUs();
+    return stats;
+}
+
+void DisplayService::taskEntry(void *arg) {
+    auto *self = static_cast<DisplayService *>(arg);
+    while (!self->stop_requested_) {
+        xSemaphoreTake(self->work_, portMAX_DELAY);
+        self->runPending();
+    }
+    self->runPending();
+    self->task_exited_ = true;
+    xSemaphoreGive(self->progress_);
+    vTaskDelete(nullptr);
+}
+
+size_t DisplayService::runPending() {
+    size_t count = 0;
+    Command command;
+    while (commands_.pop(command)) {
+        const esp_err_t result = execute(command);
+        if (result != ESP_OK) {
+            ++errors_;
+            last_error_ = result;
+            ESP_LOGW(TAG, "command %u failed: %s", static_cast<unsigned>(command.type),
+                     esp_err_to_name(result));
+        }
+        const TransferStats &transfers = driver_.transferStats();
+        dma_bounce_transfers_ = transfers.dma_bounce_transfers;
+        partial_window_bytes_ = transfers.partial_window_bytes;
+        ++executed_;
+        ++count;
+        xSemaphoreGive(progress_);
+    }
+    return count;
+}
+
+/**
+ * @brief Stage one region, keeping its buffer until the frame is committed or aborted.
+ *
+ * A frame that would pin every buffer is flushed early so the producer can keep going. Once a
+ * region fails the rest of its frame is dropped, up to the next commit or abort.
+ */
+esp_err_t DisplayService::stageRegion(const Region &region, uint8_t buffer, bool stream) {
+    if (frame_failed_) {
+        ++dropped_regions_;
+        recycle(buffer);
+        return ESP_OK;
+    }
+    held_[held_count_++] = buffer;
+    esp_err_t result = driver_.frameOpen() ? ESP_OK : driver_.beginFrame();
+    if (result == ESP_OK) {
+        result = driver_.addRegion(region);
+    }
+    if (result == ESP_OK && held_count_ == cfg_.buffer_count) {
+        result = driver_.flushFrame();
+        if (result == ESP_OK) {
+            releaseHeld();
+        }
+    } else if (result == ESP_OK && stream) {
+        result = driver_.flushFrame(false);
+    }
+    if (result != ESP_OK) {
+        driver_.abortFrame();
+        releaseHeld();
+        frame_failed_ = true;
+    }
+    return result;
+}
+
+esp_err_t DisplayService::executeStrip(const Command &command) {
+    esp_err_t converted = ESP_OK;
+    Region region;
+    if (!frame_failed_) {
+        converted = strip_convert_(strip_ctx_, command.strip,
+                                   pool_ + command.buffer * cfg_.buffer_bytes, cfg_.buffer_bytes,
+                                   region);
+    }
+    if (strip_done_ != nullptr) {
+        strip_done_(strip_ctx_);
+    }
+    if (frame_failed_) {
+        ++dropped_regions_;
+        recycle(command.buffer);
+        return ESP_OK;
+    }
+    if (converted != ESP_OK) {
+        recycle(command.buffer);
+        driver_.abortFrame();
+        releaseHeld();
+        frame_failed_ = true;
+        return converted;
+    }
+    return stageRegion(region, command.buffer, true);
+}
+
+/** @brief Run one command against the driver. */
+esp_err_t DisplayService::execute(const Command &command) {
+    esp_err_t result = ESP_OK;
+    switch (command.type) {
+        case CommandType::kRegion:
+            return stageRegion(command.region, command.buffer, false);
+        case CommandType::kStrip:
+            return executeStrip(command);
+        case CommandType::kCommit:
+            if (driver_.frameOpen()) {
+                result = driver_.commitFrame(command.mode, true);
+                if (result != ESP_OK) {
+                    driver_.abortFrame();
+                }
+            }
+            releaseHeld();
+            frame_failed_ = false;
+            return result;
+        case CommandType::kAbort:
+            driver_.abortFrame();
+            releaseHeld();
+            frame_failed_ = false;
+            return ESP_OK;
+        case CommandType::kGrayRegion:
+            result = driver_.writeGrayRegion(command.region);
+            recycle(command.buffer);
+            return result;
+        case CommandType::kGrayRefresh:
+            return driver_.refreshGray(true);
+        case CommandType::kCleaning:
+            return driver_.runCleaning();
+        case CommandType::kReadTemperature: {
+            int celsius = 0;
+            ESP_RETURN_ON_ERROR(driver_.readTemperature(celsius), TAG, "temperature read failed");
+            temperature_.store(celsius, std::memory_order_relaxed);
+            return ESP_OK;
+        }
+        case CommandType::kSleep:
+            return driver_.deepSleep();
+        case CommandType::kRelease:
+            recycle(command.buffer);
+            return ESP_OK;
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+void DisplayService::recycle(uint8_t index) {
+    --buffers_in_use_;
+    free_buffers_.push(index);
+}
+
+void DisplayService::releaseHeld() {
+    for (size_t i = 0; i < held_count_; ++i) {
+        recycle(held_[i]);
+    }
+    held_count_ = 0;
+}
+
+}  // namespace epd
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "epd_driver.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "spsc_ring.h"
+
+namespace epd {
+
+/** @brief Sizing of the region buffer pool and the service task. */
+struct ServiceConfig {
+    /** @brief Pooled region buffers; a frame may hold all of them until it is committed. */
+    size_t buffer_count = 8;
+    /**
+     * @brief Bytes per buffer; the default fits a 32-line 1bpp strip of the full RAM width.
+     *
+     * Rounded up to kDmaAlignment so every buffer starts where spi_master can DMA in place.
+     */
+    size_t buffer_bytes = kRamColumns * 32 / 8;
+    UBaseType_t task_priority = 5;
+    uint32_t task_stack_bytes = 4096;
+};
+
+/** @brief Producer back-pressure and worker counters, read with DisplayService::stats(). */
+struct ServiceStats {
+    uint32_t submitted = 0;
+    uint32_t executed = 0;
+    uint32_t errors = 0;
+    esp_err_t last_error = ESP_OK;
+    /** @brief Times the producer found the command ring full, or no buffer free, and waited. */
+    uint32_t queue_full_waits = 0;
+    uint32_t buffer_waits = 0;
+    /** @brief Total time the producer spent blocked on either of the above. */
+    int64_t producer_wait_us = 0;
+    /** @brief Regions dropped because an earlier region of the same frame failed. */
+    uint32_t dropped_regions = 0;
+    uint32_t max_queue_depth = 0;
+    uint32_t max_buffers_in_use = 0;
+    /** @brief Driver transfers bounced through a temporary DMA buffer (TransferStats copy). */
+    uint32_t dma_bounce_transfers = 0;
+    /** @brief Pixel bytes the driver wrote to RAM 0x24 through partial windows (TransferStats). */
+    uint64_t partial_window_bytes = 0;
+    /** @brief esp_timer time the panel last started a refresh (Driver::lastRefreshStartUs). */
+    int64_t last_refresh_start_us = 0;
+};
+
+/**
+ * @brief A rendered strip handed to the service unconverted; the producer owns the pixels.
+ *
+ * The coordinates are the producer's own; only the StripConverter interprets them.
+ */
+struct Strip {
+    const uint8_t *pixels = nullptr;
+    uint32_t stride = 0;  ///< Bytes between source rows.
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t width = 0;
+    int32_t height = 0;
+};
+
+/**
+ * @brief Convert @p strip into @p buffer (@p buffer_bytes long) and describe it in @p region.
+ *
+ * Runs on the service task, so it may overlap the DMA of the previous strip.
+ */
+using StripConverter = esp_err_t (*)(void *user_ctx, const Strip &strip, uint8_t *buffer,
+                                     size_t buffer_bytes, Region &region);
+/** @brief Invoked on the service task once a strip's source pixels are no longer read. */
+using StripDoneCallback = void (*)(void *user_ctx);
+
+/**
+ * @brief Owns a Driver on a dedicated task fed through a lock-free command ring.
+ *
+ * One producer (normally the UI task) copies pixels into pooled buffers and queues uploads,
+ * commits and maintenance commands; it never waits on SPI or BUSY, only on a full ring or an
+ * empty pool. The service task is the sole user of the driver after start() returns, so the
+ * producer must not call the driver directly from then on.
+ *
+ * Without a task (start() failed, e.g. on the host build) the producer runs queued commands
+ * itself with drain(), and does so implicitly whenever it would otherwise block.
+ */
+class DisplayService {
+  public:
+    /** @brief Command ring size; the producer waits once kCommandSlots - 1 are pending. */
+    static constexpr size_t kCommandSlots = 32;
+    static constexpr size_t kMaxBuffers = 31;
+
+    explicit DisplayService(Driver &driver) : driver_(driver) {}
+    /** @brief Automatically calls deinit(). */
+    ~DisplayService();
+
+    /** @brief Allocate the DMA-capable buffer pool and the semaphores. */
+    esp_err_t init(const ServiceConfig &config = {});
+    /** @brief Spawn the service task; ESP_ERR_NOT_SUPPORTED where tasks cannot be created. */
+    esp_err_t start();
+    /** @brief Stop the task after it finishes queued commands, then free the pool. */
+    void deinit();
+
+    /**
+     * @brief Take a free buffer of bufferBytes() bytes, or nullptr after @p timeout.
+     *
+     * The buffer returns to the pool once the command it is submitted with has been executed.
+     */
+    uint8_t *acquireBuffer(TickType_t timeout = portMAX_DELAY);
+    /**
+     * @brief Hand back a buffer from acquireBuffer() that will not be submitted.
+     *
+     * Only the service side pushes free buffers, so the index is queued and returned to the pool
+     * in order with the commands before it.
+     */
+    esp_err_t releaseBuffer(uint8_t *buffer);
+    size_t bufferBytes() const { return cfg_.buffer_bytes; }
+
+    /** @brief Install the strip handlers used by submitStrip(); call before start(). */
+    void setStripHandlers(StripConverter convert, StripDoneCallback done, void *user_ctx);
+    /**
+     * @brief Queue @p strip to be converted into @p buffer (from acquireBuffer()) by the service.
+     *
+     * The converted region is uploaded straight away without waiting for the DMA, so the next
+     * strip is converted while this one is still on the bus. The done callback fires for every
+     * submitted strip, including ones that fail or are dropped.
+     */
+    esp_err_t submitStrip(const Strip &strip, uint8_t *buffer);
+    /**
+     * @brief Queue a 1bpp region for the current frame (see Driver::addRegion).
+     *
+     * Region::data must point into a buffer from acquireBuffer(); the frame is opened on demand.
+     */
+    esp_err_t submitRegion(const Region &region);
+    /** @brief Queue Driver::commitFrame(); the service waits for the refresh, not the caller. */
+    esp_err_t submitCommit(RefreshMode mode = RefreshMode::kPartial);
+    /** @brief Queue Driver::abortFrame() and release the frame's buffers. */
+    esp_err_t submitAbort();
+    /** @brief Queue a 2bpp region for Driver::writeGrayRegion(); data as for submitRegion(). */
+    esp_err_t submitGrayRegion(const Region &region);
+    /** @brief Queue Driver::refreshGray(). */
+    esp_err_t submitGrayRefresh();
+    /** @brief Queue Driver::runCleaning(); a no-op when no tile is due. */
+    esp_err_t submitCleaning();
+    /** @brief Queue Driver::readTemperature(); the result appears in temperature(). */
+    esp_err_t submitReadTemperature();
+    /** @brief Queue Driver::deepSleep(). */
+    esp_err_t submitSleep();
+
+    /**
+     * @brief Execute every queued command on the calling thread.
+     *
+     * Only for use while no service task runs; returns the number of commands executed.
+     */
+    size_t drain();
+    /** @brief True once start() has created the service task. */
+    bool running() const { return task_ != nullptr; }
+    /** @brief Last temperature read by the service, or Driver::kTemperatureUnknown. */
+    int temperature() const { return temperature_.load(std::memory_order_relaxed); }
+    /** @brief Snapshot of the counters; safe to call from the producer. */
+    ServiceStats stats() const;
+
+  private:
+    enum class CommandType : uint8_t {
+        kRegion,
+        kStrip,
+        kCommit,
+        kAbort,
+        kGrayRegion,
+        kGrayRefresh,
+        kCleaning,
+        kReadTemperature,
+        kSleep,
+        kRelease,
+    };
+
+    struct Command {
+        CommandType type{CommandType::kAbort};
+        RefreshMode mode{RefreshMode::kPartial};
+        uint8_t buffer{0};
+        Region region{};
+        Strip strip{};
+    };
+
+    Driver &driver_;
+    ServiceConfig cfg_{};
+    uint8_t *pool_{nullptr};
+    SpscRing<Command, kCommandSlots> commands_{};
+    /** @brief Free buffer indices, pushed by the consumer and popped by the producer. */
+    SpscRing<uint8_t, kMaxBuffers + 1> free_buffers_{};
+    SemaphoreHandle_t work_{nullptr};
+    SemaphoreHandle_t progress_{nullptr};
+    TaskHandle_t task_{nullptr};
+    std::atomic<bool> stop_requested_{false};
+    std::atomic<bool> task_exited_{false};
+
+    /** @brief Consumer-only: buffers staged in the open driver frame. */
+    std::array<uint8_t, kMaxBuffers> held_{};
+    size_t held_count_{0};
+    bool frame_failed_{false};
+    StripConverter strip_convert_{nullptr};
+    StripDoneCallback strip_done_{nullptr};
+    void *strip_ctx_{nullptr};
+
+    std::atomic<int> temperature_{Driver::kTemperatureUnknown};
+    std::atomic<uint32_t> submitted_{0};
+    std::atomic<uint32_t> executed_{0};
+    std::atomic<uint32_t> errors_{0};
+    std::atomic<esp_err_t> last_error_{ESP_OK};
+    std::atomic<uint32_t> queue_full_waits_{0};
+    std::atomic<uint32_t> buffer_waits_{0};
+    std::atomic<int64_t> producer_wait_us_{0};
+    std::atomic<uint32_t> dropped_regions_{0};
+    std::atomic<uint32_t> max_queue_depth_{0};
+    std::atomic<uint32_t> max_buffers_in_use_{0};
+    std::atomic<uint32_t> dma_bounce_transfers_{0};
+    std::atomic<uint64_t> partial_window_bytes_{0};
+    std::atomic<uint32_t> buffers_in_use_{0};
+
+    static void taskEntry(void *arg);
+    /** @brief Producer side: queue @p command, waiting (or draining) while the ring is full. */
+    esp_err_t submit(const Command &command);
+    /** @brief Pool index of @p data, or -1 when it does not point into the pool. */
+    int bufferIndex(const uint8_t *data) const;
+    /** @brief Consumer side: pop and run commands until the ring is empty. */
+    size_t runPending();
+    esp_err_t execute(const Command &command);
+    /** @brief Consumer side: convert a strip, then stage and stream the result. */
+    esp_err_t executeStrip(const Command &command);
+    /**
+     * @brief Consumer side: stage @p region (backed by pool buffer @p buffer) in the open frame.
+     *
+     * With @p stream the region is queued for upload at once instead of at commit.
+     */
+    esp_err_t stageRegion(const Region &region, uint8_t buffer, bool stream);
+    /** @brief Consumer side: hand a buffer back to the producer. */
+    void recycle(uint8_t index);
+    /** @brief Consumer side: recycle every buffer the open frame was holding. */
+    void releaseHeld();
+};
+
+}  // namespace epd
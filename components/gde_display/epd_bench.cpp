@@ -0,0 +1,227 @@
+#include "epd_bench.h"
+
+#include <array>
+#include <cstring>
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+namespace epd::bench {
+namespace {
+
+constexpr const char *TAG = "epd_bench";
+constexpr std::array<size_t, 5> kChunkSizes = {1024, 2048, 4096, 8192, 16384};
+constexpr uint16_t kStripRows = 32;
+constexpr uint16_t kStripWidthBits = kHeight;
+constexpr size_t kStripBytes = static_cast<size_t>(kStripWidthBits) * kStripRows / 8;
+
+/** @brief Blocked time recorded by the driver, used to derive CPU-busy time. */
+int64_t blockedUs(const TransferStats &stats) {
+    return stats.queue_wait_us + stats.busy_wait_us;
+}
+
+/** @brief Time a full base-map upload including its refresh. */
+esp_err_t measureBaseMap(Driver &driver, const uint8_t *frame, UploadSample &sample) {
+    driver.resetTransferStats();
+    const int64_t started = esp_timer_get_time();
+    ESP_RETURN_ON_ERROR(driver.loadBaseMap(frame, true), TAG, "loadBaseMap failed");
+    sample.return_us = esp_timer_get_time() - started;
+    sample.wall_us = sample.return_us;
+    sample.cpu_busy_us = sample.wall_us - blockedUs(driver.transferStats());
+    return ESP_OK;
+}
+
+/** @brief Time a full frame streamed as LVGL-sized strips without refreshing. */
+esp_err_t measureStrips(Driver &driver, const uint8_t *frame, UploadSample &sample) {
+    driver.resetTransferStats();
+    const int64_t started = esp_timer_get_time();
+    for (uint16_t y = 0; y < kWidth; y += kStripRows) {
+        const uint8_t *strip = frame + static_cast<size_t>(y / kStripRows) * kStripBytes;
+        ESP_RETURN_ON_ERROR(driver.drawBitmap(0, y, strip, kStripWidthBits, kStripRows, true), TAG,
+                            "drawBitmap failed");
+    }
+    sample.return_us = esp_timer_get_time() - started;
+    // Once the calls return, the remaining transfer time is free for the caller.
+    sample.cpu_busy_us = sample.return_us - blockedUs(driver.transferStats());
+    ESP_RETURN_ON_ERROR(driver.waitUploadDone(), TAG, "drain failed");
+    sample.wall_us = esp_timer_get_time() - started;
+    return ESP_OK;
+}
+
+/** @brief Restart the driver with @p config and run the panel init sequence. */
+esp_err_t reinit(Driver &driver, const Config &config) {
+    driver.deinit();
+    ESP_RETURN_ON_ERROR(driver.init(config), TAG, "init failed");
+    return driver.hardwareInit(true);
+}
+
+/** @brief Emit one row of the 1-bit vs gray comparison. */
+void logGrayRow(const char *mode, int64_t wall_us, const TransferStats &stats) {
+    const int64_t upload_us = wall_us - stats.busy_wait_us;
+    ESP_LOGI(TAG, "%-6s %9lld %9lld %8llu %10lld", mode,
+             static_cast<long long>(stats.gray_split_us), static_cast<long long>(upload_us),
+             static_cast<unsigned long long>(stats.data_bytes),
+             static_cast<long long>(stats.busy_wait_us));
+}
+
+/** @brief Emit one result row in a fixed-width layout. */
+void logSample(const char *scenario, const UploadSample &sample) {
+    ESP_LOGI(TAG, "%-10s %6u %-6s %9lld %9lld %9lld", scenario,
+             static_cast<unsigned>(sample.chunk_bytes), sample.async_upload ? "queued" : "polled",
+             static_cast<long long>(sample.wall_us), static_cast<long long>(sample.cpu_busy_us),
+             static_cast<long long>(sample.return_us));
+}
+
+}  // namespace
+
+esp_err_t runUploadBenchmark(Driver &driver, const Config &base_config, const uint8_t *frame) {
+    ESP_RETURN_ON_FALSE(frame != nullptr, ESP_ERR_INVALID_ARG, TAG, "frame null");
+
+    // Source from DMA-capable RAM so the SPI driver does not bounce-copy flash data.
+    auto *dma_frame = static_cast<uint8_t *>(heap_caps_malloc(kBufferSize, MALLOC_CAP_DMA));
+    const uint8_t *source = frame;
+    if (dma_frame != nullptr) {
+        std::memcpy(dma_frame, frame, kBufferSize);
+        source = dma_frame;
+    } else {
+        ESP_LOGW(TAG, "no DMA-capable RAM for test frame, using caller buffer");
+    }
+
+    ESP_LOGI(TAG, "%-10s %6s %-6s %9s %9s %9s", "scenario", "chunk", "mode", "wall_us",
+             "busy_us", "return_us");
+
+    esp_err_t result = ESP_OK;
+    for (size_t chunk : kChunkSizes) {
+        for (bool async_upload : {false, true}) {
+            Config config = base_config;
+            config.transfer_chunk_bytes = chunk;
+            config.async_upload = async_upload;
+            config.shadow_framebuffer = false;
+            result = reinit(driver, config);
+
+            UploadSample sample;
+            sample.chunk_bytes = chunk;
+            sample.async_upload = async_upload;
+            if (result == ESP_OK) {
+                result = measureBaseMap(driver, source, sample);
+            }
+            if (result == ESP_OK) {
+                logSample("loadBaseMap", sample);
+                result = measureStrips(driver, source, sample);
+            }
+            if (result == ESP_OK) {
+                logSample("drawBitmap", sample);
+            }
+            if (result != ESP_OK) {
+                break;
+            }
+        }
+        if (result != ESP_OK) {
+            break;
+        }
+    }
+
+    driver.deinit();
+    const esp_err_t restore = driver.init(base_config);
+    heap_caps_free(dma_frame);
+    ESP_RETURN_ON_ERROR(result, TAG, "benchmark aborted");
+    return restore;
+}
+
+esp_err_t runPartialSessionBenchmark(Driver &driver, const Config &base_config,
+                                     const uint8_t *frame) {
+    ESP_RETURN_ON_FALSE(frame != nullptr, ESP_ERR_INVALID_ARG, TAG, "frame null");
+
+    ESP_LOGI(TAG, "%-8s %7s %9s %9s %6s", "session", "strips", "strip_us", "frame_us",
+             "resets");
+
+    esp_err_t result = ESP_OK;
+    for (bool session : {false, true}) {
+        Config config = base_config;
+        config.partial_session = session;
+        config.shadow_framebuffer = false;
+        result = reinit(driver, config);
+        if (result != ESP_OK) {
+            break;
+        }
+
+        driver.resetTransferStats();
+        const int64_t started = esp_timer_get_time();
+        for (uint16_t y = 0; y < kWidth && result == ESP_OK; y += kStripRows) {
+            const uint8_t *strip = frame + static_cast<size_t>(y / kStripRows) * kStripBytes;
+            result = driver.drawBitmap(0, y, strip, kStripWidthBits, kStripRows, true);
+        }
+        if (result == ESP_OK) {
+            result = driver.waitUploadDone();
+        }
+        if (result != ESP_OK) {
+            break;
+        }
+        const int64_t frame_us = esp_timer_get_time() - started;
+
+        const TransferStats &stats = driver.transferStats();
+        const int64_t strip_us =
+            stats.partial_windows > 0 ? stats.partial_window_us / stats.partial_windows : 0;
+        ESP_LOGI(TAG, "%-8s %7u %9lld %9lld %6u", session ? "on" : "off",
+                 static_cast<unsigned>(stats.partial_windows), static_cast<long long>(strip_us),
+                 static_cast<long long>(frame_us), static_cast<unsigned>(stats.controller_resets));
+    }
+
+    driver.deinit();
+    const esp_err_t restore = driver.init(base_config);
+    ESP_RETURN_ON_ERROR(result, TAG, "benchmark aborted");
+    return restore;
+}
+
+esp_err_t runGrayBenchmark(Driver &driver, const Config &base_config, const uint8_t *frame) {
+    ESP_RETURN_ON_FALSE(frame != nullptr, ESP_ERR_INVALID_ARG, TAG, "frame null");
+    auto *gray = static_cast<uint8_t *>(heap_caps_malloc(kGrayBufferSize, MALLOC_CAP_8BIT));
+    ESP_RETURN_ON_FALSE(gray != nullptr, ESP_ERR_NO_MEM, TAG, "gray test image alloc failed");
+    // Four equal bands along the RAM x axis: black, dark gray, light gray, white.
+    constexpr size_t kGrayRowBytes = kRamColumns / 4;
+    for (size_t row = 0; row < kRamRows; ++row) {
+        for (size_t i = 0; i < kGrayRowBytes; ++i) {
+            gray[row * kGrayRowBytes + i] = static_cast<uint8_t>(0x55 * (4 * i / kGrayRowBytes));
+        }
+    }
+
+    ESP_LOGI(TAG, "%-6s %9s %9s %8s %10s", "mode", "split_us", "upload_us", "bytes",
+             "refresh_us");
+
+    Config config = base_config;
+    config.shadow_framebuffer = false;
+    esp_err_t result = reinit(driver, config);
+    if (result == ESP_OK) {
+        driver.resetTransferStats();
+        const int64_t started = esp_timer_get_time();
+        result = driver.loadBaseMap(frame, false);
+        if (result == ESP_OK) {
+            logGrayRow("1-bit", esp_timer_get_time() - started, driver.transferStats());
+        }
+    }
+    if (result == ESP_OK) {
+        Region region;
+        region.width = kRamColumns;
+        region.height = kRamRows;
+        region.data = gray;
+        driver.resetTransferStats();
+        const int64_t started = esp_timer_get_time();
+        result = driver.writeGrayRegion(region);
+        if (result == ESP_OK) {
+            result = driver.refreshGray();
+        }
+        if (result == ESP_OK) {
+            logGrayRow("gray4", esp_timer_get_time() - started, driver.transferStats());
+        }
+    }
+
+    driver.deinit();
+    const esp_err_t restore = driver.init(base_config);
+    heap_caps_free(gray);
+    ESP_RETURN_ON_ERROR(result, TAG, "benchmark aborted");
+    return restore;
+}
+
+}  // namespace epd::bench
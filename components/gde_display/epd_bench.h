@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "epd_driver.h"
+#include "esp_err.h"
+
+namespace epd::bench {
+
+/** @brief Timing of one upload scenario for a given transfer configuration. */
+struct UploadSample {
+    size_t chunk_bytes = 0;
+    bool async_upload = false;
+    /** @brief Time from the first call until every byte has left the SPI peripheral. */
+    int64_t wall_us = 0;
+    /** @brief Wall time minus the time the caller spent blocked on queue or BUSY waits. */
+    int64_t cpu_busy_us = 0;
+    /** @brief Time until the API call returned control to the caller. */
+    int64_t return_us = 0;
+};
+
+/**
+ * @brief Compare polled and queued uploads across several chunk sizes.
+ *
+ * Re-initialises @p driver for every configuration, runs loadBaseMap() and a full-frame sequence
+ * of drawBitmap() strips, logs a table and finally restores @p base_config.
+ *
+ * @param frame kBufferSize bytes used as the test image.
+ */
+esp_err_t runUploadBenchmark(Driver &driver, const Config &base_config, const uint8_t *frame);
+
+/**
+ * @brief Compare per-window controller resets against a persistent partial session.
+ *
+ * Streams one frame of LVGL-sized strips with Config::partial_session off and on, logging the
+ * per-strip and per-frame upload latency and the number of resets, then restores
+ * @p base_config.
+ */
+esp_err_t runPartialSessionBenchmark(Driver &driver, const Config &base_config,
+                                     const uint8_t *frame);
+
+/**
+ * @brief Compare a 1-bit full update with a 4-gray update of the same panel area.
+ *
+ * Times loadBaseMap() of @p frame against writeGrayRegion() + refreshGray() of a four-band
+ * gray test image, logging plane-split time, upload time and bytes, and refresh (BUSY) time,
+ * then restores @p base_config.
+ */
+esp_err_t runGrayBenchmark(Driver &driver, const Config &base_config, const uint8_t *frame);
+
+}  // namespace epd::bench
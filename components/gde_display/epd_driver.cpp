@@ -2,10 +2,16 @@
 
 #include <algorithm>
 #include <array>
+#include <bitset>
 #include <cstring>
 
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+
+#include "esp_attr.h"
 #include "esp_check.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -14,12 +20,89 @@ namespace {
 
 constexpr const char *TAG = "epd_driver";
 constexpr size_t kSpiMaxChunkBytes = 4096;
+constexpr size_t kSpiMaxTransferBytes = kBufferSize + 16;
+/**
+ * Registers whose payload is plain state and can be skipped when rewritten unchanged. RAM writes,
+ * address counters (0x4E/0x4F, which auto-increment) and activation commands are never cached.
+ */
+constexpr std::array<uint8_t, 12> kShadowedRegisters = {
+    0x01, 0x03, 0x04, 0x0C, 0x11, 0x18, 0x1A, 0x22, 0x2C, 0x3C, 0x44, 0x45,
+};
+/**
+ * @brief Length of the next transfer of @p data that spi_master can send without a bounce.
+ *
+ * Word-aligned runs go out whole, up to @p max_chunk (a multiple of kDmaAlignment). The
+ * unaligned head and tail come back as runs of at most kDmaAlignment bytes, short enough for
+ * the transaction's own tx_data.
+ */
+size_t dmaChunk(const uint8_t *data, size_t len, size_t max_chunk) {
+    const size_t misalign = reinterpret_cast<uintptr_t>(data) % kDmaAlignment;
+    if (misalign != 0) {
+        return std::min(len, kDmaAlignment - misalign);
+    }
+    const size_t chunk = std::min(len, max_chunk);
+    return chunk <= kDmaAlignment ? chunk : chunk - chunk % kDmaAlignment;
+}
+
+/** @brief True when spi_master would copy @p data into a temporary DMA buffer to send it. */
+bool needsBounce(const uint8_t *data, size_t len) {
+    return !esp_ptr_dma_capable(data) ||
+           ((reinterpret_cast<uintptr_t>(data) | len) % kDmaAlignment) != 0;
+}
+
+/** 0x22 bit that makes the next activation latch the sensor into the 0x1A register. */
+constexpr uint8_t kUpdateLoadsTemperature = 0x20;
+/** 0x22 bit that makes the next activation reload the LUT from OTP. */
+constexpr uint8_t kUpdateLoadsLut = 0x10;
+/** 0x22 bit selecting display mode 2, which only drives pixels where 0x24 and 0x26 differ. */
+constexpr uint8_t kUpdateDisplayMode2 = 0x08;
+
+/** Upper bound on a single semaphore wait, so a missed BUSY edge only costs one slice. */
+constexpr TickType_t kBusyWaitSlice = pdMS_TO_TICKS(100);
 
 /** @brief Validate that the supplied GPIO number is inside the supported range. */
 bool gpioIsValid(gpio_num_t gpio) {
     return gpio >= 0 && gpio < GPIO_NUM_MAX;
 }
 
+/** @brief Bytes per row of the shadow framebuffer, i.e. of controller RAM. */
+constexpr size_t kRamStride = kRamColumns / 8;
+
+/** @brief Unaligned 32-bit load used by the word-at-a-time diff. */
+uint32_t load32(const uint8_t *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Find the first and last differing byte of two rows, comparing four bytes at a time.
+ *
+ * @return false when the rows are identical.
+ */
+bool changedSpan(const uint8_t *a, const uint8_t *b, size_t n, size_t &first, size_t &last) {
+    size_t i = 0;
+    while (i + 4 <= n && load32(a + i) == load32(b + i)) {
+        i += 4;
+    }
+    while (i < n && a[i] == b[i]) {
+        ++i;
+    }
+    if (i == n) {
+        return false;
+    }
+    size_t j = n;
+    while (j >= i + 4 && load32(a + j - 4) == load32(b + j - 4)) {
+        j -= 4;
+    }
+    while (j > i && a[j - 1] == b[j - 1]) {
+        --j;
+    }
+    first = i;
+    last = j - 1;
+    return true;
+}
+
 /** @brief Helper that returns a bit mask for the given GPIO pin. */
 uint64_t maskFor(gpio_num_t gpio) {
     return 1ULL << static_cast<uint32_t>(gpio);
@@ -45,8 +128,78 @@ constexpr std::array<uint8_t, 112> kWaveform80_127 = {
     0x00, 0x00, 0x01, 0x01, 0x22, 0x22, 0x22, 0x22, 0x22, 0x17, 0x41, 0xA8, 0x32, 0x30, 0x00, 0x00,
 };
 
+/**
+ * Four-gray waveform. The RAM bits select the LUT: (0x26, 0x24) = 00 black, 01 dark gray,
+ * 10 light gray, 11 white. Group 0 drives every pixel dark and then fully white; group 1 then
+ * darkens by three, two, one or zero VSH1 phases.
+ */
+constexpr std::array<uint8_t, 112> kWaveformGray4 = {
+    0x60, 0x54, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x50, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x60, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x20, 0x20, 0x00, 0x00, 0x00, 0x0B, 0x0B, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x17, 0x41, 0xA8, 0x32, 0x48, 0x00, 0x00,
+};
+
+/** Bytes of each row_staging_ half: a band of full RAM rows, word aligned for DMA. */
+constexpr size_t kRowStagingBytes = 24 * kRamStride;
+static_assert(kRowStagingBytes % kDmaAlignment == 0, "staging halves must stay word aligned");
+/** Rows of one plane converted per writeGrayRegion() chunk, at most kGrayChunkBytes each. */
+constexpr size_t kGrayChunkBytes = 1600;
+
+/**
+ * Byte of four 2bpp pixels -> nibble of their low bits (bits 3..0) and nibble of their high
+ * bits (bits 7..4), both MSB first.
+ */
+constexpr std::array<uint8_t, 256> makeGraySplitTable() {
+    std::array<uint8_t, 256> table{};
+    for (size_t value = 0; value < table.size(); ++value) {
+        uint8_t low = 0;
+        uint8_t high = 0;
+        for (int pixel = 0; pixel < 4; ++pixel) {
+            const unsigned level = (value >> (6 - 2 * pixel)) & 0x03;
+            low = static_cast<uint8_t>((low << 1) | (level & 0x01));
+            high = static_cast<uint8_t>((high << 1) | (level >> 1));
+        }
+        table[value] = static_cast<uint8_t>((high << 4) | low);
+    }
+    return table;
+}
+constexpr std::array<uint8_t, 256> kGraySplit = makeGraySplitTable();
+
+/** Register waveforms characterised for one panel temperature range; nullptr means OTP. */
+struct WaveformBand {
+    int min_celsius;
+    const uint8_t *normal;
+    const uint8_t *fast;
+};
+
+/**
+ * Bands in ascending order. Below 20 °C neither register waveform is rated, so full refreshes
+ * fall back to the controller's OTP table, which it compensates for the written temperature.
+ */
+constexpr std::array<WaveformBand, 3> kWaveformBands = {{
+    {-40, nullptr, nullptr},
+    {20, kWaveform20_80.data(), kWaveform80_127.data()},
+    {80, kWaveform80_127.data(), kWaveform80_127.data()},
+}};
+/** Margin a reading must cross a band edge by before the selection moves to that band. */
+constexpr int kBandHysteresisCelsius = 2;
+
 }  // namespace
 
+/** @brief Two table lookups per output byte: each 2bpp input byte yields one nibble per plane. */
+void splitGrayPlanes(const uint8_t *gray, size_t pixels, uint8_t *plane24, uint8_t *plane26) {
+    for (size_t i = 0; i < pixels / 8; ++i) {
+        const uint8_t first = kGraySplit[gray[2 * i]];
+        const uint8_t second = kGraySplit[gray[2 * i + 1]];
+        plane24[i] = static_cast<uint8_t>((first << 4) | (second & 0x0F));
+        plane26[i] = static_cast<uint8_t>((first & 0xF0) | (second >> 4));
+    }
+}
+
 /** @brief Ensure underlying resources are released when the driver is destroyed. */
 Driver::~Driver() {
     deinit();
@@ -68,6 +221,68 @@ esp_err_t Driver::init(const Config &config) {
     if (cfg_.clk_speed_hz <= 0) {
         cfg_.clk_speed_hz = 10 * 1000 * 1000;
     }
+    if (cfg_.transfer_chunk_bytes == 0) {
+        cfg_.transfer_chunk_bytes = kSpiMaxChunkBytes;
+    }
+    cfg_.transfer_chunk_bytes = std::min(cfg_.transfer_chunk_bytes, kSpiMaxTransferBytes);
+    cfg_.transfer_chunk_bytes = std::max(cfg_.transfer_chunk_bytes / kDmaAlignment, size_t{1}) *
+                                kDmaAlignment;
+
+    for (TransferSlot &slot : slots_) {
+        slot = {};
+        slot.owner = this;
+    }
+    polling_slot_ = {};
+    polling_slot_.owner = this;
+    static_assert(kShadowedRegisters.size() == kShadowedRegisterCount);
+    for (size_t i = 0; i < shadow_.size(); ++i) {
+        shadow_[i] = {};
+        shadow_[i].cmd = kShadowedRegisters[i];
+    }
+    lut_shadow_valid_ = false;
+    next_slot_ = 0;
+    in_flight_ = 0;
+    stats_ = {};
+
+    const esp_err_t err = acquireResources();
+    if (err != ESP_OK) {
+        releaseResources();  // nothing may outlive a failed init(), least of all the BUSY ISR
+        return err;
+    }
+
+    initialised_ = true;
+    ESP_LOGI(TAG, "initialised, SPI clock %d Hz, %u-byte chunks, %s uploads", cfg_.clk_speed_hz,
+             static_cast<unsigned>(cfg_.transfer_chunk_bytes),
+             cfg_.async_upload ? "queued" : "polled");
+    return ESP_OK;
+}
+
+/** @brief Tear down SPI resources and mark the driver as uninitialised. */
+void Driver::deinit() {
+    if (initialised_ && spi_) {
+        waitUploadDone();
+    }
+    releaseResources();
+    shadow_fb_valid_ = false;
+    refresh_pending_ = false;
+    initialised_ = false;
+}
+
+esp_err_t Driver::acquireResources() {
+    if (cfg_.shadow_framebuffer) {
+        shadow_fb_ = static_cast<uint8_t *>(heap_caps_malloc(kBufferSize, MALLOC_CAP_8BIT));
+        ESP_RETURN_ON_FALSE(shadow_fb_ != nullptr, ESP_ERR_NO_MEM, TAG,
+                            "shadow framebuffer alloc failed");
+    }
+    // Allocated once here so no upload ever needs the heap (or a spi_master bounce buffer).
+    row_staging_ = static_cast<uint8_t *>(heap_caps_aligned_alloc(
+        kDmaAlignment, 2 * kRowStagingBytes, MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
+    ESP_RETURN_ON_FALSE(row_staging_ != nullptr, ESP_ERR_NO_MEM, TAG, "row staging alloc failed");
+    shadow_fb_valid_ = false;
+    resetOldPlane();
+    ghost_.reset();
+    temperature_ = kTemperatureUnknown;
+    waveform_band_ = -1;
 
     gpio_config_t out_conf = {};
     out_conf.pin_bit_mask = maskFor(cfg_.dc) | maskFor(cfg_.rst);
@@ -84,44 +299,81 @@ esp_err_t Driver::init(const Config &config) {
     busy_conf.mode = GPIO_MODE_INPUT;
     busy_conf.pull_up_en = GPIO_PULLUP_ENABLE;
     busy_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-    busy_conf.intr_type = GPIO_INTR_DISABLE;
+    busy_conf.intr_type = GPIO_INTR_NEGEDGE;
     ESP_RETURN_ON_ERROR(gpio_config(&busy_conf), TAG, "busy gpio config failed");
 
+    busy_sem_ = xSemaphoreCreateBinary();
+    ESP_RETURN_ON_FALSE(busy_sem_ != nullptr, ESP_ERR_NO_MEM, TAG, "busy semaphore alloc failed");
+    refresh_pending_ = false;
+    refresh_notify_ = false;
+    partial_session_active_ = false;
+    const esp_err_t isr_err = gpio_install_isr_service(0);
+    ESP_RETURN_ON_FALSE(isr_err == ESP_OK || isr_err == ESP_ERR_INVALID_STATE, isr_err, TAG,
+                        "gpio isr service install failed");
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(cfg_.busy, &Driver::busyIsr, this), TAG,
+                        "busy isr add failed");
+    busy_isr_installed_ = true;
+#if CONFIG_PM_ENABLE
+    ESP_RETURN_ON_ERROR(esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "epd_busy", &busy_pm_lock_),
+                        TAG, "pm lock create failed");
+#endif
+
     spi_bus_config_t buscfg = {};
     buscfg.mosi_io_num = cfg_.mosi;
     buscfg.miso_io_num = -1;
     buscfg.sclk_io_num = cfg_.sclk;
     buscfg.quadwp_io_num = -1;
     buscfg.quadhd_io_num = -1;
-    buscfg.max_transfer_sz = kBufferSize + 16;
+    buscfg.max_transfer_sz = kSpiMaxTransferBytes;
     ESP_RETURN_ON_ERROR(spi_bus_initialize(cfg_.host, &buscfg, SPI_DMA_CH_AUTO), TAG,
                         "spi bus init failed");
+    spi_bus_initialised_ = true;
 
     spi_device_interface_config_t devcfg = {};
     devcfg.clock_speed_hz = cfg_.clk_speed_hz;
     devcfg.mode = 0;
     devcfg.spics_io_num = cfg_.cs;
-    devcfg.queue_size = 7;
+    devcfg.queue_size = kSpiQueueDepth;
     devcfg.flags = SPI_DEVICE_NO_DUMMY;
+    if (cfg_.read_temperature) {
+        devcfg.flags |= SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX;
+    }
+    devcfg.pre_cb = &Driver::preTransferCallback;
+    devcfg.post_cb = &Driver::postTransferCallback;
     ESP_RETURN_ON_ERROR(spi_bus_add_device(cfg_.host, &devcfg, &spi_), TAG,
                         "spi add device failed");
-
-    initialised_ = true;
-    ESP_LOGI(TAG, "initialised, SPI clock %d Hz", cfg_.clk_speed_hz);
     return ESP_OK;
 }
 
-/** @brief Tear down SPI resources and mark the driver as uninitialised. */
-void Driver::deinit() {
-    if (!initialised_) {
-        return;
-    }
+void Driver::releaseResources() {
     if (spi_) {
         spi_bus_remove_device(spi_);
         spi_ = nullptr;
     }
-    spi_bus_free(cfg_.host);
-    initialised_ = false;
+    if (spi_bus_initialised_) {
+        spi_bus_free(cfg_.host);
+        spi_bus_initialised_ = false;
+    }
+#if CONFIG_PM_ENABLE
+    if (busy_pm_lock_ != nullptr) {
+        esp_pm_lock_delete(busy_pm_lock_);
+        busy_pm_lock_ = nullptr;
+    }
+#endif
+    if (busy_isr_installed_) {
+        gpio_isr_handler_remove(cfg_.busy);
+        busy_isr_installed_ = false;
+    }
+    if (busy_sem_ != nullptr) {
+        vSemaphoreDelete(busy_sem_);
+        busy_sem_ = nullptr;
+    }
+    heap_caps_free(gray_scratch_);
+    gray_scratch_ = nullptr;
+    heap_caps_free(row_staging_);
+    row_staging_ = nullptr;
+    heap_caps_free(shadow_fb_);
+    shadow_fb_ = nullptr;
 }
 
 /**
@@ -133,6 +385,8 @@ esp_err_t Driver::hardwareInit(bool fast_mode) {
     (void)fast_mode;
     ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
 
+    ESP_RETURN_ON_ERROR(waitRefreshDone(), TAG, "panel busy");
+    endPartialSession();
     reset();
 
     waitWhileBusy();
@@ -197,16 +451,27 @@ esp_err_t Driver::hardwareInit(bool fast_mode) {
 esp_err_t Driver::clear(uint8_t fill_byte) {
     ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
 
-    ESP_RETURN_ON_ERROR(sendCommand(0x24), TAG, "CMD 0x24 failed");
+    endPartialSession();
 
     std::array<uint8_t, 128> buffer{};
     buffer.fill(fill_byte);
 
-    size_t remaining = kBufferSize;
-    while (remaining > 0) {
-        size_t chunk = std::min(remaining, buffer.size());
-        ESP_RETURN_ON_ERROR(sendData(buffer.data(), chunk), TAG, "fill chunk failed");
-        remaining -= chunk;
+    // Both planes get the pattern so the next partial update has a valid previous image.
+    for (uint8_t ram_cmd : {uint8_t{0x24}, uint8_t{0x26}}) {
+        ESP_RETURN_ON_ERROR(setRamWindow(0, 0, kRamColumns, kRamRows), TAG, "full window failed");
+        ESP_RETURN_ON_ERROR(sendCommand(ram_cmd), TAG, "CMD 0x%02X failed", ram_cmd);
+        size_t remaining = kBufferSize;
+        while (remaining > 0) {
+            size_t chunk = std::min(remaining, buffer.size());
+            ESP_RETURN_ON_ERROR(sendData(buffer.data(), chunk), TAG, "fill chunk failed");
+            remaining -= chunk;
+        }
+    }
+    resetOldPlane();
+
+    if (shadow_fb_ != nullptr) {
+        std::memset(shadow_fb_, fill_byte, kBufferSize);
+        shadow_fb_valid_ = true;
     }
 
     return updatePanel(false);
@@ -222,15 +487,109 @@ esp_err_t Driver::loadBaseMap(const uint8_t *data, bool fast_mode) {
     ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
     ESP_RETURN_ON_FALSE(data != nullptr, ESP_ERR_INVALID_ARG, TAG, "data pointer null");
 
-    ESP_RETURN_ON_ERROR(sendCommand(0x24), TAG, "CMD 0x24 failed");
-    ESP_RETURN_ON_ERROR(sendData(data, kBufferSize), TAG, "write base map (0x24) failed");
-
-    ESP_RETURN_ON_ERROR(sendCommand(0x26), TAG, "CMD 0x26 failed");
-    ESP_RETURN_ON_ERROR(sendData(data, kBufferSize), TAG, "write base map (0x26) failed");
+    endPartialSession();
+    ESP_RETURN_ON_ERROR(syncOldPlane(), TAG, "previous image sync failed");
+
+    if (shadowActive() && stale_old_count_ == 0) {
+        // Both planes already equal the shadow, so only the differing bytes go out, to both.
+        Region frame;
+        frame.width = kRamColumns;
+        frame.height = kRamRows;
+        frame.data = data;
+        frame.stride = kRamStride;
+        ESP_RETURN_ON_ERROR(uploadChanged(frame, true), TAG, "base map diff upload failed");
+    } else {
+        for (uint8_t ram_cmd : {uint8_t{0x24}, uint8_t{0x26}}) {
+            ESP_RETURN_ON_ERROR(setRamWindow(0, 0, kRamColumns, kRamRows), TAG,
+                                "full window failed");
+            ESP_RETURN_ON_ERROR(sendCommand(ram_cmd), TAG, "CMD 0x%02X failed", ram_cmd);
+            ESP_RETURN_ON_ERROR(sendPixels(data, kBufferSize), TAG,
+                                "write base map (0x%02X) failed", ram_cmd);
+        }
+        if (shadow_fb_ != nullptr) {
+            std::memcpy(shadow_fb_, data, kBufferSize);
+            shadow_fb_valid_ = true;
+        }
+    }
+    resetOldPlane();
 
     return updatePanel(fast_mode);
 }
 
+/**
+ * @brief Convert and upload a gray region chunk by chunk.
+ *
+ * Each chunk is split into a scratch pair and written to 0x24 then 0x26. With queued uploads the
+ * next chunk is converted into the other pair while the previous 0x26 transfer is on the wire;
+ * the window command that follows drains it.
+ */
+esp_err_t Driver::writeGrayRegion(const Region &region) {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    ESP_RETURN_ON_FALSE(region.data != nullptr && region.width > 0 && region.height > 0,
+                        ESP_ERR_INVALID_ARG, TAG, "empty gray region");
+    ESP_RETURN_ON_FALSE(region.x % 8 == 0 && region.width % 8 == 0 &&
+                            region.x + region.width <= kRamColumns &&
+                            region.y + region.height <= kRamRows,
+                        ESP_ERR_INVALID_ARG, TAG, "gray region %ux%u at (%u,%u) not in RAM",
+                        region.width, region.height, region.x, region.y);
+
+    if (gray_scratch_ == nullptr) {
+        gray_scratch_ = static_cast<uint8_t *>(
+            heap_caps_malloc(4 * kGrayChunkBytes, MALLOC_CAP_DMA | MALLOC_CAP_8BIT));
+        ESP_RETURN_ON_FALSE(gray_scratch_ != nullptr, ESP_ERR_NO_MEM, TAG,
+                            "gray scratch alloc failed");
+    }
+
+    ESP_RETURN_ON_ERROR(syncOldPlane(), TAG, "previous image sync failed");
+    // From here on 0x26 no longer holds a previous image.
+    shadow_fb_valid_ = false;
+    resetOldPlane();
+
+    const size_t plane_row_bytes = region.width / 8;
+    const size_t src_stride = region.stride != 0 ? region.stride : region.width / 4;
+    const uint16_t chunk_rows =
+        static_cast<uint16_t>(std::max<size_t>(1, kGrayChunkBytes / plane_row_bytes));
+
+    size_t pair = 0;
+    for (uint16_t row = 0; row < region.height; row += chunk_rows) {
+        const uint16_t rows = std::min<uint16_t>(chunk_rows, region.height - row);
+        uint8_t *plane24 = gray_scratch_ + pair * 2 * kGrayChunkBytes;
+        uint8_t *plane26 = plane24 + kGrayChunkBytes;
+        pair ^= 1;
+
+        const int64_t started = esp_timer_get_time();
+        for (uint16_t r = 0; r < rows; ++r) {
+            splitGrayPlanes(region.data + (row + r) * src_stride, region.width,
+                            plane24 + r * plane_row_bytes, plane26 + r * plane_row_bytes);
+        }
+        stats_.gray_split_us += esp_timer_get_time() - started;
+
+        const size_t bytes = rows * plane_row_bytes;
+        for (uint8_t ram_cmd : {uint8_t{0x24}, uint8_t{0x26}}) {
+            ESP_RETURN_ON_ERROR(setRamWindow(region.x, region.y + row, region.width, rows), TAG,
+                                "gray window");
+            ESP_RETURN_ON_ERROR(sendCommand(ram_cmd), TAG, "gray cmd 0x%02X", ram_cmd);
+            ESP_RETURN_ON_ERROR(sendPixels(ram_cmd == 0x24 ? plane24 : plane26, bytes), TAG,
+                                "gray pixels");
+        }
+    }
+    return waitUploadDone();
+}
+
+/** @brief Load the 4-gray LUT and run one full-waveform update of both planes. */
+esp_err_t Driver::refreshGray(bool wait) {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    ESP_RETURN_ON_ERROR(waitUploadDone(), TAG, "upload still pending");
+    endPartialSession();
+    ESP_RETURN_ON_ERROR(syncOldPlane(), TAG, "previous image sync failed");
+    shadow_fb_valid_ = false;
+    resetOldPlane();
+
+    ESP_RETURN_ON_ERROR(writeLut(kWaveformGray4.data()), TAG, "gray LUT failed");
+    ++stats_.gray_refreshes;
+    return activateRefresh(0xC7, wait);
+}
+
 /**
  * @brief Write five digit sprites into predefined positions using partial refresh flow.
  */
@@ -242,18 +601,24 @@ esp_err_t Driver::displayDigits(uint16_t x_startA, uint16_t y_startA, const uint
                                 uint16_t part_column, uint16_t part_line) {
     ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
 
-    ESP_RETURN_ON_ERROR(writePartialWindow(x_startA, y_startA, datasA, part_column, part_line), TAG,
-                        "partial A failed");
-    ESP_RETURN_ON_ERROR(writePartialWindow(x_startB, y_startB, datasB, part_column, part_line), TAG,
-                        "partial B failed");
-    ESP_RETURN_ON_ERROR(writePartialWindow(x_startC, y_startC, datasC, part_column, part_line), TAG,
-                        "partial C failed");
-    ESP_RETURN_ON_ERROR(writePartialWindow(x_startD, y_startD, datasD, part_column, part_line), TAG,
-                        "partial D failed");
-    ESP_RETURN_ON_ERROR(writePartialWindow(x_startE, y_startE, datasE, part_column, part_line), TAG,
-                        "partial E failed");
-
-    return partialUpdate();
+    const std::array<Region, 5> digits = {{
+        {static_cast<uint16_t>(x_startA - x_startA % 8), y_startA, part_line, part_column, datasA},
+        {static_cast<uint16_t>(x_startB - x_startB % 8), y_startB, part_line, part_column, datasB},
+        {static_cast<uint16_t>(x_startC - x_startC % 8), y_startC, part_line, part_column, datasC},
+        {static_cast<uint16_t>(x_startD - x_startD % 8), y_startD, part_line, part_column, datasD},
+        {static_cast<uint16_t>(x_startE - x_startE % 8), y_startE, part_line, part_column, datasE},
+    }};
+
+    ESP_RETURN_ON_ERROR(beginFrame(), TAG, "digit frame");
+    for (const Region &digit : digits) {
+        const esp_err_t err = addRegion(digit);
+        if (err != ESP_OK) {
+            abortFrame();
+            ESP_LOGE(TAG, "digit region rejected");
+            return err;
+        }
+    }
+    return commitFrame(RefreshMode::kPartial);
 }
 
 esp_err_t Driver::drawBitmap(uint16_t x_start, uint16_t y_start, const uint8_t *bitmap,
@@ -268,15 +633,221 @@ esp_err_t Driver::drawBitmap(uint16_t x_start, uint16_t y_start, const uint8_t *
                         "partial bitmap failed");
     
     // ถ้า skip_refresh = true จะไม่ refresh จอ (ใช้สำหรับ batch update)
-    if (!skip_refresh) {
-        return partialUpdate();
+    if (skip_refresh) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(partialUpdate(), TAG, "partial refresh failed");
+    if (shadowActive()) {
+        return ESP_OK;
+    }
+
+    // Without a shadow the bitmap is the only copy of the new image; 0x26 must catch up now.
+    Region region;
+    region.x = x_start - (x_start % 8);
+    region.y = y_start;
+    region.width = width_bits;
+    region.height = height_rows;
+    region.data = bitmap;
+    ESP_RETURN_ON_ERROR(uploadWindow(region, 0x26), TAG, "previous image write failed");
+    ++stats_.old_plane_windows;
+    stats_.old_plane_bytes += static_cast<size_t>(width_bits / 8) * height_rows;
+    return waitUploadDone();
+}
+
+/** @brief Start staging regions for a single-refresh frame. */
+esp_err_t Driver::beginFrame() {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    ESP_RETURN_ON_FALSE(!frame_open_, ESP_ERR_INVALID_STATE, TAG, "frame already open");
+    frame_open_ = true;
+    frame_region_count_ = 0;
+    frame_replay_count_ = 0;
+    frame_replay_ok_ = true;
+    return ESP_OK;
+}
+
+/**
+ * @brief Check a region against the RAM geometry, clip it and add it to the frame.
+ *
+ * Regions entirely outside the panel are dropped. When the staging list is full the staged
+ * regions are uploaded early, so a frame may hold any number of regions.
+ */
+esp_err_t Driver::addRegion(const Region &region) {
+    ESP_RETURN_ON_FALSE(frame_open_, ESP_ERR_INVALID_STATE, TAG, "no open frame");
+    ESP_RETURN_ON_FALSE(region.data != nullptr, ESP_ERR_INVALID_ARG, TAG, "region data null");
+    ESP_RETURN_ON_FALSE(region.width != 0 && region.height != 0, ESP_ERR_INVALID_ARG, TAG,
+                        "empty region");
+    ESP_RETURN_ON_FALSE((region.x % 8u) == 0 && (region.width % 8u) == 0, ESP_ERR_INVALID_ARG,
+                        TAG, "region x/width must be multiples of 8");
+
+    Region clipped = region;
+    const uint16_t row_bytes = region.width / 8;
+    if (clipped.stride == 0) {
+        clipped.stride = row_bytes;
+    }
+    ESP_RETURN_ON_FALSE(clipped.stride >= row_bytes, ESP_ERR_INVALID_ARG, TAG,
+                        "stride shorter than row");
+
+    if (clipped.x >= kRamColumns || clipped.y >= kRamRows) {
+        return ESP_OK;
+    }
+    clipped.width = std::min<uint16_t>(clipped.width, kRamColumns - clipped.x);
+    clipped.height = std::min<uint16_t>(clipped.height, kRamRows - clipped.y);
+
+    if (frame_region_count_ == frame_regions_.size()) {
+        frame_replay_ok_ = false;
+        ESP_RETURN_ON_ERROR(uploadStagedRegions(), TAG, "early region upload failed");
+    }
+    frame_regions_[frame_region_count_++] = clipped;
+    return ESP_OK;
+}
+
+/** @brief Push staged regions to RAM, keeping the frame open. */
+esp_err_t Driver::flushFrame(bool wait_upload) {
+    ESP_RETURN_ON_FALSE(frame_open_, ESP_ERR_INVALID_STATE, TAG, "no open frame");
+    frame_replay_ok_ = false;
+    ESP_RETURN_ON_ERROR(uploadStagedRegions(), TAG, "region upload failed");
+    return wait_upload ? waitUploadDone() : ESP_OK;
+}
+
+/** @brief Upload the frame and refresh it once with the requested sequence. */
+esp_err_t Driver::commitFrame(RefreshMode mode, bool wait_refresh) {
+    ESP_RETURN_ON_FALSE(frame_open_, ESP_ERR_INVALID_STATE, TAG, "no open frame");
+
+    const esp_err_t uploaded = uploadStagedRegions();
+    frame_open_ = false;
+    frame_region_count_ = 0;
+    ESP_RETURN_ON_ERROR(uploaded, TAG, "region upload failed");
+
+    esp_err_t result = ESP_ERR_INVALID_ARG;
+    switch (mode) {
+        case RefreshMode::kNone:
+            return waitUploadDone();
+        case RefreshMode::kPartial:
+            if (cfg_.ghost_hard_budget != 0 && ghost_.maxCount() >= cfg_.ghost_hard_budget) {
+                ++stats_.forced_full_refreshes;
+                endPartialSession();
+                result = updatePanel(false, wait_refresh);
+            } else {
+                result = partialUpdate(wait_refresh);
+            }
+            break;
+        case RefreshMode::kFull:
+            result = updatePanel(false, wait_refresh);
+            break;
+        case RefreshMode::kFast:
+            result = updatePanel(true, wait_refresh);
+            break;
+    }
+    ESP_RETURN_ON_ERROR(result, TAG, "frame refresh failed");
+
+    // The caller's bitmaps are still valid here, so they can stand in for the missing shadow.
+    if (wait_refresh && !shadowActive() && frame_replay_ok_) {
+        return replayFrameToOldPlane();
+    }
+    return ESP_OK;
+}
+
+bool Driver::cleaningDue() const {
+    return cfg_.ghost_budget != 0 && ghost_.maxCount() >= cfg_.ghost_budget;
+}
+
+/**
+ * @brief Clean the tiles whose partial refresh count reached Config::ghost_budget.
+ *
+ * Meant for idle periods: it waits for any running refresh and blocks until the cleaning
+ * refreshes finish. A failed tile flash leaves 0x26 unknown, so the shadow is dropped and the
+ * next clear() or loadBaseMap() starts over.
+ */
+esp_err_t Driver::runCleaning() {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    ESP_RETURN_ON_FALSE(!frame_open_, ESP_ERR_INVALID_STATE, TAG, "frame still open");
+    if (!cleaningDue()) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(waitRefreshDone(), TAG, "panel busy");
+    ESP_RETURN_ON_ERROR(syncOldPlane(), TAG, "previous image sync failed");
+
+    const size_t due = ghost_.tilesAtLeast(cfg_.ghost_budget);
+    if (!shadowActive() || stale_old_count_ > 0 || due >= cfg_.ghost_full_clean_tiles) {
+        endPartialSession();
+        ESP_RETURN_ON_ERROR(updatePanel(false), TAG, "cleaning refresh failed");
+        ++stats_.cleaning_refreshes;
+        stats_.cleaned_tiles += due;
+        return ESP_OK;
+    }
+
+    const esp_err_t result = flashDueTiles();
+    if (result != ESP_OK) {
+        partial_session_active_ = false;
+        shadow_fb_valid_ = false;
+        resetOldPlane();
     }
+    return result;
+}
+
+/** @brief Discard the open frame without touching the panel. */
+void Driver::abortFrame() {
+    frame_open_ = false;
+    frame_region_count_ = 0;
+}
+
+/**
+ * @brief Latch the internal sensor into the temperature register (0x22 = 0xA1) and read 0x1B.
+ *
+ * The register holds a 12-bit two's complement value in 1/16 °C; its first byte is the
+ * integer part.
+ */
+esp_err_t Driver::readTemperature(int &celsius) {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    ESP_RETURN_ON_FALSE(cfg_.read_temperature, ESP_ERR_NOT_SUPPORTED, TAG,
+                        "temperature readback not enabled");
+
+    const std::array<uint8_t, 1> cmd18 = {0x80};
+    ESP_RETURN_ON_ERROR(sendCommand(0x18, cmd18.data(), cmd18.size()), TAG, "sensor select");
+    const std::array<uint8_t, 1> cmd22 = {0xA1};
+    ESP_RETURN_ON_ERROR(sendCommand(0x22, cmd22.data(), cmd22.size()), TAG, "sensor control");
+    ESP_RETURN_ON_ERROR(sendCommand(0x20), TAG, "sensor trigger");
+    ESP_RETURN_ON_ERROR(waitWhileBusy(), TAG, "sensor read timed out");
+
+    std::array<uint8_t, 2> raw{};
+    ESP_RETURN_ON_ERROR(readRegister(0x1B, raw.data(), raw.size()), TAG, "0x1B read failed");
+    celsius = static_cast<int8_t>(raw[0]);
+    setTemperature(celsius);
     return ESP_OK;
 }
 
+/**
+ * @brief Record the panel temperature and move to the band it falls in.
+ *
+ * Edges above the current band must be exceeded by kBandHysteresisCelsius and edges at or below
+ * it undercut by the same margin, so a reading hovering at an edge does not flip the LUT on
+ * every refresh.
+ */
+void Driver::setTemperature(int celsius) {
+    temperature_ = std::clamp(celsius, -127, 127);
+    int band = 0;
+    for (int i = 1; i < static_cast<int>(kWaveformBands.size()); ++i) {
+        int edge = kWaveformBands[i].min_celsius;
+        if (waveform_band_ >= 0) {
+            edge += i > waveform_band_ ? kBandHysteresisCelsius : -kBandHysteresisCelsius;
+        }
+        if (temperature_ >= edge) {
+            band = i;
+        }
+    }
+    if (band != waveform_band_) {
+        if (waveform_band_ >= 0) {
+            ++stats_.waveform_band_changes;
+        }
+        ESP_LOGI(TAG, "%d C: waveform band %d", temperature_, band);
+        waveform_band_ = band;
+    }
+}
+
 /** @brief Put the panel into deep sleep mode to reduce power consumption. */
 esp_err_t Driver::deepSleep() {
     ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    endPartialSession();
     const std::array<uint8_t, 1> payload = {0x01};
     ESP_RETURN_ON_ERROR(sendCommand(0x10, payload.data(), payload.size()), TAG, "deep sleep failed");
     vTaskDelay(pdMS_TO_TICKS(100));
@@ -289,77 +860,379 @@ esp_err_t Driver::triggerRefresh() {
     return partialUpdate();
 }
 
+/**
+ * @brief Kick off a partial refresh of the data already in RAM and return immediately.
+ *
+ * Completion is reported through the refresh callback or waitRefreshDone(); any later command
+ * waits for the panel implicitly.
+ */
+esp_err_t Driver::triggerRefreshAsync() {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    return partialUpdate(false);
+}
+
+/** @brief Kick off a full-waveform refresh and return immediately. */
+esp_err_t Driver::triggerFullRefreshAsync(bool fast_mode) {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    return updatePanel(fast_mode, false);
+}
+
+/**
+ * @brief Wait for an outstanding refresh to complete.
+ *
+ * @return ESP_OK when idle, ESP_ERR_TIMEOUT if the panel is still busy after @p timeout.
+ */
+esp_err_t Driver::waitRefreshDone(TickType_t timeout) {
+    if (!refresh_pending_) {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(waitWhileBusy(timeout), TAG, "refresh still running");
+    refresh_pending_ = false;
+    return ESP_OK;
+}
+
+/** @brief Report whether the last started refresh is still driving the panel. */
+bool Driver::refreshInProgress() const {
+    return refresh_pending_ && gpio_get_level(cfg_.busy) == 1;
+}
+
+/** @brief Install the refresh completion callback; pass nullptr to remove it. */
+void Driver::setRefreshDoneCallback(RefreshDoneCallback callback, void *user_ctx) {
+    refresh_cb_ = callback;
+    refresh_cb_ctx_ = user_ctx;
+}
+
 /** @brief Pulse the reset line according to the datasheet timing. */
-void Driver::reset() const {
+void Driver::reset() {
+    ++stats_.controller_resets;
+    invalidateShadow();
     gpio_set_level(cfg_.rst, 0);
     vTaskDelay(pdMS_TO_TICKS(10));
     gpio_set_level(cfg_.rst, 1);
     vTaskDelay(pdMS_TO_TICKS(10));
 }
 
-/** @brief Block until the BUSY pin drops low, signalling command completion. */
-void Driver::waitWhileBusy() const {
-    const TickType_t delay_ticks = pdMS_TO_TICKS(10);
+/**
+ * @brief Block until the BUSY pin drops low, signalling command completion.
+ *
+ * Sleeps on the semaphore given by busyIsr() rather than polling, so the caller wakes as soon as
+ * the falling edge arrives. The level is re-checked after every wake-up, which makes stale or
+ * missed edges harmless. With power management enabled, automatic light sleep is held off for
+ * the wait; otherwise the edge interrupt would be lost and the waiter would only notice the
+ * panel is idle at the end of a kBusyWaitSlice.
+ */
+esp_err_t Driver::waitWhileBusy(TickType_t timeout) {
+    const int64_t started = esp_timer_get_time();
+    const TickType_t start_tick = xTaskGetTickCount();
+    esp_err_t result = ESP_OK;
+#if CONFIG_PM_ENABLE
+    const bool hold_awake = gpio_get_level(cfg_.busy) == 1;
+    if (hold_awake) {
+        esp_pm_lock_acquire(busy_pm_lock_);
+    }
+#endif
     while (gpio_get_level(cfg_.busy) == 1) {
-        vTaskDelay(delay_ticks);
+        TickType_t slice = kBusyWaitSlice;
+        if (timeout != portMAX_DELAY) {
+            const TickType_t elapsed = xTaskGetTickCount() - start_tick;
+            if (elapsed >= timeout) {
+                result = ESP_ERR_TIMEOUT;
+                break;
+            }
+            slice = std::min(slice, timeout - elapsed);
+        }
+        xSemaphoreTake(busy_sem_, slice);
     }
+#if CONFIG_PM_ENABLE
+    if (hold_awake) {
+        esp_pm_lock_release(busy_pm_lock_);
+    }
+#endif
+    stats_.busy_wait_us += esp_timer_get_time() - started;
+    return result;
 }
 
-/** @brief Write a single command byte on the SPI bus. */
-esp_err_t Driver::sendCommand(uint8_t cmd) {
-    gpio_set_level(cfg_.dc, 0);
-    spi_transaction_t t = {};
-    t.length = 8;
-    t.flags = SPI_TRANS_USE_TXDATA;
-    t.tx_data[0] = cmd;
+/** @brief Wake any BUSY waiter and, if a refresh was started, report its completion. */
+void IRAM_ATTR Driver::busyIsr(void *arg) {
+    auto *self = static_cast<Driver *>(arg);
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(self->busy_sem_, &woken);
+    if (self->refresh_notify_.exchange(false) && self->refresh_cb_ != nullptr) {
+        self->refresh_cb_(self->refresh_cb_ctx_);
+    }
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+/** @brief Drive DC from the slot attached to the transaction that is about to start. */
+void IRAM_ATTR Driver::preTransferCallback(spi_transaction_t *trans) {
+    const auto *slot = static_cast<const TransferSlot *>(trans->user);
+    if (slot != nullptr) {
+        gpio_set_level(slot->owner->cfg_.dc, slot->dc_level ? 1 : 0);
+    }
+}
+
+/** @brief Notify the registered listener once the final chunk of an upload has gone out. */
+void IRAM_ATTR Driver::postTransferCallback(spi_transaction_t *trans) {
+    const auto *slot = static_cast<const TransferSlot *>(trans->user);
+    if (slot != nullptr && slot->notify && slot->owner->upload_cb_ != nullptr) {
+        slot->owner->upload_cb_(slot->owner->upload_cb_ctx_);
+    }
+}
+
+/** @brief Install the upload completion callback; pass nullptr to remove it. */
+void Driver::setUploadDoneCallback(UploadDoneCallback callback, void *user_ctx) {
+    upload_cb_ = callback;
+    upload_cb_ctx_ = user_ctx;
+}
+
+/**
+ * @brief Collect the results of every queued transaction.
+ *
+ * @param timeout Upper bound for the whole drain; ESP_ERR_TIMEOUT leaves the rest queued.
+ */
+esp_err_t Driver::waitUploadDone(TickType_t timeout) {
+    const TickType_t started = xTaskGetTickCount();
+    while (in_flight_ > 0) {
+        TickType_t remaining = timeout;
+        if (timeout != portMAX_DELAY) {
+            const TickType_t elapsed = xTaskGetTickCount() - started;
+            remaining = elapsed >= timeout ? 0 : timeout - elapsed;
+        }
+        ESP_RETURN_ON_ERROR(reclaimSlot(remaining), TAG, "upload did not complete");
+    }
+    return ESP_OK;
+}
+
+/** @brief Block on the SPI result queue for the oldest in-flight transaction. */
+esp_err_t Driver::reclaimSlot(TickType_t timeout) {
+    spi_transaction_t *done = nullptr;
+    const int64_t started = esp_timer_get_time();
+    const esp_err_t err = spi_device_get_trans_result(spi_, &done, timeout);
+    stats_.queue_wait_us += esp_timer_get_time() - started;
+    if (err != ESP_OK) {
+        return err;
+    }
+    --in_flight_;
+    return ESP_OK;
+}
+
+/**
+ * @brief Send one transaction with the polling API.
+ *
+ * Polling and queued transactions cannot be mixed on one device, so anything still queued is
+ * drained first. Payloads of up to four bytes are copied into the transaction itself.
+ */
+esp_err_t Driver::transmitPolling(bool dc_level, const uint8_t *data, size_t len) {
+    ESP_RETURN_ON_ERROR(waitUploadDone(), TAG, "drain before polling transfer failed");
+
+    polling_slot_.dc_level = dc_level;
+    spi_transaction_t &t = polling_slot_.trans;
+    t = {};
+    t.user = &polling_slot_;
+    t.length = len * 8;
+    if (len <= sizeof(t.tx_data)) {
+        t.flags = SPI_TRANS_USE_TXDATA;
+        std::memcpy(t.tx_data, data, len);
+    } else {
+        t.tx_buffer = data;
+        stats_.dma_bounce_transfers += needsBounce(data, len) ? 1 : 0;
+    }
+    ++stats_.transactions;
     return spi_device_polling_transmit(spi_, &t);
 }
 
+/**
+ * @brief Issue @p cmd, then clock @p len bytes back from the controller on SDA.
+ *
+ * Only possible when the device was added 3-wire half duplex (Config::read_temperature).
+ */
+esp_err_t Driver::readRegister(uint8_t cmd, uint8_t *data, size_t len) {
+    ESP_RETURN_ON_FALSE(len > 0 && len <= sizeof(polling_slot_.trans.rx_data),
+                        ESP_ERR_INVALID_ARG, TAG, "read length %u", static_cast<unsigned>(len));
+    ESP_RETURN_ON_ERROR(sendCommand(cmd), TAG, "read command 0x%02X", cmd);
+
+    polling_slot_.dc_level = true;
+    spi_transaction_t &t = polling_slot_.trans;
+    t = {};
+    t.user = &polling_slot_;
+    t.flags = SPI_TRANS_USE_RXDATA;
+    t.rxlength = len * 8;
+    ++stats_.transactions;
+    ESP_RETURN_ON_ERROR(spi_device_polling_transmit(spi_, &t), TAG, "read transfer failed");
+    std::memcpy(data, t.rx_data, len);
+    return ESP_OK;
+}
+
+/** @brief Write a single command byte on the SPI bus, once any running refresh has ended. */
+esp_err_t Driver::sendCommand(uint8_t cmd) {
+    ESP_RETURN_ON_ERROR(waitRefreshDone(), TAG, "panel busy");
+
+    switch (cmd) {
+        case 0x10:  // deep sleep
+        case 0x12:  // SWRESET
+            invalidateShadow();
+            break;
+        case 0x20: {  // activation may reload the LUT from OTP or the temperature from the sensor
+            const RegisterShadow *control = shadowFor(0x22);
+            const bool known = control != nullptr && control->valid;
+            if (!known || (control->value[0] & kUpdateLoadsLut)) {
+                lut_shadow_valid_ = false;
+            }
+            if (!known || (control->value[0] & kUpdateLoadsTemperature)) {
+                shadowFor(0x1A)->valid = false;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return transmitPolling(false, &cmd, 1);
+}
+
 /**
  * @brief Helper that writes a command byte followed by an optional payload.
+ *
+ * Writes to cached registers are dropped when the payload matches the last value sent.
  */
 esp_err_t Driver::sendCommand(uint8_t cmd, const uint8_t *data, size_t len) {
+    RegisterShadow *entry = cfg_.register_cache ? shadowFor(cmd) : nullptr;
+    if (entry != nullptr && (data == nullptr || len == 0 || len > entry->value.size())) {
+        entry->valid = false;
+        entry = nullptr;
+    }
+    if (entry != nullptr && entry->valid && entry->len == len &&
+        std::memcmp(entry->value.data(), data, len) == 0) {
+        ++stats_.skipped_commands;
+        stats_.skipped_bytes += 1 + len;
+        return ESP_OK;
+    }
+    if (entry != nullptr) {
+        entry->valid = false;
+    }
+
     ESP_RETURN_ON_ERROR(sendCommand(cmd), TAG, "send command 0x%02X failed", static_cast<int>(cmd));
     if (data != nullptr && len > 0) {
         ESP_RETURN_ON_ERROR(sendData(data, len), TAG, "send data for 0x%02X failed",
                             static_cast<int>(cmd));
     }
+
+    if (entry != nullptr) {
+        std::memcpy(entry->value.data(), data, len);
+        entry->len = static_cast<uint8_t>(len);
+        entry->valid = true;
+    }
     return ESP_OK;
 }
 
+/** @brief Mark every shadowed register and the LUT as unknown. */
+void Driver::invalidateShadow() {
+    for (RegisterShadow &entry : shadow_) {
+        entry.valid = false;
+    }
+    lut_shadow_valid_ = false;
+}
+
+/** @brief Linear lookup over the short list of cached registers. */
+Driver::RegisterShadow *Driver::shadowFor(uint8_t cmd) {
+    for (RegisterShadow &entry : shadow_) {
+        if (entry.cmd == cmd) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
 /** @brief Stream arbitrary data bytes over SPI while DC is asserted high. */
 esp_err_t Driver::sendData(const uint8_t *data, size_t len) {
     if (len == 0) {
         return ESP_OK;
     }
 
-    gpio_set_level(cfg_.dc, 1);
+    stats_.data_bytes += len;
     while (len > 0) {
-        size_t chunk = std::min(len, kSpiMaxChunkBytes);
-        spi_transaction_t t = {};
-        t.length = chunk * 8;
-        t.tx_buffer = data;
-        ESP_RETURN_ON_ERROR(spi_device_polling_transmit(spi_, &t), TAG, "spi write failed");
+        const size_t chunk = dmaChunk(data, len, cfg_.transfer_chunk_bytes);
+        ESP_RETURN_ON_ERROR(transmitPolling(true, data, chunk), TAG, "spi write failed");
         data += chunk;
         len -= chunk;
     }
     return ESP_OK;
 }
 
-/** @brief Load the temperature-compensated default waveform. */
-esp_err_t Driver::writeLutDefault() {
-    return writeLut(kWaveform20_80.data());
+/**
+ * @brief Stream frame data, keeping up to kSpiQueueDepth DMA transactions in flight.
+ *
+ * Returns once the last chunk is queued; the buffer must stay valid until the transfers drain.
+ * Unaligned edge bytes travel inline in the transaction so spi_master never bounces a chunk.
+ * Falls back to sendData() when async uploads are disabled.
+ */
+esp_err_t Driver::sendPixels(const uint8_t *data, size_t len) {
+    if (!cfg_.async_upload) {
+        return sendData(data, len);
+    }
+
+    stats_.data_bytes += len;
+    while (len > 0) {
+        if (in_flight_ == slots_.size()) {
+            ESP_RETURN_ON_ERROR(reclaimSlot(portMAX_DELAY), TAG, "spi queue stalled");
+        }
+
+        const size_t chunk = dmaChunk(data, len, cfg_.transfer_chunk_bytes);
+        TransferSlot &slot = slots_[next_slot_];
+        slot.dc_level = true;
+        slot.notify = (chunk == len);
+        slot.trans = {};
+        slot.trans.user = &slot;
+        slot.trans.length = chunk * 8;
+        if (((reinterpret_cast<uintptr_t>(data) | chunk) % kDmaAlignment) != 0) {
+            slot.trans.flags = SPI_TRANS_USE_TXDATA;
+            std::memcpy(slot.trans.tx_data, data, chunk);
+            ++stats_.inline_edge_transfers;
+        } else {
+            slot.trans.tx_buffer = data;
+            stats_.dma_bounce_transfers += needsBounce(data, chunk) ? 1 : 0;
+        }
+        ESP_RETURN_ON_ERROR(spi_device_queue_trans(spi_, &slot.trans, portMAX_DELAY), TAG,
+                            "spi queue failed");
+
+        next_slot_ = (next_slot_ + 1) % slots_.size();
+        ++in_flight_;
+        ++stats_.transactions;
+        data += chunk;
+        len -= chunk;
+    }
+    return ESP_OK;
 }
 
-/** @brief Load the fast-update waveform table. */
-esp_err_t Driver::writeLutFast() {
-    return writeLut(kWaveform80_127.data());
+/**
+ * @brief Pick the register waveform for a full refresh.
+ *
+ * Until a temperature is known the room-temperature pair is used, as before bands existed.
+ */
+const uint8_t *Driver::selectWaveform(bool fast_mode) const {
+    const WaveformBand &band = kWaveformBands[waveform_band_ >= 0 ? waveform_band_ : 1];
+    return fast_mode ? band.fast : band.normal;
 }
 
-/** @brief Transfer a LUT blob into the controller registers. */
+/**
+ * @brief Transfer a LUT blob into the controller registers.
+ *
+ * Skipped entirely, including the BUSY wait after 0x32, when the controller still holds the
+ * same waveform.
+ */
 esp_err_t Driver::writeLut(const uint8_t *waveform) {
     ESP_RETURN_ON_FALSE(waveform != nullptr, ESP_ERR_INVALID_ARG, TAG, "waveform null");
 
+    if (cfg_.register_cache && lut_shadow_valid_ &&
+        std::memcmp(lut_shadow_.data(), waveform, lut_shadow_.size()) == 0) {
+        stats_.skipped_commands += 4;
+        stats_.skipped_bytes += 4 + lut_shadow_.size();
+        return ESP_OK;
+    }
+    lut_shadow_valid_ = false;
+    ++stats_.lut_uploads;
+
     ESP_RETURN_ON_ERROR(sendCommand(0x32, waveform, 105), TAG, "write LUT main failed");
     waitWhileBusy();
 
@@ -367,47 +1240,127 @@ esp_err_t Driver::writeLut(const uint8_t *waveform) {
     ESP_RETURN_ON_ERROR(sendCommand(0x04, waveform + 106, 3), TAG, "write LUT source failed");
     ESP_RETURN_ON_ERROR(sendCommand(0x2C, waveform + 109, 1), TAG, "write LUT vcom failed");
 
+    std::memcpy(lut_shadow_.data(), waveform, lut_shadow_.size());
+    lut_shadow_valid_ = true;
     return ESP_OK;
 }
 
 /**
  * @brief Trigger the display update sequence using the selected LUT.
  */
-esp_err_t Driver::updatePanel(bool fast_mode) {
-    if (fast_mode) {
-        ESP_RETURN_ON_ERROR(writeLutFast(), TAG, "fast LUT failed");
-    } else {
-        ESP_RETURN_ON_ERROR(writeLutDefault(), TAG, "default LUT failed");
+esp_err_t Driver::updatePanel(bool fast_mode, bool wait) {
+    const uint8_t *waveform = selectWaveform(fast_mode);
+    if (waveform == nullptr) {
+        // Let the controller load its OTP waveform for the temperature written to 0x1A.
+        const std::array<uint8_t, 2> cmd1a = {static_cast<uint8_t>(temperature_), 0x00};
+        ESP_RETURN_ON_ERROR(sendCommand(0x1A, cmd1a.data(), cmd1a.size()), TAG, "CMD 0x1A failed");
+        ESP_RETURN_ON_ERROR(activateRefresh(0xC7 | kUpdateLoadsLut, wait), TAG,
+                            "update activation");
+        return ESP_OK;
     }
 
-    const std::array<uint8_t, 1> control = {0xC7};
-    ESP_RETURN_ON_ERROR(sendCommand(0x22, control.data(), control.size()), TAG, "update control");
-    ESP_RETURN_ON_ERROR(sendCommand(0x20), TAG, "update trigger");
-    waitWhileBusy();
+    ESP_RETURN_ON_ERROR(writeLut(waveform), TAG, "%s LUT failed", fast_mode ? "fast" : "default");
+    ++stats_.lut_refreshes;
+    ESP_RETURN_ON_ERROR(activateRefresh(0xC7, wait), TAG, "update activation");
     return ESP_OK;
 }
 
 /** @brief Request a partial update sequence using the preloaded buffer. */
-esp_err_t Driver::partialUpdate() {
-    const std::array<uint8_t, 1> control = {0xFF};
-    ESP_RETURN_ON_ERROR(sendCommand(0x22, control.data(), control.size()), TAG,
-                        "partial update control");
-    ESP_RETURN_ON_ERROR(sendCommand(0x20), TAG, "partial update trigger");
-    waitWhileBusy();
+esp_err_t Driver::partialUpdate(bool wait) {
+    ESP_RETURN_ON_ERROR(activateRefresh(0xFF, wait), TAG, "partial update activation");
     return ESP_OK;
 }
 
+/**
+ * @brief Select the update sequence in 0x22, start it with 0x20 and track completion.
+ *
+ * @param wait Block until BUSY drops; otherwise return and let the ISR report completion.
+ */
+esp_err_t Driver::activateRefresh(uint8_t control, bool wait) {
+    ESP_RETURN_ON_ERROR(syncOldPlane(), TAG, "previous image sync");
+    const std::array<uint8_t, 1> payload = {control};
+    ESP_RETURN_ON_ERROR(sendCommand(0x22, payload.data(), payload.size()), TAG, "update control");
+
+    xSemaphoreTake(busy_sem_, 0);
+    refresh_notify_ = true;
+    ESP_RETURN_ON_ERROR(sendCommand(0x20), TAG, "update trigger");
+    refresh_started_us_ = esp_timer_get_time();
+    refresh_pending_ = true;
+    stale_old_shown_ = stale_old_count_ > 0;
+    if (control & kUpdateDisplayMode2) {
+        ghost_.partialRefreshed();
+    } else {
+        ghost_.fullRefreshed();
+    }
+    if (!wait) {
+        return ESP_OK;
+    }
+    return waitRefreshDone();
+}
+
 /**
  * @brief Configure the RAM window and stream partial image data.
+ *
+ * Opens a partial session on first use; an error closes it so the next window starts from a
+ * clean reset.
  */
 esp_err_t Driver::writePartialWindow(uint16_t x_start, uint16_t y_start, const uint8_t *datas,
                                      uint16_t part_column, uint16_t part_line) {
     ESP_RETURN_ON_FALSE(datas != nullptr, ESP_ERR_INVALID_ARG, TAG, "partial data null");
 
-    uint16_t x_aligned = x_start - (x_start % 8);
-    uint16_t x_end = x_aligned + part_line - 1;
-    uint16_t y_end = y_start + part_column - 1;
+    const int64_t started = esp_timer_get_time();
+    if (!cfg_.partial_session) {
+        partial_session_active_ = false;
+    }
+    ESP_RETURN_ON_ERROR(beginPartialSession(), TAG, "partial session setup failed");
+    ESP_RETURN_ON_ERROR(syncOldPlane(), TAG, "previous image sync failed");
+
+    Region region;
+    region.x = x_start - (x_start % 8);
+    region.y = y_start;
+    region.width = part_line;
+    region.height = part_column;
+    region.data = datas;
+    region.stride = part_line / 8;
+    const bool in_ram = region.x + region.width <= kRamColumns &&
+                        region.y + region.height <= kRamRows && (part_line % 8u) == 0;
+
+    esp_err_t result = ESP_OK;
+    if (shadowActive() && in_ram) {
+        result = uploadChanged(region);
+    } else {
+        result = sendWindow(x_start, y_start, datas, part_column, part_line);
+        ++stats_.partial_windows;
+        if (shadow_fb_ != nullptr && in_ram) {
+            updateShadow(region);
+        } else {
+            shadow_fb_valid_ = false;
+            resetOldPlane();
+        }
+    }
+    if (result != ESP_OK) {
+        partial_session_active_ = false;
+        shadow_fb_valid_ = false;
+        resetOldPlane();
+    }
+    stats_.partial_window_us += esp_timer_get_time() - started;
+    return result;
+}
+
+/**
+ * @brief Reset the controller and apply the partial-mode temperature and border settings.
+ *
+ * No-op while a session is already active. Waits for any running refresh first, since a reset
+ * would abort it.
+ */
+esp_err_t Driver::beginPartialSession() {
+    ESP_RETURN_ON_FALSE(initialised_, ESP_ERR_INVALID_STATE, TAG, "driver not initialised");
+    if (partial_session_active_) {
+        return ESP_OK;
+    }
 
+    ESP_RETURN_ON_ERROR(waitRefreshDone(), TAG, "panel busy");
+    ESP_RETURN_ON_ERROR(waitUploadDone(), TAG, "upload still pending");
     reset();
 
     const std::array<uint8_t, 1> cmd18 = {0x80};
@@ -416,38 +1369,429 @@ esp_err_t Driver::writePartialWindow(uint16_t x_start, uint16_t y_start, const u
     const std::array<uint8_t, 1> cmd3c = {0x80};
     ESP_RETURN_ON_ERROR(sendCommand(0x3C, cmd3c.data(), cmd3c.size()), TAG, "partial cmd 0x3C");
 
+    partial_session_active_ = true;
+    return ESP_OK;
+}
+
+/** @brief Set the RAM window and address counters, then stream the window's pixels. */
+esp_err_t Driver::sendWindow(uint16_t x_start, uint16_t y_start, const uint8_t *datas,
+                             uint16_t part_column, uint16_t part_line) {
+    uint16_t x_aligned = x_start - (x_start % 8);
+    ESP_RETURN_ON_ERROR(setRamWindow(x_aligned, y_start, part_line, part_column), TAG,
+                        "partial window");
+    ghost_.markWritten(x_aligned, y_start, part_line, part_column);
+    stats_.partial_window_bytes += static_cast<size_t>(part_column) * part_line / 8;
+    ESP_RETURN_ON_ERROR(sendCommand(0x24), TAG, "partial cmd 0x24");
+
+    size_t bytes = static_cast<size_t>(part_column) * part_line / 8;
+    return sendPixels(datas, bytes);
+}
+
+/** @brief Program 0x44/0x45 with the window bounds and 0x4E/0x4F with its origin. */
+esp_err_t Driver::setRamWindow(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    uint16_t x_end = x + width - 1;
+    uint16_t y_end = y + height - 1;
+
     const std::array<uint8_t, 4> cmd44 = {
-        static_cast<uint8_t>(x_aligned & 0xFF),
-        static_cast<uint8_t>(x_aligned >> 8),
+        static_cast<uint8_t>(x & 0xFF),
+        static_cast<uint8_t>(x >> 8),
         static_cast<uint8_t>(x_end & 0xFF),
         static_cast<uint8_t>(x_end >> 8),
     };
     ESP_RETURN_ON_ERROR(sendCommand(0x44, cmd44.data(), cmd44.size()), TAG, "partial cmd 0x44");
 
     const std::array<uint8_t, 4> cmd45 = {
-        static_cast<uint8_t>(y_start & 0xFF),
-        static_cast<uint8_t>(y_start >> 8),
+        static_cast<uint8_t>(y & 0xFF),
+        static_cast<uint8_t>(y >> 8),
         static_cast<uint8_t>(y_end & 0xFF),
         static_cast<uint8_t>(y_end >> 8),
     };
     ESP_RETURN_ON_ERROR(sendCommand(0x45, cmd45.data(), cmd45.size()), TAG, "partial cmd 0x45");
 
     const std::array<uint8_t, 2> cmd4e = {
-        static_cast<uint8_t>(x_aligned & 0xFF),
-        static_cast<uint8_t>(x_aligned >> 8),
+        static_cast<uint8_t>(x & 0xFF),
+        static_cast<uint8_t>(x >> 8),
     };
     ESP_RETURN_ON_ERROR(sendCommand(0x4E, cmd4e.data(), cmd4e.size()), TAG, "partial cmd 0x4E");
 
     const std::array<uint8_t, 2> cmd4f = {
-        static_cast<uint8_t>(y_start & 0xFF),
-        static_cast<uint8_t>(y_start >> 8),
+        static_cast<uint8_t>(y & 0xFF),
+        static_cast<uint8_t>(y >> 8),
     };
     ESP_RETURN_ON_ERROR(sendCommand(0x4F, cmd4f.data(), cmd4f.size()), TAG, "partial cmd 0x4F");
+    return ESP_OK;
+}
 
-    ESP_RETURN_ON_ERROR(sendCommand(0x24), TAG, "partial cmd 0x24");
+/**
+ * @brief Send a region's rows as one stream.
+ *
+ * Rows packed back to back go out directly. Strided rows (shadow framebuffer rectangles) are
+ * gathered into the two row_staging_ halves in turn, one transfer per band instead of one per
+ * row; a half is refilled only after the transfers queued from it have drained.
+ */
+esp_err_t Driver::sendRegionRows(const Region &region) {
+    const size_t row_bytes = region.width / 8;
+    if (region.stride == row_bytes) {
+        return sendPixels(region.data, row_bytes * region.height);
+    }
+    const uint16_t band_rows = static_cast<uint16_t>(kRowStagingBytes / row_bytes);
+    const uint8_t *row = region.data;
+    size_t half = 0;
+    for (uint16_t first = 0; first < region.height; first += band_rows, half ^= 1) {
+        // Earlier uploads (or this call's transfers two bands back) may still read the half.
+        if (first == 0 || first >= 2 * band_rows) {
+            ESP_RETURN_ON_ERROR(waitUploadDone(), TAG, "staging half still in flight");
+        }
+        uint8_t *staging = row_staging_ + half * kRowStagingBytes;
+        const uint16_t rows = std::min<uint16_t>(band_rows, region.height - first);
+        for (uint16_t i = 0; i < rows; ++i, row += region.stride) {
+            std::memcpy(staging + i * row_bytes, row, row_bytes);
+        }
+        ESP_RETURN_ON_ERROR(sendPixels(staging, rows * row_bytes), TAG, "region rows failed");
+    }
+    return ESP_OK;
+}
 
-    size_t bytes = static_cast<size_t>(part_column) * part_line / 8;
-    return sendData(datas, bytes);
+/**
+ * @brief Upload the staged regions with as few RAM windows as possible.
+ *
+ * Regions are grouped by column span and sorted top to bottom, so vertically adjacent regions
+ * of equal width (such as consecutive LVGL strips) share one window and one 0x24 burst. If any
+ * two regions overlap, insertion order is kept so later regions still win.
+ */
+esp_err_t Driver::uploadStagedRegions() {
+    const size_t count = frame_region_count_;
+    frame_region_count_ = 0;
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    Region *first = frame_regions_.data();
+    Region *last = first + count;
+    bool overlapping = false;
+    for (auto *a = first; a != last && !overlapping; ++a) {
+        for (auto *b = a + 1; b != last; ++b) {
+            if (a->x < b->x + b->width && b->x < a->x + a->width && a->y < b->y + b->height &&
+                b->y < a->y + a->height) {
+                overlapping = true;
+                break;
+            }
+        }
+    }
+    if (!overlapping) {
+        std::stable_sort(first, last, [](const Region &a, const Region &b) {
+            if (a.x != b.x) {
+                return a.x < b.x;
+            }
+            if (a.width != b.width) {
+                return a.width < b.width;
+            }
+            return a.y < b.y;
+        });
+    }
+
+    ESP_RETURN_ON_ERROR(beginPartialSession(), TAG, "partial session setup failed");
+    ESP_RETURN_ON_ERROR(syncOldPlane(), TAG, "previous image sync failed");
+
+    esp_err_t result = ESP_OK;
+    if (shadowActive()) {
+        for (Region *region = first; region != last && result == ESP_OK; ++region) {
+            result = uploadChanged(*region);
+        }
+        if (result != ESP_OK) {
+            partial_session_active_ = false;
+            shadow_fb_valid_ = false;
+            resetOldPlane();
+        }
+        return result;
+    }
+
+    frame_replay_count_ = count;
+
+    for (auto *run = first; run != last && result == ESP_OK;) {
+        const int64_t started = esp_timer_get_time();
+        auto *end = run + 1;
+        uint32_t rows = run->height;
+        while (end != last && end->x == run->x && end->width == run->width &&
+               end->y == run->y + rows && rows + end->height <= kRamRows) {
+            rows += end->height;
+            ++end;
+        }
+
+        result = setRamWindow(run->x, run->y, run->width, static_cast<uint16_t>(rows));
+        ghost_.markWritten(run->x, run->y, run->width, static_cast<uint16_t>(rows));
+        stats_.partial_window_bytes += static_cast<size_t>(run->width / 8) * rows;
+        if (result == ESP_OK) {
+            result = sendCommand(0x24);
+        }
+        for (auto *region = run; region != end && result == ESP_OK; ++region) {
+            result = sendRegionRows(*region);
+            if (shadow_fb_ != nullptr) {
+                updateShadow(*region);
+            }
+        }
+        ++stats_.partial_windows;
+        stats_.partial_window_us += esp_timer_get_time() - started;
+        run = end;
+    }
+
+    if (result != ESP_OK) {
+        partial_session_active_ = false;
+    }
+    return result;
+}
+
+/** @brief Program the window of @p region and stream its pixel rows into one RAM plane. */
+esp_err_t Driver::uploadWindow(const Region &region, uint8_t ram_cmd) {
+    ESP_RETURN_ON_ERROR(setRamWindow(region.x, region.y, region.width, region.height), TAG,
+                        "region window");
+    ESP_RETURN_ON_ERROR(sendCommand(ram_cmd), TAG, "region cmd 0x%02X", ram_cmd);
+    if (ram_cmd == 0x24) {
+        ghost_.markWritten(region.x, region.y, region.width, region.height);
+        stats_.partial_window_bytes += static_cast<size_t>(region.width / 8) * region.height;
+    }
+    return sendRegionRows(region);
+}
+
+/**
+ * @brief Diff @p region against the shadow and upload the minimal set of row bands.
+ *
+ * Changed byte spans of consecutive rows are merged into one band while the bytes added by
+ * widening it (or by carrying unchanged rows) cost less than kWindowOverheadBytes; otherwise a
+ * new window is started. The region must lie inside controller RAM.
+ */
+esp_err_t Driver::uploadChanged(const Region &region, bool both_planes) {
+    const size_t row_bytes = region.width / 8;
+    const size_t stride = region.stride != 0 ? region.stride : row_bytes;
+    const uint8_t *shadow_origin = shadow_fb_ + region.y * kRamStride + region.x / 8;
+
+    bool band_open = false;
+    size_t band_first = 0;
+    size_t band_last = 0;
+    size_t band_row = 0;
+    size_t band_end = 0;  // one past the last changed row in the band
+    size_t sent_bytes = 0;
+
+    const auto flushBand = [&]() -> esp_err_t {
+        Region band;
+        band.x = static_cast<uint16_t>(region.x + band_first * 8);
+        band.y = static_cast<uint16_t>(region.y + band_row);
+        band.width = static_cast<uint16_t>((band_last - band_first + 1) * 8);
+        band.height = static_cast<uint16_t>(band_end - band_row);
+        band.data = region.data + band_row * stride + band_first;
+        band.stride = static_cast<uint16_t>(stride);
+        ESP_RETURN_ON_ERROR(uploadWindow(band), TAG, "changed band upload failed");
+        const size_t band_bytes = (band_last - band_first + 1) * band.height;
+        if (both_planes) {
+            ESP_RETURN_ON_ERROR(uploadWindow(band, 0x26), TAG, "changed band 0x26 failed");
+            ++stats_.old_plane_windows;
+            stats_.old_plane_bytes += band_bytes;
+        } else {
+            markOldPlaneStale(band);
+        }
+        updateShadow(band);
+        ++stats_.partial_windows;
+        sent_bytes += band_bytes;
+        return ESP_OK;
+    };
+
+    for (size_t row = 0; row < region.height; ++row) {
+        size_t first = 0;
+        size_t last = 0;
+        if (!changedSpan(region.data + row * stride, shadow_origin + row * kRamStride, row_bytes,
+                         first, last)) {
+            continue;
+        }
+        if (band_open) {
+            const size_t merged_first = std::min(first, band_first);
+            const size_t merged_last = std::max(last, band_last);
+            const size_t merged = (row + 1 - band_row) * (merged_last - merged_first + 1);
+            const size_t separate = (band_end - band_row) * (band_last - band_first + 1) +
+                                    (last - first + 1) + kWindowOverheadBytes;
+            if (merged <= separate) {
+                band_first = merged_first;
+                band_last = merged_last;
+                band_end = row + 1;
+                continue;
+            }
+            ESP_RETURN_ON_ERROR(flushBand(), TAG, "band flush failed");
+        }
+        band_open = true;
+        band_first = first;
+        band_last = last;
+        band_row = row;
+        band_end = row + 1;
+    }
+    if (band_open) {
+        ESP_RETURN_ON_ERROR(flushBand(), TAG, "band flush failed");
+    }
+
+    stats_.unchanged_bytes += row_bytes * region.height - std::min(sent_bytes,
+                                                                   row_bytes * region.height);
+    return ESP_OK;
+}
+
+/**
+ * @brief Add @p rect to the list of areas where 0x26 lags behind.
+ *
+ * A rectangle continuing the previous one downwards extends it; when the list is full every
+ * entry collapses into their bounding box.
+ */
+void Driver::markOldPlaneStale(const Region &rect) {
+    if (stale_old_count_ > 0) {
+        Region &prev = stale_old_[stale_old_count_ - 1];
+        if (prev.x == rect.x && prev.width == rect.width && prev.y + prev.height == rect.y) {
+            prev.height += rect.height;
+            return;
+        }
+    }
+    if (stale_old_count_ < stale_old_.size()) {
+        Region &entry = stale_old_[stale_old_count_++];
+        entry = {rect.x, rect.y, rect.width, rect.height};
+        return;
+    }
+
+    uint16_t x0 = rect.x;
+    uint16_t y0 = rect.y;
+    uint16_t x1 = rect.x + rect.width;
+    uint16_t y1 = rect.y + rect.height;
+    for (const Region &entry : stale_old_) {
+        x0 = std::min(x0, entry.x);
+        y0 = std::min(y0, entry.y);
+        x1 = std::max<uint16_t>(x1, entry.x + entry.width);
+        y1 = std::max<uint16_t>(y1, entry.y + entry.height);
+    }
+    stale_old_[0] = {x0, y0, static_cast<uint16_t>(x1 - x0), static_cast<uint16_t>(y1 - y0)};
+    stale_old_count_ = 1;
+}
+
+void Driver::resetOldPlane() {
+    stale_old_count_ = 0;
+    stale_old_shown_ = false;
+}
+
+/**
+ * @brief Bring 0x26 up to date for every rectangle a refresh has already shown.
+ *
+ * Runs before the next RAM write or refresh, while the shadow still equals what the panel
+ * displays. Rectangles not yet shown are left alone: the coming refresh needs their old image.
+ */
+esp_err_t Driver::syncOldPlane() {
+    if (!stale_old_shown_) {
+        return ESP_OK;
+    }
+    if (!shadowActive()) {
+        resetOldPlane();
+        return ESP_OK;
+    }
+
+    esp_err_t result = ESP_OK;
+    for (size_t i = 0; i < stale_old_count_ && result == ESP_OK; ++i) {
+        Region rect = stale_old_[i];
+        rect.data = shadow_fb_ + rect.y * kRamStride + rect.x / 8;
+        rect.stride = kRamStride;
+        result = uploadWindow(rect, 0x26);
+        ++stats_.old_plane_windows;
+        stats_.old_plane_bytes += static_cast<size_t>(rect.width / 8) * rect.height;
+    }
+    resetOldPlane();
+    if (result != ESP_OK) {
+        // 0x26 is now unknown; the next clear() or loadBaseMap() rewrites both planes.
+        shadow_fb_valid_ = false;
+    }
+    return result;
+}
+
+/** @brief Copy the last uploaded frame regions into 0x26 and wait for the transfer. */
+esp_err_t Driver::replayFrameToOldPlane() {
+    for (size_t i = 0; i < frame_replay_count_; ++i) {
+        const Region &region = frame_regions_[i];
+        ESP_RETURN_ON_ERROR(uploadWindow(region, 0x26), TAG, "previous image replay failed");
+        ++stats_.old_plane_windows;
+        stats_.old_plane_bytes += static_cast<size_t>(region.width / 8) * region.height;
+    }
+    frame_replay_count_ = 0;
+    return waitUploadDone();
+}
+
+/**
+ * @brief Flip every pixel of the due tiles to its inverse and back, then resync 0x26.
+ *
+ * Each pass makes the two planes differ on the whole tile, so display mode 2 drives every
+ * pixel instead of only the ones that changed recently. Other tiles keep equal planes and are
+ * not touched.
+ */
+esp_err_t Driver::flashDueTiles() {
+    ESP_RETURN_ON_ERROR(beginPartialSession(), TAG, "partial session setup failed");
+
+    std::bitset<GhostBudget::kTileCount> due;
+    for (size_t tile = 0; tile < GhostBudget::kTileCount; ++tile) {
+        due[tile] = ghost_.count(tile) >= cfg_.ghost_budget;
+    }
+
+    for (const bool to_inverse : {true, false}) {
+        for (size_t tile = 0; tile < GhostBudget::kTileCount; ++tile) {
+            if (!due[tile]) {
+                continue;
+            }
+            if (!to_inverse) {
+                ESP_RETURN_ON_ERROR(writeShadowTile(tile, true, 0x26), TAG, "tile 0x26 failed");
+            }
+            ESP_RETURN_ON_ERROR(writeShadowTile(tile, to_inverse, 0x24), TAG, "tile 0x24 failed");
+        }
+        ESP_RETURN_ON_ERROR(partialUpdate(), TAG, "cleaning refresh failed");
+        ++stats_.cleaning_refreshes;
+    }
+
+    for (size_t tile = 0; tile < GhostBudget::kTileCount; ++tile) {
+        if (!due[tile]) {
+            continue;
+        }
+        ESP_RETURN_ON_ERROR(writeShadowTile(tile, false, 0x26), TAG, "tile resync failed");
+        ghost_.tileCleaned(tile);
+        ++stats_.cleaned_tiles;
+    }
+    return ESP_OK;
+}
+
+/** @brief Pack one tile of the shadow into row staging and upload it; waits for the DMA. */
+esp_err_t Driver::writeShadowTile(size_t tile, bool inverted, uint8_t ram_cmd) {
+    constexpr size_t kTileRowBytes = GhostBudget::kTileWidth / 8;
+    static_assert(kTileRowBytes * GhostBudget::kTileHeight <= kRowStagingBytes,
+                  "a tile must fit one staging half");
+    ESP_RETURN_ON_ERROR(waitUploadDone(), TAG, "staging still in flight");
+    uint8_t *pixels = row_staging_;
+
+    const Region rect = GhostBudget::tileRect(tile);
+    const uint8_t mask = inverted ? 0xFF : 0x00;
+    for (size_t row = 0; row < GhostBudget::kTileHeight; ++row) {
+        const uint8_t *src = shadow_fb_ + (rect.y + row) * kRamStride + rect.x / 8;
+        for (size_t i = 0; i < kTileRowBytes; ++i) {
+            pixels[row * kTileRowBytes + i] = static_cast<uint8_t>(src[i] ^ mask);
+        }
+    }
+
+    ESP_RETURN_ON_ERROR(setRamWindow(rect.x, rect.y, rect.width, rect.height), TAG, "tile window");
+    ESP_RETURN_ON_ERROR(sendCommand(ram_cmd), TAG, "tile cmd 0x%02X", ram_cmd);
+    ESP_RETURN_ON_ERROR(sendPixels(pixels, kTileRowBytes * GhostBudget::kTileHeight), TAG,
+                        "tile pixels");
+    return waitUploadDone();
+}
+
+/** @brief Mirror the rows of @p region into the shadow framebuffer. */
+void Driver::updateShadow(const Region &region) {
+    if (shadow_fb_ == nullptr) {
+        return;
+    }
+    const size_t row_bytes = region.width / 8;
+    const size_t stride = region.stride != 0 ? region.stride : row_bytes;
+    uint8_t *dst = shadow_fb_ + region.y * kRamStride + region.x / 8;
+    const uint8_t *src = region.data;
+    for (uint16_t row = 0; row < region.height; ++row) {
+        std::memcpy(dst, src, row_bytes);
+        dst += kRamStride;
+        src += stride;
+    }
 }
 
 }  // namespace epd
@@ -1,17 +1,43 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 
 #include "driver/gpio.h"
 #include "driver/spi_master.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "ghost_budget.h"
+#include "sdkconfig.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
 
 namespace epd {
 
 constexpr int kWidth = 480;
 constexpr int kHeight = 800;
 constexpr int kBufferSize = kWidth * kHeight / 8;
+/** @brief Controller RAM is addressed landscape: x spans kHeight pixels, y spans kWidth rows. */
+constexpr int kRamColumns = kHeight;
+constexpr int kRamRows = kWidth;
+/** @brief Bytes of a full-screen 2bpp grayscale image (four pixels per byte). */
+constexpr int kGrayBufferSize = kBufferSize * 2;
+/** @brief Number of SPI transactions the driver keeps in flight (matches the device queue). */
+constexpr size_t kSpiQueueDepth = 7;
+/** @brief Regions staged per frame before they are uploaded early to make room. */
+constexpr size_t kMaxFrameRegions = 32;
+/** @brief Approximate cost of programming one extra RAM window, expressed in pixel bytes. */
+constexpr size_t kWindowOverheadBytes = 64;
+/**
+ * @brief Address and length granularity spi_master can DMA straight from a TX buffer.
+ *
+ * Any other buffer is copied into a freshly allocated DMA buffer for the transaction.
+ */
+constexpr size_t kDmaAlignment = 4;
 
 /** @brief SPI + GPIO configuration required by the e-paper panel. */
 struct Config {
@@ -23,8 +49,129 @@ struct Config {
     gpio_num_t rst = GPIO_NUM_NC;
     gpio_num_t busy = GPIO_NUM_NC;
     int clk_speed_hz = 10 * 1000 * 1000;
+    /** @brief Largest single SPI transaction used when streaming pixel data. */
+    size_t transfer_chunk_bytes = 4096;
+    /**
+     * @brief Queue pixel uploads as DMA transactions instead of polling them out.
+     *
+     * When enabled, bitmap uploads return as soon as the data is queued; the caller must keep
+     * the buffer alive until waitUploadDone() returns or the next driver command is issued.
+     */
+    bool async_upload = false;
+    /**
+     * @brief Keep the controller configured between partial windows.
+     *
+     * When true the reset and 0x18/0x3C setup run once per session instead of before every
+     * window; a session ends on full refresh, deep sleep or any command error.
+     */
+    bool partial_session = true;
+    /** @brief Drop register and LUT writes whose value already matches the controller. */
+    bool register_cache = true;
+    /**
+     * @brief Keep a kBufferSize copy of RAM 0x24 and upload only the bytes that changed.
+     *
+     * The shadow becomes authoritative after clear() or loadBaseMap(). It is also the source
+     * the driver uses to bring RAM 0x26 (the previous image) up to date after each refresh;
+     * without it 0x26 is only rewritten by drawBitmap() and waiting commitFrame() calls.
+     */
+    bool shadow_framebuffer = false;
+    /**
+     * @brief Partial refreshes a GhostBudget tile may take before it is due for cleaning.
+     *
+     * 0 disables the scheduler. Due tiles are cleaned by runCleaning(), which the application
+     * calls while the panel is idle.
+     */
+    uint16_t ghost_budget = 0;
+    /** @brief Tile count at which a partial commitFrame() becomes a full refresh; 0 = never. */
+    uint16_t ghost_hard_budget = 0;
+    /** @brief Due tiles from which runCleaning() uses one full refresh instead of tile flashes. */
+    uint16_t ghost_full_clean_tiles = GhostBudget::kTileCount / 2;
+    /**
+     * @brief Run the SPI device 3-wire half duplex so readTemperature() can read SDA back.
+     *
+     * The panel's SDA pin must be the only data line, wired to Config::mosi.
+     */
+    bool read_temperature = false;
+};
+
+/** @brief How a committed frame is shown on the panel. */
+enum class RefreshMode : uint8_t {
+    kNone,     ///< Upload only; refresh later with triggerRefresh().
+    kPartial,  ///< Partial-update sequence (0x22 = 0xFF).
+    kFull,     ///< Full refresh with the default waveform.
+    kFast,     ///< Full refresh with the fast waveform.
 };
 
+/** @brief A 1bpp bitmap placed in controller RAM coordinates (see kRamColumns/kRamRows). */
+struct Region {
+    uint16_t x = 0;          ///< Left edge in pixels; must be a multiple of 8.
+    uint16_t y = 0;          ///< Top row.
+    uint16_t width = 0;      ///< Width in pixels; must be a multiple of 8.
+    uint16_t height = 0;     ///< Number of rows.
+    const uint8_t *data = nullptr;
+    uint16_t stride = 0;     ///< Bytes between rows; 0 means width / 8.
+};
+
+/** @brief Cumulative SPI transfer counters, used for profiling uploads. */
+struct TransferStats {
+    uint32_t transactions = 0;
+    uint64_t data_bytes = 0;
+    /** @brief Time spent blocked waiting for a free queue slot or a completed transfer. */
+    int64_t queue_wait_us = 0;
+    /** @brief Time spent blocked waiting for the BUSY line to drop. */
+    int64_t busy_wait_us = 0;
+    /** @brief Partial RAM windows written and the time spent issuing them. */
+    uint32_t partial_windows = 0;
+    int64_t partial_window_us = 0;
+    /** @brief Pixel bytes those windows wrote to RAM 0x24. */
+    uint64_t partial_window_bytes = 0;
+    /** @brief Hardware resets issued through the RST line. */
+    uint32_t controller_resets = 0;
+    /** @brief Commands (and their command + payload bytes) elided by the register cache. */
+    uint32_t skipped_commands = 0;
+    uint64_t skipped_bytes = 0;
+    /** @brief Pixel bytes the shadow framebuffer found unchanged and did not send. */
+    uint64_t unchanged_bytes = 0;
+    /** @brief Windows and bytes written to RAM 0x26 to bring the previous image up to date. */
+    uint32_t old_plane_windows = 0;
+    uint64_t old_plane_bytes = 0;
+    /** @brief Tiles cleaned by runCleaning() and the refreshes it issued to do so. */
+    uint32_t cleaned_tiles = 0;
+    uint32_t cleaning_refreshes = 0;
+    /** @brief Partial commits turned into full refreshes by Config::ghost_hard_budget. */
+    uint32_t forced_full_refreshes = 0;
+    /** @brief Grayscale refreshes and the time spent splitting gray pixels into planes. */
+    uint32_t gray_refreshes = 0;
+    int64_t gray_split_us = 0;
+    /** @brief Full refreshes driven by a register LUT, and how many of them had to send it. */
+    uint32_t lut_refreshes = 0;
+    uint32_t lut_uploads = 0;
+    /** @brief Times the temperature moved the waveform selection to another band. */
+    uint32_t waveform_band_changes = 0;
+    /**
+     * @brief TX buffers spi_master had to bounce through a temporary DMA allocation.
+     *
+     * Unaligned head and tail bytes are sent inline (tx_data) instead, so this stays 0 unless
+     * a caller passes memory that is not DMA capable.
+     */
+    uint32_t dma_bounce_transfers = 0;
+    /** @brief Queued transfers that carried unaligned edge bytes inline to avoid a bounce. */
+    uint32_t inline_edge_transfers = 0;
+};
+
+/**
+ * @brief Split 2bpp gray pixels into the two RAM bit planes used by the 4-gray waveform.
+ *
+ * @p gray holds @p pixels / 4 bytes, MSB first, 0 = black .. 3 = white; @p pixels must be a
+ * multiple of 8. Low bits go to @p plane24 and high bits to @p plane26, one bit per pixel.
+ */
+void splitGrayPlanes(const uint8_t *gray, size_t pixels, uint8_t *plane24, uint8_t *plane26);
+
+/** @brief Invoked from the SPI ISR once the last queued transaction of an upload completes. */
+using UploadDoneCallback = void (*)(void *user_ctx);
+/** @brief Invoked from the BUSY GPIO ISR when a display refresh has finished. */
+using RefreshDoneCallback = void (*)(void *user_ctx);
+
 class Driver {
   public:
     Driver() = default;
@@ -49,6 +196,21 @@ class Driver {
                             uint16_t x_startD, uint16_t y_startD, const uint8_t *datasD,
                             uint16_t x_startE, uint16_t y_startE, const uint8_t *datasE,
                             uint16_t part_column, uint16_t part_line);
+    /**
+     * @brief Split a 2bpp region into RAM 0x24/0x26 (see splitGrayPlanes) without refreshing.
+     *
+     * Region::x and Region::width must be multiples of 8; Region::stride, if set, counts 2bpp
+     * bytes. The source buffer may be reused as soon as the call returns.
+     */
+    esp_err_t writeGrayRegion(const Region &region);
+    /**
+     * @brief Refresh the whole panel with the 4-gray waveform.
+     *
+     * Pixels outside the written gray regions keep their 1-bit image only where 0x26 equals
+     * 0x24, which the shadow framebuffer guarantees. Afterwards both planes hold gray bits
+     * rather than a previous image, so return to 1-bit updates with clear() or loadBaseMap().
+     */
+    esp_err_t refreshGray(bool wait = true);
     /** @brief Upload a single-bit bitmap and trigger a partial refresh. 
      *  @param skip_refresh If true, only upload data without triggering refresh (for batching).
      */
@@ -56,37 +218,234 @@ class Driver {
                          uint16_t width_bits, uint16_t height_rows, bool skip_refresh = false);
     /** @brief Trigger a partial refresh without uploading new data. */
     esp_err_t triggerRefresh();
+    /** @brief Start a partial refresh and return without waiting for the panel. */
+    esp_err_t triggerRefreshAsync();
+    /** @brief Start a full-LUT refresh and return without waiting for the panel. */
+    esp_err_t triggerFullRefreshAsync(bool fast_mode);
+    /** @brief Block until a refresh started earlier has completed, or @p timeout expires. */
+    esp_err_t waitRefreshDone(TickType_t timeout = portMAX_DELAY);
+    /** @brief True while a started refresh has not been observed to finish. */
+    bool refreshInProgress() const;
+    /** @brief Register a callback fired (in ISR context) when a refresh completes. */
+    void setRefreshDoneCallback(RefreshDoneCallback callback, void *user_ctx);
+    /** @brief esp_timer time the last refresh was triggered (0 = none); safe from any task. */
+    int64_t lastRefreshStartUs() const { return refresh_started_us_.load(); }
+    /**
+     * @brief Measure the panel temperature with the controller's internal sensor.
+     *
+     * Needs Config::read_temperature. The result is also applied as with setTemperature().
+     */
+    esp_err_t readTemperature(int &celsius);
+    /** @brief Supply the panel temperature from another sensor; selects the waveform band. */
+    void setTemperature(int celsius);
+    /** @brief Last temperature measured or supplied, or kTemperatureUnknown. */
+    int temperature() const { return temperature_; }
+    static constexpr int kTemperatureUnknown = -128;
     /** @brief Request the display controller to enter deep sleep. */
     esp_err_t deepSleep();
 
+    /** @brief Open a frame transaction; regions are staged until commitFrame(). */
+    esp_err_t beginFrame();
+    /**
+     * @brief Validate, clip and stage one region of the open frame.
+     *
+     * The bitmap must stay valid until commitFrame() or flushFrame() returns.
+     */
+    esp_err_t addRegion(const Region &region);
+    /**
+     * @brief Upload the staged regions now without refreshing; the frame stays open.
+     *
+     * @param wait_upload When false, return once the pixels are queued (see Config::async_upload);
+     *        the bitmaps must then stay valid until the next driver call or waitUploadDone().
+     */
+    esp_err_t flushFrame(bool wait_upload = true);
+    /**
+     * @brief Upload every staged region in window order and trigger exactly one refresh.
+     *
+     * @param wait_refresh When false, return once the refresh has started (see waitRefreshDone).
+     */
+    esp_err_t commitFrame(RefreshMode mode = RefreshMode::kPartial, bool wait_refresh = true);
+    /** @brief Drop the open frame and anything staged in it. */
+    void abortFrame();
+    /** @brief True between beginFrame() and commitFrame()/abortFrame(). */
+    bool frameOpen() const { return frame_open_; }
+    /** @brief Reset and configure the controller for a run of partial window writes. */
+    esp_err_t beginPartialSession();
+    /** @brief Forget the partial configuration so the next window starts a fresh session. */
+    void endPartialSession() { partial_session_active_ = false; }
+
+    /** @brief True when some tile has used up Config::ghost_budget partial refreshes. */
+    bool cleaningDue() const;
+    /**
+     * @brief Clean every tile over budget, blocking for the refreshes this takes.
+     *
+     * With an authoritative shadow the due tiles are flashed to their inverse and back by two
+     * partial refreshes; otherwise, or when many tiles are due, one full refresh is used.
+     */
+    esp_err_t runCleaning();
+    /** @brief Per-tile partial refresh counts. */
+    const GhostBudget &ghostBudget() const { return ghost_; }
+
+    /** @brief Register a callback fired (in ISR context) when a queued upload has drained. */
+    void setUploadDoneCallback(UploadDoneCallback callback, void *user_ctx);
+    /** @brief Block until every queued pixel transfer has completed. */
+    esp_err_t waitUploadDone(TickType_t timeout = portMAX_DELAY);
+    /** @brief True while queued pixel transfers are still outstanding. */
+    bool uploadPending() const { return in_flight_ > 0; }
+    /** @brief Counters accumulated since init() or the last resetTransferStats(). */
+    const TransferStats &transferStats() const { return stats_; }
+    /** @brief Zero the transfer counters. */
+    void resetTransferStats() { stats_ = {}; }
+
   private:
+    static constexpr size_t kShadowedRegisterCount = 12;
+    static constexpr size_t kLutBytes = 110;
+
+    /** @brief Last payload written to a cacheable controller register. */
+    struct RegisterShadow {
+        uint8_t cmd{0};
+        uint8_t len{0};
+        bool valid{false};
+        std::array<uint8_t, 5> value{};
+    };
+
+    /** @brief Transaction plus the per-transfer state needed by the SPI callbacks. */
+    struct TransferSlot {
+        spi_transaction_t trans{};
+        Driver *owner{nullptr};
+        bool dc_level{false};
+        bool notify{false};
+    };
+
     Config cfg_{};
     spi_device_handle_t spi_{nullptr};
+    /** @brief Set once init() owns cfg_.host, so a failed init() never frees a foreign bus. */
+    bool spi_bus_initialised_{false};
     bool initialised_{false};
+    std::array<TransferSlot, kSpiQueueDepth> slots_{};
+    size_t next_slot_{0};
+    size_t in_flight_{0};
+    TransferSlot polling_slot_{};
+    UploadDoneCallback upload_cb_{nullptr};
+    void *upload_cb_ctx_{nullptr};
+    TransferStats stats_{};
+    SemaphoreHandle_t busy_sem_{nullptr};
+    bool busy_isr_installed_{false};
+#if CONFIG_PM_ENABLE
+    /** @brief Held while waiting on BUSY, whose edge cannot wake the chip from light sleep. */
+    esp_pm_lock_handle_t busy_pm_lock_{nullptr};
+#endif
+    bool refresh_pending_{false};
+    bool partial_session_active_{false};
+    std::array<RegisterShadow, kShadowedRegisterCount> shadow_{};
+    std::array<uint8_t, kLutBytes> lut_shadow_{};
+    bool lut_shadow_valid_{false};
+    uint8_t *shadow_fb_{nullptr};
+    /** @brief Two DMA-capable chunk pairs (0x24 + 0x26) used by writeGrayRegion(). */
+    uint8_t *gray_scratch_{nullptr};
+    /** @brief Two DMA-capable halves that gather strided rows into whole transfers. */
+    uint8_t *row_staging_{nullptr};
+    bool shadow_fb_valid_{false};
+    std::array<Region, kMaxFrameRegions> frame_regions_{};
+    size_t frame_region_count_{0};
+    bool frame_open_{false};
+    /** @brief Leading frame_regions_ entries of the last upload, replayable into 0x26. */
+    size_t frame_replay_count_{0};
+    /** @brief False once part of the open frame was uploaded early and its regions dropped. */
+    bool frame_replay_ok_{false};
+    /** @brief RAM rectangles (data unused) where 0x26 still lags behind 0x24. */
+    std::array<Region, kMaxFrameRegions> stale_old_{};
+    size_t stale_old_count_{0};
+    /** @brief Set once a refresh has shown the stale rectangles, so 0x26 may catch up. */
+    bool stale_old_shown_{false};
+    GhostBudget ghost_{};
+    int temperature_{kTemperatureUnknown};
+    /** @brief Index into the waveform band table, or -1 while the temperature is unknown. */
+    int waveform_band_{-1};
+    std::atomic<bool> refresh_notify_{false};
+    std::atomic<int64_t> refresh_started_us_{0};
+    RefreshDoneCallback refresh_cb_{nullptr};
+    void *refresh_cb_ctx_{nullptr};
+
+    /** @brief Allocate buffers and set up GPIO, the BUSY ISR and SPI; the body of init(). */
+    esp_err_t acquireResources();
+    /** @brief Undo whatever acquireResources() got to, in reverse order; safe to call twice. */
+    void releaseResources();
+    /** @brief SPI pre-transfer hook that drives DC for the transaction about to start. */
+    static void preTransferCallback(spi_transaction_t *trans);
+    /** @brief SPI post-transfer hook that reports the end of a queued upload. */
+    static void postTransferCallback(spi_transaction_t *trans);
+    /** @brief Falling-edge ISR on BUSY that wakes waiters and reports refresh completion. */
+    static void busyIsr(void *arg);
 
     /** @brief Toggle the reset pin low/high with the required delay. */
-    void reset() const;
-    /** @brief Poll the BUSY pin until the controller is ready. */
-    void waitWhileBusy() const;
+    void reset();
+    /** @brief Forget every cached register and LUT value. */
+    void invalidateShadow();
+    /** @brief Locate the shadow entry for @p cmd, or nullptr if the command is not cached. */
+    RegisterShadow *shadowFor(uint8_t cmd);
+    /** @brief Sleep on the BUSY interrupt until the controller is ready. */
+    esp_err_t waitWhileBusy(TickType_t timeout = portMAX_DELAY);
     /** @brief Send a single command byte over SPI. */
     esp_err_t sendCommand(uint8_t cmd);
     /** @brief Send a command followed by an optional payload. */
     esp_err_t sendCommand(uint8_t cmd, const uint8_t *data, size_t len);
     /** @brief Send a raw data buffer with the DC pin set high. */
     esp_err_t sendData(const uint8_t *data, size_t len);
-    /** @brief Load the default LUT table (temperature-based). */
-    esp_err_t writeLutDefault();
-    /** @brief Load the fast update LUT table. */
-    esp_err_t writeLutFast();
+    /** @brief Stream pixel data, queuing DMA transactions when async uploads are enabled. */
+    esp_err_t sendPixels(const uint8_t *data, size_t len);
+    /** @brief Wait for the oldest queued transaction and release its slot. */
+    esp_err_t reclaimSlot(TickType_t timeout);
+    /** @brief Run one blocking transaction, draining queued transfers first. */
+    esp_err_t transmitPolling(bool dc_level, const uint8_t *data, size_t len);
+    /** @brief Read @p len (at most 4) bytes returned by the controller for @p cmd. */
+    esp_err_t readRegister(uint8_t cmd, uint8_t *data, size_t len);
+    /** @brief Register waveform for the current band, or nullptr to use the OTP table. */
+    const uint8_t *selectWaveform(bool fast_mode) const;
     /** @brief Write a LUT blob to the controller registers. */
     esp_err_t writeLut(const uint8_t *waveform);
-    /** @brief Trigger a display update sequence. */
-    esp_err_t updatePanel(bool fast_mode);
-    /** @brief Trigger a partial update sequence. */
-    esp_err_t partialUpdate();
+    /** @brief Trigger a display update sequence, optionally waiting for it to finish. */
+    esp_err_t updatePanel(bool fast_mode, bool wait = true);
+    /** @brief Trigger a partial update sequence, optionally waiting for it to finish. */
+    esp_err_t partialUpdate(bool wait = true);
+    /** @brief Send the 0x22/0x20 activation pair and mark a refresh as pending. */
+    esp_err_t activateRefresh(uint8_t control, bool wait);
     /** @brief Upload a bitmap into a selected RAM window. */
     esp_err_t writePartialWindow(uint16_t x_start, uint16_t y_start, const uint8_t *datas,
                                  uint16_t part_column, uint16_t part_line);
+    /** @brief Program the RAM window/cursor (0x44/0x45/0x4E/0x4F) and stream 0x24 data. */
+    esp_err_t sendWindow(uint16_t x_start, uint16_t y_start, const uint8_t *datas,
+                         uint16_t part_column, uint16_t part_line);
+    /** @brief Program the RAM window and move the address counter to its top-left corner. */
+    esp_err_t setRamWindow(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+    /** @brief Stream a region's rows, in one burst when they are contiguous. */
+    esp_err_t sendRegionRows(const Region &region);
+    /** @brief Sort, merge and upload the staged regions, then clear the staging list. */
+    esp_err_t uploadStagedRegions();
+    /** @brief Set the window for @p region, issue @p ram_cmd (0x24 or 0x26) and stream its rows. */
+    esp_err_t uploadWindow(const Region &region, uint8_t ram_cmd = 0x24);
+    /**
+     * @brief Upload only the row bands of @p region that differ from the shadow framebuffer.
+     *
+     * @param both_planes Write each band to 0x26 as well, for when the planes start out equal.
+     */
+    esp_err_t uploadChanged(const Region &region, bool both_planes = false);
+    /** @brief Record that 0x24 changed inside @p rect while 0x26 kept the older image. */
+    void markOldPlaneStale(const Region &rect);
+    /** @brief Forget the stale list, e.g. after both planes were rewritten. */
+    void resetOldPlane();
+    /** @brief Copy rectangles already shown by a refresh from the shadow into RAM 0x26. */
+    esp_err_t syncOldPlane();
+    /** @brief Rewrite the regions of the frame just refreshed into 0x26 (no-shadow path). */
+    esp_err_t replayFrameToOldPlane();
+    /** @brief Drive the due tiles to their inverse and back with two partial refreshes. */
+    esp_err_t flashDueTiles();
+    /** @brief Write one shadow tile, optionally inverted, into RAM plane @p ram_cmd. */
+    esp_err_t writeShadowTile(size_t tile, bool inverted, uint8_t ram_cmd);
+    /** @brief Copy @p region into the shadow framebuffer. */
+    void updateShadow(const Region &region);
+    /** @brief True when uploads can be diffed against an authoritative shadow. */
+    bool shadowActive() const { return shadow_fb_ != nullptr && shadow_fb_valid_; }
 };
 
 }  // namespace epd
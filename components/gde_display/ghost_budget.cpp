@@ -0,0 +1,61 @@
+#include "ghost_budget.h"
+
+#include <algorithm>
+
+#include "epd_driver.h"
+
+namespace epd {
+
+static_assert(GhostBudget::kTileColumns * GhostBudget::kTileWidth == kRamColumns,
+              "tile grid must cover the RAM width");
+static_assert(GhostBudget::kTileRows * GhostBudget::kTileHeight == kRamRows,
+              "tile grid must cover the RAM height");
+
+void GhostBudget::reset() {
+    counts_.fill(0);
+    dirty_.reset();
+}
+
+void GhostBudget::markWritten(uint16_t x, uint16_t y, uint16_t width, uint16_t height) {
+    if (width == 0 || height == 0 || x >= kRamColumns || y >= kRamRows) {
+        return;
+    }
+    const size_t col_first = x / kTileWidth;
+    const size_t col_last = std::min<size_t>((x + width - 1u) / kTileWidth, kTileColumns - 1);
+    const size_t row_first = y / kTileHeight;
+    const size_t row_last = std::min<size_t>((y + height - 1u) / kTileHeight, kTileRows - 1);
+    for (size_t row = row_first; row <= row_last; ++row) {
+        for (size_t col = col_first; col <= col_last; ++col) {
+            dirty_.set(row * kTileColumns + col);
+        }
+    }
+}
+
+void GhostBudget::partialRefreshed() {
+    for (size_t tile = 0; tile < kTileCount; ++tile) {
+        if (dirty_.test(tile) && counts_[tile] < UINT16_MAX) {
+            ++counts_[tile];
+        }
+    }
+    dirty_.reset();
+}
+
+size_t GhostBudget::tilesAtLeast(uint16_t budget) const {
+    return static_cast<size_t>(std::count_if(counts_.begin(), counts_.end(),
+                                             [budget](uint16_t c) { return c >= budget; }));
+}
+
+uint16_t GhostBudget::maxCount() const {
+    return *std::max_element(counts_.begin(), counts_.end());
+}
+
+Region GhostBudget::tileRect(size_t tile) {
+    Region rect;
+    rect.x = static_cast<uint16_t>((tile % kTileColumns) * kTileWidth);
+    rect.y = static_cast<uint16_t>((tile / kTileColumns) * kTileHeight);
+    rect.width = kTileWidth;
+    rect.height = kTileHeight;
+    return rect;
+}
+
+}  // namespace epd
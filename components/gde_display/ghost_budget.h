@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+namespace epd {
+
+struct Region;
+
+/**
+ * @brief Per-tile count of partial refreshes since each tile was last cleaned.
+ *
+ * Controller RAM is split into a kTileColumns x kTileRows grid. Writes to RAM 0x24 mark tiles
+ * dirty; a partial refresh charges every dirty tile one unit of its ghosting budget and a full
+ * refresh clears the whole grid.
+ */
+class GhostBudget {
+  public:
+    static constexpr uint16_t kTileWidth = 80;
+    static constexpr uint16_t kTileHeight = 48;
+    static constexpr size_t kTileColumns = 10;
+    static constexpr size_t kTileRows = 10;
+    static constexpr size_t kTileCount = kTileColumns * kTileRows;
+
+    /** @brief Forget every count and dirty mark. */
+    void reset();
+    /** @brief Mark the tiles overlapping the RAM rectangle as changed since the last refresh. */
+    void markWritten(uint16_t x, uint16_t y, uint16_t width, uint16_t height);
+    /** @brief Charge each dirty tile one partial refresh. */
+    void partialRefreshed();
+    /** @brief A full-waveform refresh cleans every tile. */
+    void fullRefreshed() { reset(); }
+    /** @brief Record that @p tile was cleaned individually. */
+    void tileCleaned(size_t tile) { counts_[tile] = 0; }
+
+    uint16_t count(size_t tile) const { return counts_[tile]; }
+    /** @brief Number of tiles whose count has reached @p budget. */
+    size_t tilesAtLeast(uint16_t budget) const;
+    /** @brief Highest count over all tiles. */
+    uint16_t maxCount() const;
+    /** @brief RAM rectangle covered by @p tile (data left unset). */
+    static Region tileRect(size_t tile);
+
+  private:
+    std::array<uint16_t, kTileCount> counts_{};
+    std::bitset<kTileCount> dirty_;
+};
+
+}  // namespace epd
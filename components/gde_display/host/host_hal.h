@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "driver/gpio.h"
+
+namespace epd::host {
+
+class Ssd1677Emulator;
+
+/**
+ * @brief Simulated time, in microseconds since start.
+ *
+ * Time only moves inside blocking HAL calls (delays, semaphore and SPI waits, polling
+ * transfers), so host CPU time spent in driver code is not counted.
+ */
+int64_t nowUs();
+/** @brief Let @p us of simulated time pass, running every event that falls due. */
+void advanceUs(int64_t us);
+
+/** @brief Per-transaction costs added to the wire time of every SPI transfer. */
+struct SpiTiming {
+    /** @brief CPU time to set up and finish one polling transaction. */
+    int64_t polling_overhead_us = 10;
+    /** @brief Gap between back-to-back queued transactions (ISR and DMA descriptor setup). */
+    int64_t queued_overhead_us = 20;
+};
+void setSpiTiming(const SpiTiming &timing);
+
+/**
+ * @brief Attach the emulator to the SPI bus and the given control pins.
+ *
+ * Every SPI transfer goes to @p panel with DC taken from @p dc; pass nullptr to detach.
+ */
+void connectPanel(Ssd1677Emulator *panel, gpio_num_t dc, gpio_num_t rst, gpio_num_t busy);
+
+/** @brief heap_caps allocation counters. */
+struct HeapStats {
+    uint32_t allocations = 0;
+    uint32_t frees = 0;
+    uint32_t dma_allocations = 0;
+    size_t bytes_in_use = 0;
+    size_t peak_bytes = 0;
+};
+HeapStats heapStats();
+
+}  // namespace epd::host
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_memory_utils.h"
+#include "host_hal.h"
+
+namespace {
+
+/** Free heap reported to callers that size buffers from it, roughly an ESP32-C6 after boot. */
+constexpr size_t kSimulatedHeapBytes = 400 * 1024;
+
+struct LogFilter {
+    esp_log_level_t fallback = ESP_LOG_INFO;
+    std::map<std::string, esp_log_level_t> tags;
+};
+
+LogFilter &logFilter() {
+    static LogFilter filter;
+    return filter;
+}
+
+epd::host::HeapStats g_heap;
+
+/** Allocation header so heap_caps_free() knows the size and can keep bytes_in_use exact. */
+struct alignas(std::max_align_t) BlockHeader {
+    size_t size;
+    void *base;
+};
+
+void *track(void *base, void *user, size_t size, uint32_t caps) {
+    auto *header = static_cast<BlockHeader *>(user) - 1;
+    header->size = size;
+    header->base = base;
+    ++g_heap.allocations;
+    if (caps & MALLOC_CAP_DMA) {
+        ++g_heap.dma_allocations;
+    }
+    g_heap.bytes_in_use += size;
+    g_heap.peak_bytes = std::max(g_heap.peak_bytes, g_heap.bytes_in_use);
+    return user;
+}
+
+}  // namespace
+
+epd::host::HeapStats epd::host::heapStats() {
+    return g_heap;
+}
+
+extern "C" {
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:
+            return "ESP_OK";
+        case ESP_FAIL:
+            return "ESP_FAIL";
+        case ESP_ERR_NO_MEM:
+            return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG:
+            return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE:
+            return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE:
+            return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND:
+            return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED:
+            return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT:
+            return "ESP_ERR_TIMEOUT";
+        default:
+            return "UNKNOWN ERROR";
+    }
+}
+
+void _esp_error_check_failed(esp_err_t rc, const char *file, int line, const char *function,
+                             const char *expression) {
+    std::fprintf(stderr, "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d\n", rc,
+                 esp_err_to_name(rc), file, line);
+    std::fprintf(stderr, "func: %s\nexpression: %s\n", function, expression);
+    std::abort();
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    LogFilter &filter = logFilter();
+    if (std::string(tag) == "*") {
+        filter.fallback = level;
+        filter.tags.clear();
+        return;
+    }
+    filter.tags[tag] = level;
+}
+
+uint32_t esp_log_timestamp(void) {
+    return static_cast<uint32_t>(epd::host::nowUs() / 1000);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    const LogFilter &filter = logFilter();
+    const auto it = filter.tags.find(tag);
+    const esp_log_level_t limit = it == filter.tags.end() ? filter.fallback : it->second;
+    if (level > limit) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    std::vfprintf(stdout, format, args);
+    va_end(args);
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+    return heap_caps_aligned_alloc(alignof(std::max_align_t), size, caps);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+    void *ptr = heap_caps_malloc(n * size, caps);
+    if (ptr != nullptr) {
+        std::memset(ptr, 0, n * size);
+    }
+    return ptr;
+}
+
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    alignment = std::max(alignment, alignof(BlockHeader));
+    const size_t reserve = sizeof(BlockHeader) + alignment;
+    auto *base = static_cast<uint8_t *>(std::malloc(size + reserve));
+    if (base == nullptr) {
+        return nullptr;
+    }
+    auto user = reinterpret_cast<uintptr_t>(base + sizeof(BlockHeader));
+    user = (user + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    return track(base, reinterpret_cast<void *>(user), size, caps);
+}
+
+void heap_caps_free(void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    const auto *header = static_cast<BlockHeader *>(ptr) - 1;
+    ++g_heap.frees;
+    g_heap.bytes_in_use -= header->size;
+    std::free(header->base);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    (void)caps;
+    const size_t used = g_heap.bytes_in_use;
+    return used >= kSimulatedHeapBytes ? 0 : kSimulatedHeapBytes - used;
+}
+
+bool esp_ptr_dma_capable(const void *p) {
+    return p != nullptr;
+}
+
+}  // extern "C"
@@ -0,0 +1,170 @@
+#include <array>
+
+#include "driver/gpio.h"
+#include "host_hal.h"
+#include "sim_internal.h"
+#include "ssd1677_emulator.h"
+
+namespace {
+
+struct Pin {
+    gpio_mode_t mode = GPIO_MODE_DISABLE;
+    gpio_int_type_t intr_type = GPIO_INTR_DISABLE;
+    bool intr_enabled = true;
+    uint32_t level = 0;
+    gpio_isr_t handler = nullptr;
+    void *handler_arg = nullptr;
+};
+
+std::array<Pin, GPIO_NUM_MAX> g_pins;
+bool g_isr_service = false;
+/** BUSY release time whose falling edge has already been delivered. */
+int64_t g_busy_edge_delivered = 0;
+
+bool valid(gpio_num_t gpio) {
+    return gpio >= 0 && gpio < GPIO_NUM_MAX;
+}
+
+/** @brief Pin whose falling-edge ISR should fire when the panel drops BUSY, or nullptr. */
+Pin *busyIsrPin() {
+    const epd::host::detail::PanelLink &link = epd::host::detail::panelLink();
+    if (link.panel == nullptr || !valid(link.busy) || !g_isr_service) {
+        return nullptr;
+    }
+    Pin &pin = g_pins[link.busy];
+    const bool falling = pin.intr_type == GPIO_INTR_NEGEDGE || pin.intr_type == GPIO_INTR_ANYEDGE;
+    return pin.handler != nullptr && pin.intr_enabled && falling ? &pin : nullptr;
+}
+
+}  // namespace
+
+namespace epd::host::detail {
+
+int64_t gpioNextEventUs() {
+    if (busyIsrPin() == nullptr) {
+        return kNoEvent;
+    }
+    const int64_t release = panelLink().panel->busyUntil();
+    return release > g_busy_edge_delivered ? release : kNoEvent;
+}
+
+void gpioRunEvent() {
+    g_busy_edge_delivered = panelLink().panel->busyUntil();
+    if (Pin *pin = busyIsrPin()) {
+        pin->handler(pin->handler_arg);
+    }
+}
+
+}  // namespace epd::host::detail
+
+extern "C" {
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    if (config == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < GPIO_NUM_MAX; ++i) {
+        if (config->pin_bit_mask & (1ULL << i)) {
+            g_pins[i].mode = config->mode;
+            g_pins[i].intr_type = config->intr_type;
+        }
+    }
+    return ESP_OK;
+}
+
+/** @brief Latch the level; a rising edge on the panel's RST pin resets the controller. */
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (!valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Pin &pin = g_pins[gpio_num];
+    const bool rising = pin.level == 0 && level != 0;
+    pin.level = level != 0 ? 1 : 0;
+
+    const epd::host::detail::PanelLink &link = epd::host::detail::panelLink();
+    if (rising && link.panel != nullptr && gpio_num == link.rst) {
+        link.panel->hardwareReset(epd::host::nowUs());
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) {
+        return 0;
+    }
+    const epd::host::detail::PanelLink &link = epd::host::detail::panelLink();
+    if (link.panel != nullptr && gpio_num == link.busy) {
+        return link.panel->busy(epd::host::nowUs()) ? 1 : 0;
+    }
+    return static_cast<int>(g_pins[gpio_num].level);
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t gpio_num, gpio_int_type_t intr_type) {
+    if (!valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_pins[gpio_num].intr_type = intr_type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_pins[gpio_num].intr_enabled = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num) {
+    if (!valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_pins[gpio_num].intr_enabled = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags) {
+    (void)intr_alloc_flags;
+    if (g_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    g_isr_service = true;
+    return ESP_OK;
+}
+
+void gpio_uninstall_isr_service(void) {
+    g_isr_service = false;
+    for (Pin &pin : g_pins) {
+        pin.handler = nullptr;
+        pin.handler_arg = nullptr;
+    }
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args) {
+    if (!g_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_pins[gpio_num].handler = isr_handler;
+    g_pins[gpio_num].handler_arg = args;
+    if (gpio_num == epd::host::detail::panelLink().busy) {
+        g_busy_edge_delivered = epd::host::nowUs();
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num) {
+    if (!g_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!valid(gpio_num)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    g_pins[gpio_num].handler = nullptr;
+    g_pins[gpio_num].handler_arg = nullptr;
+    return ESP_OK;
+}
+
+}  // extern "C"
@@ -0,0 +1,7 @@
+#pragma once
+
+/** @file Placement attributes are meaningless on the host. */
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
@@ -0,0 +1,16 @@
+#pragma once
+
+/** @file Memory region queries; the host has a single flat heap. */
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Every host pointer is treated as DMA capable. */
+bool esp_ptr_dma_capable(const void *p);
+
+#ifdef __cplusplus
+}
+#endif
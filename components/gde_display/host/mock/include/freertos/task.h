@@ -0,0 +1,28 @@
+#pragma once
+
+/**
+ * @file The task API needed by single-task code.
+ *
+ * There is no scheduler: blocking calls advance the simulated clock and run whatever SPI, GPIO
+ * and timer events fall due in the meantime. xTaskCreate() therefore always fails, and code
+ * that offloads work to a task has to offer a way to run it from the caller instead.
+ */
+
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct tskTaskControlBlock *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created_task);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+
+#ifdef __cplusplus
+}
+#endif
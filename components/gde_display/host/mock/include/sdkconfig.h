@@ -0,0 +1,3 @@
+#pragma once
+
+/** @file Host build configuration: no Kconfig options are set, so optional features compile out. */
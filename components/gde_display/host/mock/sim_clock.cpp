@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "host_hal.h"
+#include "sim_internal.h"
+
+namespace epd::host {
+namespace {
+
+constexpr int64_t kTickUs = 1000000 / configTICK_RATE_HZ;
+
+int64_t g_now_us = 0;
+
+int64_t deadlineAfter(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? detail::kNoEvent : g_now_us + ticks * kTickUs;
+}
+
+}  // namespace
+
+int64_t nowUs() {
+    return g_now_us;
+}
+
+void advanceUs(int64_t us) {
+    detail::advanceTo(g_now_us + us);
+}
+
+void connectPanel(Ssd1677Emulator *panel, gpio_num_t dc, gpio_num_t rst, gpio_num_t busy) {
+    detail::panelLink() = {panel, dc, rst, busy};
+}
+
+namespace detail {
+
+PanelLink &panelLink() {
+    static PanelLink link;
+    return link;
+}
+
+bool runNextEvent(int64_t deadline) {
+    const int64_t gpio_at = gpioNextEventUs();
+    const int64_t spi_at = spiNextEventUs();
+    const int64_t timer_at = timerNextEventUs();
+    const int64_t next = std::min({gpio_at, spi_at, timer_at});
+    if (next == kNoEvent || next > deadline) {
+        return false;
+    }
+    g_now_us = std::max(g_now_us, next);
+    if (next == gpio_at) {
+        gpioRunEvent();
+    } else if (next == spi_at) {
+        spiRunEvent();
+    } else {
+        timerRunEvent();
+    }
+    return true;
+}
+
+void advanceTo(int64_t deadline) {
+    while (runNextEvent(deadline)) {
+    }
+    g_now_us = std::max(g_now_us, deadline);
+}
+
+void fatal(const char *what) {
+    std::fprintf(stderr, "host HAL: %s (t=%lld us)\n", what, static_cast<long long>(g_now_us));
+    std::abort();
+}
+
+}  // namespace detail
+}  // namespace epd::host
+
+using epd::host::detail::kNoEvent;
+
+/* esp_timer ------------------------------------------------------------------------------- */
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    int64_t next_us;
+    uint64_t period_us;
+    bool active;
+};
+
+namespace {
+
+std::vector<esp_timer *> &timers() {
+    static std::vector<esp_timer *> list;
+    return list;
+}
+
+}  // namespace
+
+namespace epd::host::detail {
+
+int64_t timerNextEventUs() {
+    int64_t next = kNoEvent;
+    for (const esp_timer *t : timers()) {
+        if (t->active) {
+            next = std::min(next, t->next_us);
+        }
+    }
+    return next;
+}
+
+void timerRunEvent() {
+    esp_timer *due = nullptr;
+    for (esp_timer *t : timers()) {
+        if (t->active && (due == nullptr || t->next_us < due->next_us)) {
+            due = t;
+        }
+    }
+    if (due == nullptr) {
+        return;
+    }
+    if (due->period_us > 0) {
+        due->next_us += static_cast<int64_t>(due->period_us);
+    } else {
+        due->active = false;
+    }
+    due->args.callback(due->args.arg);
+}
+
+}  // namespace epd::host::detail
+
+extern "C" {
+
+int64_t esp_timer_get_time(void) {
+    return epd::host::nowUs();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args,
+                           esp_timer_handle_t *out_handle) {
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    auto *timer = new esp_timer{*create_args, 0, 0, false};
+    timers().push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer == nullptr || timer->active) {
+        return timer == nullptr ? ESP_ERR_INVALID_ARG : ESP_ERR_INVALID_STATE;
+    }
+    timer->next_us = epd::host::nowUs() + static_cast<int64_t>(timeout_us);
+    timer->period_us = 0;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period) {
+    if (timer == nullptr || period == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->next_us = epd::host::nowUs() + static_cast<int64_t>(period);
+    timer->period_us = period;
+    timer->active = true;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == nullptr || !timer->active) {
+        return timer == nullptr ? ESP_ERR_INVALID_ARG : ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer == nullptr || timer->active) {
+        return timer == nullptr ? ESP_ERR_INVALID_ARG : ESP_ERR_INVALID_STATE;
+    }
+    auto &list = timers();
+    list.erase(std::remove(list.begin(), list.end(), timer), list.end());
+    delete timer;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) {
+    return timer != nullptr && timer->active;
+}
+
+/* FreeRTOS -------------------------------------------------------------------------------- */
+
+struct QueueDefinition {
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *created_task) {
+    (void)task;
+    (void)name;
+    (void)stack_depth;
+    (void)arg;
+    (void)priority;
+    if (created_task != nullptr) {
+        *created_task = nullptr;
+    }
+    return pdFAIL;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    (void)task;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    epd::host::advanceUs(static_cast<int64_t>(ticks) * epd::host::kTickUs);
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return static_cast<TickType_t>(epd::host::nowUs() / epd::host::kTickUs);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return new QueueDefinition{0, 1};
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    return new QueueDefinition{initial_count, max_count};
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete sem;
+}
+
+/** @brief Run simulated events until the semaphore is given or the timeout passes. */
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks_to_wait) {
+    const int64_t deadline = epd::host::deadlineAfter(ticks_to_wait);
+    while (sem->count == 0) {
+        if (!epd::host::detail::runNextEvent(deadline)) {
+            if (deadline == kNoEvent) {
+                epd::host::detail::fatal("xSemaphoreTake(portMAX_DELAY) can never be given");
+            }
+            epd::host::detail::advanceTo(deadline);
+            return pdFALSE;
+        }
+    }
+    --sem->count;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    if (sem->count >= sem->max_count) {
+        return pdFALSE;
+    }
+    ++sem->count;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *higher_priority_task_woken) {
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+}  // extern "C"
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#include "driver/gpio.h"
+
+namespace epd::host {
+
+class Ssd1677Emulator;
+
+namespace detail {
+
+constexpr int64_t kNoEvent = std::numeric_limits<int64_t>::max();
+
+/**
+ * @brief Move the clock to the earliest pending event at or before @p deadline and run it.
+ *
+ * @return false, leaving the clock untouched, when nothing is due by @p deadline.
+ */
+bool runNextEvent(int64_t deadline);
+/** @brief Run every event due by @p deadline, then set the clock to it. */
+void advanceTo(int64_t deadline);
+/** @brief Print @p what and abort; used when a blocking call could never return. */
+[[noreturn]] void fatal(const char *what);
+
+/** @brief Event sources polled by the clock, one per mock module. */
+int64_t gpioNextEventUs();
+void gpioRunEvent();
+int64_t spiNextEventUs();
+void spiRunEvent();
+int64_t timerNextEventUs();
+void timerRunEvent();
+
+/** @brief Panel wiring shared by the GPIO and SPI mocks. */
+struct PanelLink {
+    Ssd1677Emulator *panel = nullptr;
+    gpio_num_t dc = GPIO_NUM_NC;
+    gpio_num_t rst = GPIO_NUM_NC;
+    gpio_num_t busy = GPIO_NUM_NC;
+};
+PanelLink &panelLink();
+
+}  // namespace detail
+}  // namespace epd::host
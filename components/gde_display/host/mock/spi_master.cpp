@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <array>
+#include <deque>
+
+#include "driver/spi_master.h"
+#include "esp_log.h"
+#include "host_hal.h"
+#include "sim_internal.h"
+#include "ssd1677_emulator.h"
+
+struct spi_device_t {
+    spi_host_device_t host;
+    spi_device_interface_config_t cfg;
+};
+
+namespace {
+
+constexpr const char *TAG = "spi_master";
+
+struct Bus {
+    bool initialised = false;
+    size_t max_transfer_bytes = 0;
+    spi_device_t *device = nullptr;
+};
+
+struct Pending {
+    spi_device_t *device;
+    spi_transaction_t *trans;
+    int64_t done_us;
+};
+
+std::array<Bus, SPI_HOST_MAX> g_buses;
+epd::host::SpiTiming g_timing;
+std::deque<Pending> g_pending;
+std::deque<spi_transaction_t *> g_finished;
+/** End of the last queued transaction; the next one starts no earlier. */
+int64_t g_queue_free_us = 0;
+
+int64_t wireTimeUs(const spi_device_t *device, const spi_transaction_t *trans) {
+    const int64_t hz = device->cfg.clock_speed_hz > 0 ? device->cfg.clock_speed_hz : 1;
+    const int64_t bits = static_cast<int64_t>(trans->length) + trans->rxlength;
+    return (bits * 1000000 + hz - 1) / hz;
+}
+
+esp_err_t validate(const spi_device_t *device, const spi_transaction_t *trans) {
+    if (device == nullptr || trans == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const Bus &bus = g_buses[device->host];
+    const size_t bytes = (trans->length + 7) / 8;
+    if ((trans->flags & SPI_TRANS_USE_TXDATA) ? bytes > sizeof(trans->tx_data)
+                                               : bytes > bus.max_transfer_bytes) {
+        ESP_LOGE(TAG, "transaction of %zu bytes exceeds the bus limit", bytes);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!(trans->flags & SPI_TRANS_USE_TXDATA) && bytes > 0 && trans->tx_buffer == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (trans->rxlength > 0) {
+        // The bus has no MISO line; reads need SDA turned around in 3-wire half-duplex mode.
+        const uint32_t needed = SPI_DEVICE_3WIRE | SPI_DEVICE_HALFDUPLEX;
+        if ((device->cfg.flags & needed) != needed) {
+            ESP_LOGE(TAG, "read phase on a full-duplex device without MISO");
+            return ESP_ERR_INVALID_ARG;
+        }
+        const size_t rx_bytes = (trans->rxlength + 7) / 8;
+        if ((trans->flags & SPI_TRANS_USE_RXDATA) ? rx_bytes > sizeof(trans->rx_data)
+                                                  : trans->rx_buffer == nullptr) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+/** @brief Start one transaction on the wire: pre_cb, then hand the bytes to the panel. */
+void deliver(spi_device_t *device, spi_transaction_t *trans) {
+    if (device->cfg.pre_cb != nullptr) {
+        device->cfg.pre_cb(trans);
+    }
+    const epd::host::detail::PanelLink &link = epd::host::detail::panelLink();
+    if (link.panel != nullptr) {
+        const auto *bytes = (trans->flags & SPI_TRANS_USE_TXDATA)
+                                ? trans->tx_data
+                                : static_cast<const uint8_t *>(trans->tx_buffer);
+        link.panel->write(gpio_get_level(link.dc) != 0, bytes, (trans->length + 7) / 8,
+                          epd::host::nowUs());
+        if (trans->rxlength > 0) {
+            auto *rx = (trans->flags & SPI_TRANS_USE_RXDATA)
+                           ? trans->rx_data
+                           : static_cast<uint8_t *>(trans->rx_buffer);
+            link.panel->read(rx, (trans->rxlength + 7) / 8, epd::host::nowUs());
+        }
+    }
+}
+
+void finish(spi_device_t *device, spi_transaction_t *trans) {
+    if (device->cfg.post_cb != nullptr) {
+        device->cfg.post_cb(trans);
+    }
+}
+
+bool hasWork(const spi_device_t *device) {
+    return std::any_of(g_pending.begin(), g_pending.end(),
+                       [device](const Pending &p) { return p.device == device; });
+}
+
+int64_t deadlineAfter(TickType_t ticks) {
+    return ticks == portMAX_DELAY ? epd::host::detail::kNoEvent
+                                  : epd::host::nowUs() + static_cast<int64_t>(
+                                        pdTICKS_TO_MS(ticks)) * 1000;
+}
+
+}  // namespace
+
+void epd::host::setSpiTiming(const SpiTiming &timing) {
+    g_timing = timing;
+}
+
+namespace epd::host::detail {
+
+int64_t spiNextEventUs() {
+    return g_pending.empty() ? kNoEvent : g_pending.front().done_us;
+}
+
+void spiRunEvent() {
+    const Pending done = g_pending.front();
+    g_pending.pop_front();
+    deliver(done.device, done.trans);
+    finish(done.device, done.trans);
+    g_finished.push_back(done.trans);
+}
+
+}  // namespace epd::host::detail
+
+extern "C" {
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config,
+                             spi_dma_chan_t dma_chan) {
+    if (host_id < 0 || host_id >= SPI_HOST_MAX || bus_config == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Bus &bus = g_buses[host_id];
+    if (bus.initialised) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    bus.initialised = true;
+    const bool dma = dma_chan != SPI_DMA_DISABLED;
+    bus.max_transfer_bytes = bus_config->max_transfer_sz > 0 && dma
+                                 ? static_cast<size_t>(bus_config->max_transfer_sz)
+                                 : 64;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id) {
+    if (host_id < 0 || host_id >= SPI_HOST_MAX || !g_buses[host_id].initialised) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (g_buses[host_id].device != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    g_buses[host_id] = {};
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id,
+                             const spi_device_interface_config_t *dev_config,
+                             spi_device_handle_t *handle) {
+    if (host_id < 0 || host_id >= SPI_HOST_MAX || dev_config == nullptr || handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    Bus &bus = g_buses[host_id];
+    if (!bus.initialised || bus.device != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    bus.device = new spi_device_t{host_id, *dev_config};
+    *handle = bus.device;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle) {
+    if (handle == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (hasWork(handle) || !g_finished.empty()) {
+        ESP_LOGE(TAG, "device removed with transactions outstanding");
+        return ESP_ERR_INVALID_STATE;
+    }
+    g_buses[handle->host].device = nullptr;
+    delete handle;
+    return ESP_OK;
+}
+
+/**
+ * @brief Queue a transaction behind those already in flight.
+ *
+ * Blocks (running simulated events) while queue_size transactions are outstanding.
+ */
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans_desc,
+                                 TickType_t ticks_to_wait) {
+    const esp_err_t err = validate(handle, trans_desc);
+    if (err != ESP_OK) {
+        return err;
+    }
+    const int64_t deadline = deadlineAfter(ticks_to_wait);
+    while (g_pending.size() >= static_cast<size_t>(std::max(handle->cfg.queue_size, 1))) {
+        if (!epd::host::detail::runNextEvent(deadline)) {
+            epd::host::detail::advanceTo(deadline);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    const int64_t start = std::max(epd::host::nowUs(), g_queue_free_us);
+    g_queue_free_us = start + g_timing.queued_overhead_us + wireTimeUs(handle, trans_desc);
+    g_pending.push_back({handle, trans_desc, g_queue_free_us});
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans_desc,
+                                      TickType_t ticks_to_wait) {
+    if (handle == nullptr || trans_desc == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const int64_t deadline = deadlineAfter(ticks_to_wait);
+    while (g_finished.empty()) {
+        if (!epd::host::detail::runNextEvent(deadline)) {
+            if (deadline == epd::host::detail::kNoEvent) {
+                epd::host::detail::fatal("spi_device_get_trans_result with nothing queued");
+            }
+            epd::host::detail::advanceTo(deadline);
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    *trans_desc = g_finished.front();
+    g_finished.pop_front();
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc) {
+    esp_err_t err = spi_device_queue_trans(handle, trans_desc, portMAX_DELAY);
+    if (err != ESP_OK) {
+        return err;
+    }
+    spi_transaction_t *done = nullptr;
+    return spi_device_get_trans_result(handle, &done, portMAX_DELAY);
+}
+
+/**
+ * @brief Deliver the transaction now and busy-wait for its wire time.
+ *
+ * Like ESP-IDF, polling is refused while queued transactions are still in flight.
+ */
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc) {
+    const esp_err_t err = validate(handle, trans_desc);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (hasWork(handle)) {
+        ESP_LOGE(TAG, "polling transaction while queued transactions are in flight");
+        return ESP_ERR_INVALID_STATE;
+    }
+    deliver(handle, trans_desc);
+    epd::host::detail::advanceTo(epd::host::nowUs() + g_timing.polling_overhead_us +
+                                 wireTimeUs(handle, trans_desc));
+    finish(handle, trans_desc);
+    return ESP_OK;
+}
+
+}  // extern "C"
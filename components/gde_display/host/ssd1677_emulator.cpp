@@ -0,0 +1,431 @@
+#include "ssd1677_emulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace epd::host {
+namespace {
+
+/** 0x22 control bits (SSD1677 data sheet, "Display Update Control 2"). */
+constexpr uint8_t kCtrlLoadTemperature = 0x20;
+constexpr uint8_t kCtrlLoadLut = 0x10;
+constexpr uint8_t kCtrlDisplayMode2 = 0x08;
+constexpr uint8_t kCtrlDisplay = 0x04;
+
+/** 0x11 data entry mode bits. */
+constexpr uint8_t kEntryXIncrement = 0x01;
+constexpr uint8_t kEntryYIncrement = 0x02;
+constexpr uint8_t kEntryYFirst = 0x04;
+
+/** Offset of the phase timing groups (TP A..D, RP) inside the 0x32 payload. */
+constexpr size_t kLutTimingOffset = 50;
+constexpr size_t kLutGroups = 10;
+constexpr size_t kLutGroupBytes = 5;
+
+/** Frames of VSH (or VSL) drive that take a pixel fully from white to black (or back). */
+constexpr int kSaturationFrames = 32;
+
+/** Longest payload kept per command; 0x32 is the largest the controller accepts. */
+constexpr size_t kMaxParameterBytes = 128;
+
+int le16(const std::vector<uint8_t> &p, size_t index) {
+    return p[index] | ((p[index + 1] & 0x03) << 8);
+}
+
+}  // namespace
+
+Ssd1677Emulator::Ssd1677Emulator() : Ssd1677Emulator(Config{}) {}
+
+Ssd1677Emulator::Ssd1677Emulator(const Config &config)
+    : cfg_(config),
+      ram_new_(kPlaneBytes, 0xFF),
+      ram_old_(kPlaneBytes, 0xFF),
+      visible_(kPlaneBytes, 0xFF),
+      gray_(static_cast<size_t>(kColumns) * kRows, 0xFF) {
+    powerOnReset(0);
+}
+
+/** @brief Restore every register to its reset value without touching RAM. */
+void Ssd1677Emulator::powerOnReset(int64_t now_us) {
+    for (std::vector<uint8_t> &p : params_) {
+        p.clear();
+    }
+    lut_.fill(0);
+    register_lut_loaded_ = false;
+    command_valid_ = false;
+    entry_mode_ = 0x03;
+    x_start_ = 0;
+    x_end_ = kColumns - 1;
+    y_start_ = 0;
+    y_end_ = kRows - 1;
+    x_counter_ = 0;
+    y_counter_ = 0;
+    sleeping_ = false;
+    holdBusy(now_us, cfg_.reset_us);
+}
+
+void Ssd1677Emulator::hardwareReset(int64_t now_us) {
+    ++stats_.hardware_resets;
+    powerOnReset(now_us);
+}
+
+void Ssd1677Emulator::write(bool dc, const uint8_t *bytes, size_t len, int64_t now_us) {
+    if (len == 0) {
+        return;
+    }
+    if (sleeping_) {
+        ++stats_.sleep_violations;
+        return;
+    }
+    if (busy(now_us)) {
+        ++stats_.busy_violations;
+        return;
+    }
+    if (!dc) {
+        for (size_t i = 0; i < len; ++i) {
+            command(bytes[i], now_us);
+        }
+        return;
+    }
+    stats_.data_bytes += len;
+    for (size_t i = 0; i < len; ++i) {
+        data(bytes[i]);
+    }
+}
+
+/** @brief Return the temperature register for 0x1B; anything else reads as 0x00. */
+void Ssd1677Emulator::read(uint8_t *bytes, size_t len, int64_t now_us) {
+    if (sleeping_ || busy(now_us)) {
+        ++(sleeping_ ? stats_.sleep_violations : stats_.busy_violations);
+        std::fill(bytes, bytes + len, 0);
+        return;
+    }
+    const uint16_t reg = static_cast<uint16_t>(temperature_) & 0x0FFF;
+    const std::array<uint8_t, 2> temperature = {static_cast<uint8_t>(reg >> 4),
+                                                static_cast<uint8_t>((reg & 0x0F) << 4)};
+    for (size_t i = 0; i < len; ++i, ++read_index_) {
+        const bool valid = command_valid_ && current_cmd_ == 0x1B && read_index_ < 2;
+        bytes[i] = valid ? temperature[read_index_] : 0x00;
+    }
+}
+
+void Ssd1677Emulator::command(uint8_t cmd, int64_t now_us) {
+    ++stats_.commands;
+    ++stats_.command_counts[cmd];
+    current_cmd_ = cmd;
+    command_valid_ = true;
+    read_index_ = 0;
+    params_[cmd].clear();
+
+    switch (cmd) {
+        case 0x12:  // SWRESET
+            powerOnReset(now_us);
+            break;
+        case 0x20:  // master activation
+            activate(now_us);
+            break;
+        default:
+            break;
+    }
+}
+
+void Ssd1677Emulator::data(uint8_t byte) {
+    if (!command_valid_) {
+        return;
+    }
+    if (current_cmd_ == 0x24 || current_cmd_ == 0x26) {
+        writeRam(byte);
+        return;
+    }
+
+    std::vector<uint8_t> &p = params_[current_cmd_];
+    if (p.size() >= kMaxParameterBytes) {
+        return;
+    }
+    p.push_back(byte);
+
+    switch (current_cmd_) {
+        case 0x10:  // deep sleep; mode 0 keeps the controller awake
+            sleeping_ = (byte & 0x03) != 0;
+            break;
+        case 0x11:
+            entry_mode_ = byte & 0x07;
+            break;
+        case 0x32:
+            if (p.size() <= kLutBytes) {
+                lut_[p.size() - 1] = byte;
+                register_lut_loaded_ = p.size() == kLutBytes;
+            }
+            break;
+        case 0x44:
+            if (p.size() == 4) {
+                x_start_ = le16(p, 0);
+                x_end_ = le16(p, 2);
+            }
+            break;
+        case 0x45:
+            if (p.size() == 4) {
+                y_start_ = le16(p, 0);
+                y_end_ = le16(p, 2);
+            }
+            break;
+        case 0x1A:  // temperature register, integer byte first, then the fraction nibble
+            if (p.size() == 1) {
+                temperature_ = static_cast<int16_t>(static_cast<int8_t>(byte) * 16);
+            } else if (p.size() == 2) {
+                temperature_ = static_cast<int16_t>((temperature_ & ~0x0F) | (byte >> 4));
+            }
+            break;
+        case 0x4E:
+            if (p.size() == 2) {
+                x_counter_ = le16(p, 0);
+            }
+            break;
+        case 0x4F:
+            if (p.size() == 2) {
+                y_counter_ = le16(p, 0);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/** @brief Store one byte at the address counter, then advance it inside the window. */
+void Ssd1677Emulator::writeRam(uint8_t byte) {
+    if (x_counter_ >= 0 && x_counter_ < kColumns && y_counter_ >= 0 && y_counter_ < kRows) {
+        std::vector<uint8_t> &ram = current_cmd_ == 0x24 ? ram_new_ : ram_old_;
+        ram[static_cast<size_t>(y_counter_) * kStride + x_counter_ / 8] = byte;
+        ++stats_.ram_bytes;
+    } else {
+        ++stats_.clipped_writes;
+    }
+    advanceCounter();
+}
+
+/**
+ * @brief Step the address counter per 0x11.
+ *
+ * The fast axis moves 8 pixels (x) or one row (y) from the window start towards its end and
+ * wraps back to the start, stepping the slow axis once.
+ */
+void Ssd1677Emulator::advanceCounter() {
+    const bool x_inc = (entry_mode_ & kEntryXIncrement) != 0;
+    const bool y_inc = (entry_mode_ & kEntryYIncrement) != 0;
+
+    auto step_x = [&]() {
+        x_counter_ += x_inc ? 8 : -8;
+        if (x_inc ? x_counter_ > x_end_ : x_counter_ < x_end_) {
+            x_counter_ = x_start_;
+            return true;
+        }
+        return false;
+    };
+    auto step_y = [&]() {
+        y_counter_ += y_inc ? 1 : -1;
+        if (y_inc ? y_counter_ > y_end_ : y_counter_ < y_end_) {
+            y_counter_ = y_start_;
+            return true;
+        }
+        return false;
+    };
+
+    if (entry_mode_ & kEntryYFirst) {
+        if (step_y()) {
+            step_x();
+        }
+    } else if (step_x()) {
+        step_y();
+    }
+}
+
+/** @brief Run the sequence selected by 0x22 and hold BUSY for its duration. */
+void Ssd1677Emulator::activate(int64_t now_us) {
+    const std::vector<uint8_t> &ctrl = params_[0x22];
+    const uint8_t control = ctrl.empty() ? 0xFF : ctrl[0];
+    const bool loads_lut = (control & kCtrlLoadLut) != 0;
+    const bool mode2 = (control & kCtrlDisplayMode2) != 0;
+
+    if (control & kCtrlLoadTemperature) {
+        temperature_ = static_cast<int16_t>(std::lround(cfg_.sensor_celsius * 16));
+    }
+
+    int64_t duration = cfg_.load_us;
+    if (control & kCtrlDisplay) {
+        if (loads_lut || !register_lut_loaded_) {
+            duration = mode2 ? cfg_.otp_partial_refresh_us : cfg_.otp_full_refresh_us;
+            showImage(mode2);
+        } else {
+            duration = lutRefreshUs();
+            if (mode2) {
+                showImage(true);
+            } else {
+                showLutImage();
+            }
+        }
+        if (mode2) {
+            ++stats_.partial_refreshes;
+        } else {
+            ++stats_.full_refreshes;
+        }
+    }
+    if (loads_lut) {
+        register_lut_loaded_ = false;
+    }
+    holdBusy(now_us, duration);
+}
+
+/**
+ * @brief Update the visible image from RAM.
+ *
+ * Display mode 1 drives every pixel to its 0x24 value. Mode 2 only drives pixels whose 0x24 and
+ * 0x26 bits differ; the others keep whatever the panel showed before.
+ */
+void Ssd1677Emulator::showImage(bool differential) {
+    for (size_t i = 0; i < kPlaneBytes; ++i) {
+        const uint8_t driven = differential ? ram_new_[i] ^ ram_old_[i] : 0xFF;
+        visible_[i] = static_cast<uint8_t>((visible_[i] & ~driven) | (ram_new_[i] & driven));
+        for (int bit = 0; bit < 8; ++bit) {
+            const uint8_t mask = static_cast<uint8_t>(0x80 >> bit);
+            if (driven & mask) {
+                gray_[i * 8 + bit] = (ram_new_[i] & mask) ? 0xFF : 0x00;
+            }
+        }
+    }
+    if (cfg_.copy_new_to_old_after_partial) {
+        ram_old_ = ram_new_;
+    }
+}
+
+/**
+ * @brief Play LUT0..LUT3 of the register waveform on every pixel (display mode 1).
+ *
+ * Darkness runs from 0 (white) to kSaturationFrames (black); VSH1/VSH2 add the phase length,
+ * VSL subtracts it and VSS holds. Results are tabulated per LUT and starting darkness.
+ */
+void Ssd1677Emulator::showLutImage() {
+    std::array<std::array<uint8_t, kSaturationFrames + 1>, 4> final_dark{};
+    for (size_t lut = 0; lut < final_dark.size(); ++lut) {
+        for (int start = 0; start <= kSaturationFrames; ++start) {
+            int dark = start;
+            for (size_t g = 0; g < kLutGroups; ++g) {
+                const uint8_t vs = lut_[lut * kLutGroups + g];
+                const uint8_t *timing = lut_.data() + kLutTimingOffset + g * kLutGroupBytes;
+                for (int repeat = 0; repeat <= timing[4]; ++repeat) {
+                    for (int phase = 0; phase < 4; ++phase) {
+                        const int level = (vs >> (6 - 2 * phase)) & 0x03;
+                        const int frames = timing[phase];
+                        if (level == 0x01 || level == 0x03) {
+                            dark = std::min(kSaturationFrames, dark + frames);
+                        } else if (level == 0x02) {
+                            dark = std::max(0, dark - frames);
+                        }
+                    }
+                }
+            }
+            final_dark[lut][start] = static_cast<uint8_t>(dark);
+        }
+    }
+
+    for (size_t i = 0; i < kPlaneBytes; ++i) {
+        uint8_t shown = 0;
+        for (int bit = 0; bit < 8; ++bit) {
+            const uint8_t mask = static_cast<uint8_t>(0x80 >> bit);
+            const size_t lut = ((ram_old_[i] & mask) ? 2 : 0) + ((ram_new_[i] & mask) ? 1 : 0);
+            uint8_t &pixel = gray_[i * 8 + bit];
+            const int start = (255 - pixel) * kSaturationFrames / 255;
+            pixel = static_cast<uint8_t>(255 - final_dark[lut][start] * 255 / kSaturationFrames);
+            if (pixel >= 0x80) {
+                shown |= mask;
+            }
+        }
+        visible_[i] = shown;
+    }
+}
+
+void Ssd1677Emulator::holdBusy(int64_t now_us, int64_t duration_us) {
+    busy_until_ = now_us + duration_us;
+    stats_.busy_us += duration_us;
+}
+
+/** @brief Sum the phase lengths of every group, each repeated RP + 1 times. */
+int64_t Ssd1677Emulator::lutRefreshUs() const {
+    int64_t frames = 0;
+    for (size_t g = 0; g < kLutGroups; ++g) {
+        const uint8_t *group = lut_.data() + kLutTimingOffset + g * kLutGroupBytes;
+        const int phases = group[0] + group[1] + group[2] + group[3];
+        frames += static_cast<int64_t>(phases) * (group[4] + 1);
+    }
+    return std::max<int64_t>(frames, 1) * cfg_.frame_us;
+}
+
+uint8_t *Ssd1677Emulator::planeData(Plane plane) {
+    switch (plane) {
+        case Plane::kNew:
+            return ram_new_.data();
+        case Plane::kOld:
+            return ram_old_.data();
+        case Plane::kVisible:
+        default:
+            return visible_.data();
+    }
+}
+
+const uint8_t *Ssd1677Emulator::plane(Plane plane) const {
+    return const_cast<Ssd1677Emulator *>(this)->planeData(plane);
+}
+
+bool Ssd1677Emulator::pixel(Plane plane, int x, int y) const {
+    const uint8_t byte = this->plane(plane)[static_cast<size_t>(y) * kStride + x / 8];
+    return (byte & (0x80 >> (x % 8))) != 0;
+}
+
+size_t Ssd1677Emulator::diffBytes(Plane a, Plane b) const {
+    const uint8_t *pa = plane(a);
+    const uint8_t *pb = plane(b);
+    size_t count = 0;
+    for (size_t i = 0; i < kPlaneBytes; ++i) {
+        count += pa[i] != pb[i];
+    }
+    return count;
+}
+
+std::array<size_t, 256> Ssd1677Emulator::grayHistogram() const {
+    std::array<size_t, 256> histogram{};
+    for (uint8_t value : gray_) {
+        ++histogram[value];
+    }
+    return histogram;
+}
+
+bool Ssd1677Emulator::writePgm(const char *path) const {
+    std::FILE *file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "P5\n%d %d\n255\n", kColumns, kRows);
+    const bool ok = std::fwrite(gray_.data(), 1, gray_.size(), file) == gray_.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+/** @brief PBM stores 1 for black, so every byte is inverted on the way out. */
+bool Ssd1677Emulator::writePbm(const char *path, Plane plane) const {
+    std::FILE *file = std::fopen(path, "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "P4\n%d %d\n", kColumns, kRows);
+    const uint8_t *src = this->plane(plane);
+    std::array<uint8_t, kStride> row{};
+    bool ok = true;
+    for (int y = 0; y < kRows && ok; ++y) {
+        for (size_t i = 0; i < kStride; ++i) {
+            row[i] = static_cast<uint8_t>(~src[static_cast<size_t>(y) * kStride + i]);
+        }
+        ok = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+}  // namespace epd::host
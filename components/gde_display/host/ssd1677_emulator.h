@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "epd_driver.h"
+
+namespace epd::host {
+
+/**
+ * @brief Byte-level model of the SSD1677 controller behind the mock SPI bus.
+ *
+ * Decodes the command set used by epd::Driver, keeps both RAM planes, tracks the address
+ * counters inside the 0x44/0x45 window, and drives BUSY for the duration of each update. The
+ * visible image follows the differential waveform: a partial update (display mode 2) only
+ * drives pixels whose RAM 0x24 and 0x26 bits differ, so a stale previous-image plane shows up
+ * as pixels that fail to change. Bits are 1 for white, as on the panel.
+ *
+ * A display-mode-1 update driven by a register LUT is also run through a simple optical model:
+ * each (0x26, 0x24) bit pair selects one of LUT0..LUT3, whose VSH phases darken and VSL phases
+ * lighten the pixel by one step per frame. That yields the gray level of every pixel, so custom
+ * waveforms such as the 4-gray one can be checked; the 1-bit visible plane is its threshold.
+ */
+class Ssd1677Emulator {
+  public:
+    static constexpr int kColumns = kRamColumns;
+    static constexpr int kRows = kRamRows;
+    static constexpr size_t kStride = kColumns / 8;
+    static constexpr size_t kPlaneBytes = kStride * kRows;
+    /** @brief Waveform bytes carried by 0x32 (voltages, phase timing and frame rate). */
+    static constexpr size_t kLutBytes = 105;
+
+    enum class Plane : uint8_t {
+        kNew,      ///< RAM 0x24, the image being written.
+        kOld,      ///< RAM 0x26, the previous image used by differential updates.
+        kVisible,  ///< What the panel shows after the last update.
+    };
+
+    /** @brief Timing model and controller options; the defaults follow the panel data sheet. */
+    struct Config {
+        /** @brief BUSY after a hardware reset or 0x12. */
+        int64_t reset_us = 2000;
+        /** @brief BUSY for an activation that does not drive the display (e.g. 0x22 = 0x91). */
+        int64_t load_us = 2000;
+        /** @brief Full and partial updates with the OTP waveform (0x22 bit 0x10 set). */
+        int64_t otp_full_refresh_us = 3000000;
+        int64_t otp_partial_refresh_us = 420000;
+        /** @brief One waveform frame when the update uses the LUT written with 0x32. */
+        int64_t frame_us = 20000;
+        /** @brief Copy RAM 0x24 into 0x26 after each display-mode-2 update. */
+        bool copy_new_to_old_after_partial = false;
+        /** @brief Reading of the internal temperature sensor, in °C. */
+        double sensor_celsius = 25.0;
+    };
+
+    /** @brief Counters since construction or resetStats(). */
+    struct Stats {
+        uint32_t commands = 0;
+        uint64_t data_bytes = 0;
+        /** @brief Bytes stored into either RAM plane. */
+        uint64_t ram_bytes = 0;
+        uint32_t full_refreshes = 0;
+        uint32_t partial_refreshes = 0;
+        uint32_t hardware_resets = 0;
+        /** @brief Total time BUSY was held by updates and resets. */
+        int64_t busy_us = 0;
+        /** @brief SPI writes that arrived while BUSY was high; they are dropped. */
+        uint32_t busy_violations = 0;
+        /** @brief SPI writes that arrived during deep sleep; they are dropped. */
+        uint32_t sleep_violations = 0;
+        /** @brief RAM bytes whose address counter pointed outside the RAM. */
+        uint32_t clipped_writes = 0;
+        std::array<uint32_t, 256> command_counts{};
+    };
+
+    Ssd1677Emulator();
+    explicit Ssd1677Emulator(const Config &config);
+
+    /** @brief RST rising edge: registers return to their reset values, RAM is retained. */
+    void hardwareReset(int64_t now_us);
+    /** @brief Consume one SPI transfer; @p dc selects data (true) or command bytes. */
+    void write(bool dc, const uint8_t *bytes, size_t len, int64_t now_us);
+    /** @brief Clock @p len bytes out of the controller for the current command (0x1B only). */
+    void read(uint8_t *bytes, size_t len, int64_t now_us);
+    /** @brief Change what the internal sensor reports on its next measurement. */
+    void setSensorCelsius(double celsius) { cfg_.sensor_celsius = celsius; }
+    /** @brief Temperature register (0x1A/0x1B) in 1/16 °C, as written or last measured. */
+    int16_t temperatureRegister() const { return temperature_; }
+
+    bool busy(int64_t now_us) const { return now_us < busy_until_; }
+    /** @brief Time at which BUSY last fell or will fall. */
+    int64_t busyUntil() const { return busy_until_; }
+    bool sleeping() const { return sleeping_; }
+
+    /** @brief kPlaneBytes of row-major 1bpp data, kStride bytes per row. */
+    const uint8_t *plane(Plane plane) const;
+    /** @brief True when the pixel at RAM coordinates (@p x, @p y) is white. */
+    bool pixel(Plane plane, int x, int y) const;
+    /** @brief Number of bytes that differ between two planes. */
+    size_t diffBytes(Plane a, Plane b) const;
+    /** @brief Write @p plane as a binary PBM (P4) image. */
+    bool writePbm(const char *path, Plane plane = Plane::kVisible) const;
+    /** @brief Luminance (0 black .. 255 white) the panel shows at (@p x, @p y). */
+    uint8_t gray(int x, int y) const { return gray_[static_cast<size_t>(y) * kColumns + x]; }
+    /** @brief Number of visible pixels per distinct luminance, indexed by luminance. */
+    std::array<size_t, 256> grayHistogram() const;
+    /** @brief Write the visible luminance as a binary PGM (P5) image. */
+    bool writePgm(const char *path) const;
+
+    /** @brief Payload of the last @p cmd, as far as it has been received. */
+    const std::vector<uint8_t> &parameters(uint8_t cmd) const { return params_[cmd]; }
+    /** @brief Duration of the update the current LUT registers describe. */
+    int64_t lutRefreshUs() const;
+
+    const Stats &stats() const { return stats_; }
+    void resetStats() { stats_ = {}; }
+
+  private:
+    void powerOnReset(int64_t now_us);
+    void command(uint8_t cmd, int64_t now_us);
+    void data(uint8_t byte);
+    void writeRam(uint8_t byte);
+    void advanceCounter();
+    void activate(int64_t now_us);
+    void showImage(bool differential);
+    void showLutImage();
+    void holdBusy(int64_t now_us, int64_t duration_us);
+    uint8_t *planeData(Plane plane);
+
+    Config cfg_;
+    Stats stats_{};
+    std::vector<uint8_t> ram_new_;
+    std::vector<uint8_t> ram_old_;
+    std::vector<uint8_t> visible_;
+    /** @brief Luminance per pixel, row-major, kColumns per row. */
+    std::vector<uint8_t> gray_;
+    std::array<std::vector<uint8_t>, 256> params_{};
+    std::array<uint8_t, kLutBytes> lut_{};
+    bool register_lut_loaded_{false};
+    uint8_t current_cmd_{0};
+    bool command_valid_{false};
+    uint8_t entry_mode_{0x03};
+    int x_start_{0};
+    int x_end_{kColumns - 1};
+    int y_start_{0};
+    int y_end_{kRows - 1};
+    int x_counter_{0};
+    int y_counter_{0};
+    bool sleeping_{false};
+    int64_t busy_until_{0};
+    int16_t temperature_{0};
+    size_t read_index_{0};
+};
+
+}  // namespace epd::host
@@ -0,0 +1,245 @@
+/**
+ * @file Throughput of the RGB565 to 1bpp kernels (pixel_convert.h) on the host CPU.
+ *
+ * Each variant packs the same 800x32 strip, the shape LVGL hands to the flush callback, and
+ * is checked bit for bit against the per-pixel loop the flush callback used before the kernels.
+ * The dither modes are timed on a grey ramp and checked for solid black/white, mean density
+ * and Floyd-Steinberg continuity across strips. Times come from the host's steady clock, not
+ * the simulated one.
+ */
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "epd_driver.h"
+#include "pixel_convert.h"
+
+namespace {
+
+constexpr size_t kStripWidth = epd::kRamColumns;
+constexpr size_t kStripRows = 32;
+constexpr size_t kRowBytes = kStripWidth / 8;
+constexpr int kIterations = 400;
+
+/** @brief The original flush loop: three divides, a weighted sum and one bit RMW per pixel. */
+template <bool Mirror>
+void referenceRow(const uint8_t *src, size_t count, uint8_t *dst, unsigned dst_bit) {
+    for (size_t col = 0; col < count; ++col) {
+        const uint16_t value = static_cast<uint16_t>(src[col * 2]) |
+                               (static_cast<uint16_t>(src[col * 2 + 1]) << 8);
+        const uint8_t red = static_cast<uint8_t>(((value >> 11) & 0x1F) * 255 / 31);
+        const uint8_t green = static_cast<uint8_t>(((value >> 5) & 0x3F) * 255 / 63);
+        const uint8_t blue = static_cast<uint8_t>((value & 0x1F) * 255 / 31);
+        const uint16_t luminance = static_cast<uint16_t>(red) * 30 +
+                                   static_cast<uint16_t>(green) * 59 +
+                                   static_cast<uint16_t>(blue) * 11;
+        const size_t index = dst_bit + (Mirror ? count - 1 - col : col);
+        const uint8_t mask = static_cast<uint8_t>(1U << (7 - index % 8));
+        if (luminance < 128U * 100U) {
+            dst[index / 8] &= static_cast<uint8_t>(~mask);
+        } else {
+            dst[index / 8] |= mask;
+        }
+    }
+}
+
+using RowKernel = void (*)(const uint8_t *, size_t, uint8_t *, unsigned);
+
+struct Variant {
+    const char *name;
+    RowKernel kernel;
+    RowKernel reference;
+};
+
+struct DitherMode {
+    const char *name;
+    epd::Dither mode;
+};
+
+constexpr DitherMode kDitherModes[] = {
+    {"threshold", epd::Dither::kThreshold},
+    {"bayer 4x4", epd::Dither::kBayer4},
+    {"bayer 8x8", epd::Dither::kBayer8},
+    {"floyd-steinberg", epd::Dither::kFloydSteinberg},
+};
+
+/** @brief Mean time per call of @p convert in microseconds; it writes into @p out. */
+template <typename Convert>
+double timeStrip(Convert &&convert, std::vector<uint8_t> &out) {
+    const auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        convert();
+        // Keep the stores from being hoisted out of the loop.
+        asm volatile("" : : "r"(out.data()) : "memory");
+    }
+    const std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - started;
+    return elapsed.count() / kIterations;
+}
+
+/** @brief Compare @p kernel with @p reference on odd lengths and bit offsets. */
+bool matchesReference(RowKernel kernel, RowKernel reference, const std::vector<uint8_t> &strip) {
+    for (size_t count : {size_t{1}, size_t{7}, size_t{8}, size_t{31}, size_t{33}, size_t{797}}) {
+        for (unsigned dst_bit = 0; dst_bit < 8; ++dst_bit) {
+            std::vector<uint8_t> expected(kRowBytes + 2, 0x5A);
+            std::vector<uint8_t> actual(expected);
+            reference(strip.data(), count, expected.data(), dst_bit);
+            kernel(strip.data(), count, actual.data(), dst_bit);
+            if (expected != actual) {
+                std::printf("mismatch: count %zu, dst_bit %u\n", count, dst_bit);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/** @brief One grey level as RGB565 bytes (little endian). */
+uint16_t grey565(uint32_t level) {
+    return static_cast<uint16_t>(((level >> 3) << 11) | ((level >> 2) << 5) | (level >> 3));
+}
+
+/** @brief @p rows rows of kStripWidth pixels; @p level gives the grey of each column. */
+template <typename Level>
+std::vector<uint8_t> greyImage(size_t rows, Level &&level) {
+    std::vector<uint8_t> image(kStripWidth * rows * 2);
+    for (size_t i = 0; i < kStripWidth * rows; ++i) {
+        const uint16_t value = grey565(level(i % kStripWidth));
+        image[i * 2] = static_cast<uint8_t>(value);
+        image[i * 2 + 1] = static_cast<uint8_t>(value >> 8);
+    }
+    return image;
+}
+
+/** @brief Dither rows [first, first + rows) of @p image mirrored, as the flush callback does. */
+void ditherRows(epd::Dither mode, const std::vector<uint8_t> &image, size_t first, size_t rows,
+                std::vector<uint8_t> &out, epd::ErrorDiffusion &diffusion) {
+    for (size_t row = first; row < first + rows; ++row) {
+        epd::ditherRgb565Row<true>(mode, image.data() + row * kStripWidth * 2, kStripWidth, 0,
+                                   static_cast<int32_t>(row), out.data() + row * kRowBytes, 0,
+                                   &diffusion);
+    }
+}
+
+double whiteFraction(const std::vector<uint8_t> &packed) {
+    size_t white = 0;
+    for (uint8_t byte : packed) {
+        white += static_cast<size_t>(std::popcount(byte));
+    }
+    return static_cast<double>(white) / (packed.size() * 8);
+}
+
+/** @brief Solid black/white stay solid, mid grey lands near its luminance, strips join up. */
+bool checkDither(const DitherMode &dither) {
+    std::vector<uint8_t> out(kRowBytes * kStripRows * 2);
+    for (uint32_t level : {0U, 255U}) {
+        epd::ErrorDiffusion diffusion;
+        ditherRows(dither.mode, greyImage(kStripRows, [&](size_t) { return level; }), 0,
+                   kStripRows, out, diffusion);
+        const uint8_t expected = level != 0 ? 0xFF : 0x00;
+        if (std::any_of(out.begin(), out.begin() + kRowBytes * kStripRows,
+                        [&](uint8_t byte) { return byte != expected; })) {
+            std::printf("%s: solid %u is not solid\n", dither.name, static_cast<unsigned>(level));
+            return false;
+        }
+    }
+
+    if (dither.mode != epd::Dither::kThreshold) {
+        // 0x8410 expands to (131, 129, 131): weighted luminance 129.8 of 255.
+        constexpr double kMidGrey = 12982.0 / 25500.0;
+        epd::ErrorDiffusion diffusion;
+        out.resize(kRowBytes * kStripRows);
+        ditherRows(dither.mode, greyImage(kStripRows, [](size_t) { return 128U; }), 0, kStripRows,
+                   out, diffusion);
+        const double white = whiteFraction(out);
+        if (std::fabs(white - kMidGrey) > 0.03) {
+            std::printf("%s: mid grey dithers to %.3f white\n", dither.name, white);
+            return false;
+        }
+    }
+
+    // Two strips sharing one ErrorDiffusion must match the same rows dithered in one pass.
+    const std::vector<uint8_t> ramp =
+        greyImage(kStripRows * 2, [](size_t column) { return column * 255 / (kStripWidth - 1); });
+    std::vector<uint8_t> whole(kRowBytes * kStripRows * 2);
+    std::vector<uint8_t> strips(whole.size());
+    epd::ErrorDiffusion one_pass;
+    ditherRows(dither.mode, ramp, 0, kStripRows * 2, whole, one_pass);
+    epd::ErrorDiffusion carried;
+    ditherRows(dither.mode, ramp, 0, kStripRows, strips, carried);
+    ditherRows(dither.mode, ramp, kStripRows, kStripRows, strips, carried);
+    if (whole != strips) {
+        std::printf("%s: strip boundary changes the result\n", dither.name);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace
+
+int main() {
+    // Mostly black and white with anti-aliased grey edges, like rendered text.
+    std::mt19937 rng(1);
+    std::vector<uint8_t> strip(kStripWidth * kStripRows * 2);
+    for (size_t i = 0; i < strip.size(); i += 2) {
+        const uint32_t pick = rng() % 8;
+        const uint16_t value = pick < 5 ? 0xFFFF : pick < 7 ? 0x0000 : static_cast<uint16_t>(rng());
+        strip[i] = static_cast<uint8_t>(value);
+        strip[i + 1] = static_cast<uint8_t>(value >> 8);
+    }
+    std::vector<uint8_t> out(kRowBytes * kStripRows);
+
+    const Variant variants[] = {
+        {"reference", referenceRow<false>, referenceRow<false>},
+        {"reference mirrored", referenceRow<true>, referenceRow<true>},
+        {"table, 8 px/store", epd::packRgb565Row<false, epd::PackStore::kByte>,
+         referenceRow<false>},
+        {"table, 8 px/store mirrored", epd::packRgb565Row<true, epd::PackStore::kByte>,
+         referenceRow<true>},
+        {"table, 32 px/store", epd::packRgb565Row<false, epd::PackStore::kWord>,
+         referenceRow<false>},
+        {"table, 32 px/store mirrored", epd::packRgb565Row<true, epd::PackStore::kWord>,
+         referenceRow<true>},
+    };
+
+    std::printf("%-28s %10s %12s %8s\n", "variant", "us/strip", "Mpixel/s", "speedup");
+    double baseline[2] = {0, 0};
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(variants) / sizeof(variants[0]); ++i) {
+        const Variant &variant = variants[i];
+        ok = matchesReference(variant.kernel, variant.reference, strip) && ok;
+        const double us = timeStrip(
+            [&] {
+                for (size_t row = 0; row < kStripRows; ++row) {
+                    variant.kernel(strip.data() + row * kStripWidth * 2, kStripWidth,
+                                   out.data() + row * kRowBytes, 0);
+                }
+            },
+            out);
+        if (i < 2) {
+            baseline[i] = us;
+        }
+        std::printf("%-28s %10.2f %12.1f %7.1fx\n", variant.name, us,
+                    kStripWidth * kStripRows / us, baseline[i % 2] / us);
+    }
+
+    // Dithering is meant for images and anti-aliased edges, so time it on a grey ramp.
+    const std::vector<uint8_t> ramp =
+        greyImage(kStripRows, [](size_t column) { return column * 255 / (kStripWidth - 1); });
+    std::printf("\n%-28s %10s %12s %8s\n", "dither (ramp, mirrored)", "us/strip", "Mpixel/s",
+                "white");
+    for (const DitherMode &dither : kDitherModes) {
+        ok = checkDither(dither) && ok;
+        epd::ErrorDiffusion diffusion;
+        const double us = timeStrip(
+            [&] { ditherRows(dither.mode, ramp, 0, kStripRows, out, diffusion); }, out);
+        std::printf("%-28s %10.2f %12.1f %7.1f%%\n", dither.name, us,
+                    kStripWidth * kStripRows / us, whiteFraction(out) * 100);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/**
+ * @file Run the on-target upload benchmarks (epd_bench.h) against the emulated panel.
+ *
+ * Times are simulated from the SPI clock, the per-transaction costs in epd::host::SpiTiming and
+ * the panel BUSY model, so they track transfer cost rather than host CPU speed.
+ */
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "assets.h"
+#include "epd_bench.h"
+#include "esp_check.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "host_panel.h"
+
+namespace {
+
+/**
+ * @brief Full fast refreshes while the emulated sensor drifts across the waveform bands.
+ *
+ * Shows which refreshes had to upload a LUT (only band changes, since nothing resets the
+ * controller in between) and how long each waveform holds BUSY.
+ */
+esp_err_t runWaveformSweep(epd::Driver &driver, epd::host::Ssd1677Emulator &panel) {
+    ESP_RETURN_ON_ERROR(driver.hardwareInit(), "bench", "init failed");
+    std::printf("sensor_c  read_c  lut_sent  refresh_ms\n");
+    for (const double celsius : {25.0, 24.0, 19.0, 18.5, 17.0, 5.0, 21.0, 23.0, 85.0, 79.0, 77.0}) {
+        panel.setSensorCelsius(celsius);
+        int measured = 0;
+        ESP_RETURN_ON_ERROR(driver.readTemperature(measured), "bench", "sensor read failed");
+
+        const uint32_t uploads = driver.transferStats().lut_uploads;
+        const int64_t started = epd::host::nowUs();
+        ESP_RETURN_ON_ERROR(driver.triggerFullRefreshAsync(true), "bench", "refresh failed");
+        ESP_RETURN_ON_ERROR(driver.waitRefreshDone(), "bench", "refresh wait failed");
+        std::printf("%8.1f  %6d  %8s  %10.1f\n", celsius, measured,
+                    driver.transferStats().lut_uploads != uploads ? "yes" : "no",
+                    (epd::host::nowUs() - started) / 1000.0);
+    }
+    const epd::TransferStats &stats = driver.transferStats();
+    std::printf("band changes %u, LUT refreshes %u, LUT uploads %u\n",
+                static_cast<unsigned>(stats.waveform_band_changes),
+                static_cast<unsigned>(stats.lut_refreshes),
+                static_cast<unsigned>(stats.lut_uploads));
+    return ESP_OK;
+}
+
+/**
+ * @brief Host CPU time of splitGrayPlanes() over one full frame.
+ *
+ * The simulated clock only moves on SPI and BUSY waits, so the benchmark above reports the split
+ * as free; this measures the kernel itself with the host's steady clock.
+ */
+void timeGraySplit() {
+    constexpr int kIterations = 200;
+    std::vector<uint8_t> gray(epd::kGrayBufferSize, 0x1B);
+    std::vector<uint8_t> plane24(epd::kBufferSize);
+    std::vector<uint8_t> plane26(epd::kBufferSize);
+    const auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+        gray[static_cast<size_t>(i)] ^= 0xFF;  // keep the loop from being hoisted
+        epd::splitGrayPlanes(gray.data(), static_cast<size_t>(epd::kRamColumns) * epd::kRamRows,
+                             plane24.data(), plane26.data());
+    }
+    const std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - started;
+    std::printf("splitGrayPlanes: %.1f us per frame on the host (check %02X%02X)\n",
+                elapsed.count() / kIterations, plane24[0], plane26[0]);
+}
+
+/** @brief Pixel count per luminance the panel shows, e.g. after the gray benchmark. */
+void printGrayLevels(const epd::host::Ssd1677Emulator &panel) {
+    const std::array<size_t, 256> histogram = panel.grayHistogram();
+    std::printf("visible luminance:");
+    for (size_t value = 0; value < histogram.size(); ++value) {
+        if (histogram[value] != 0) {
+            std::printf(" %zu x %zu", value, histogram[value]);
+        }
+    }
+    std::printf("\n");
+}
+
+}  // namespace
+
+int main() {
+    esp_log_level_set("epd_driver", ESP_LOG_WARN);
+
+    epd::host::Ssd1677Emulator panel;
+    epd::Config cfg = epd::host::firmwareConfig(panel);
+    cfg.read_temperature = true;
+
+    epd::Driver driver;
+    ESP_ERROR_CHECK(driver.init(cfg));
+    ESP_ERROR_CHECK(epd::bench::runUploadBenchmark(driver, cfg, WhileBG));
+    ESP_ERROR_CHECK(epd::bench::runPartialSessionBenchmark(driver, cfg, WhileBG));
+    ESP_ERROR_CHECK(epd::bench::runGrayBenchmark(driver, cfg, WhileBG));
+    printGrayLevels(panel);
+    timeGraySplit();
+    driver.resetTransferStats();
+    ESP_ERROR_CHECK(runWaveformSweep(driver, panel));
+    driver.deinit();
+
+    epd::host::printPanelStats("panel", panel);
+    return panel.stats().busy_violations == 0 ? 0 : 1;
+}
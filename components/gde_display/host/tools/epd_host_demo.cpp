@@ -0,0 +1,175 @@
+/**
+ * @file Drive the emulated panel through the firmware's boot and digit-update flow.
+ *
+ * Usage: epd_host_demo [--no-shadow] [output_dir]. Writes one PBM of the visible image per step
+ * and prints what the controller received, so driver changes can be checked without hardware.
+ */
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "assets.h"
+#include "display_service.h"
+#include "esp_check.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "host_panel.h"
+
+namespace {
+
+using epd::host::Ssd1677Emulator;
+
+constexpr const char *TAG = "epd_host_demo";
+
+constexpr uint16_t kDigitRows = 48;
+constexpr uint16_t kDigitWidth = 104;
+constexpr uint16_t kDigitX = 344;
+constexpr uint16_t kDigitY = 120;
+
+void dump(const Ssd1677Emulator &panel, const std::string &dir, const char *name) {
+    const std::string path = dir + "/" + name + ".pbm";
+    if (!panel.writePbm(path.c_str())) {
+        std::fprintf(stderr, "cannot write %s\n", path.c_str());
+    }
+    epd::host::printPanelStats(name, panel);
+}
+
+/** @brief Show a five-digit value, most significant digit first along the RAM y axis. */
+esp_err_t showValue(epd::Driver &driver, unsigned value) {
+    std::array<const uint8_t *, 5> glyphs{};
+    for (int i = 4; i >= 0; --i) {
+        glyphs[i] = Num[value % 10];
+        value /= 10;
+    }
+    return driver.displayDigits(kDigitX, kDigitY + 0 * kDigitRows, glyphs[0],
+                                kDigitX, kDigitY + 1 * kDigitRows, glyphs[1],
+                                kDigitX, kDigitY + 2 * kDigitRows, glyphs[2],
+                                kDigitX, kDigitY + 3 * kDigitRows, glyphs[3],
+                                kDigitX, kDigitY + 4 * kDigitRows, glyphs[4],
+                                kDigitRows, kDigitWidth);
+}
+
+/**
+ * @brief Queue a value through a DisplayService with fewer buffers than digits.
+ *
+ * There is no service task on the host, so the producer's own waits run the queue; the last
+ * buffer acquisition finds every buffer staged and forces the early flush path.
+ */
+esp_err_t showValueQueued(epd::DisplayService &service, unsigned value) {
+    std::array<const uint8_t *, 5> glyphs{};
+    for (int i = 4; i >= 0; --i) {
+        glyphs[i] = Num[value % 10];
+        value /= 10;
+    }
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        uint8_t *buffer = service.acquireBuffer();
+        if (buffer == nullptr) {
+            return ESP_ERR_NO_MEM;
+        }
+        std::memcpy(buffer, glyphs[i], kDigitWidth / 8 * kDigitRows);
+        epd::Region region;
+        region.x = kDigitX;
+        region.y = static_cast<uint16_t>(kDigitY + i * kDigitRows);
+        region.width = kDigitWidth;
+        region.height = kDigitRows;
+        region.data = buffer;
+        ESP_RETURN_ON_ERROR(service.submitRegion(region), TAG, "region");
+    }
+    ESP_RETURN_ON_ERROR(service.submitCommit(), TAG, "commit");
+    service.drain();
+    return ESP_OK;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    bool shadow = true;
+    std::string out_dir = ".";
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-shadow") == 0) {
+            shadow = false;
+        } else {
+            out_dir = argv[i];
+        }
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    Ssd1677Emulator panel;
+    epd::Config cfg = epd::host::firmwareConfig(panel);
+    cfg.async_upload = true;
+    cfg.shadow_framebuffer = shadow;
+    cfg.ghost_budget = 3;
+
+    epd::Driver driver;
+    ESP_ERROR_CHECK(driver.init(cfg));
+    ESP_ERROR_CHECK(driver.hardwareInit());
+    ESP_ERROR_CHECK(driver.clear(0xFF));
+    dump(panel, out_dir, "clear");
+    ESP_ERROR_CHECK(driver.loadBaseMap(WhileBG, false));
+    dump(panel, out_dir, "base");
+
+    for (unsigned value : {12345u, 12346u, 12345u, 90817u}) {
+        ESP_ERROR_CHECK(showValue(driver, value));
+        const std::string name = "digits_" + std::to_string(value);
+        dump(panel, out_dir, name.c_str());
+    }
+
+    const size_t due = driver.ghostBudget().tilesAtLeast(cfg.ghost_budget);
+    ESP_ERROR_CHECK(driver.runCleaning());
+    std::printf("cleaning: %zu tiles due, %u refreshes, max count after %u\n", due,
+                static_cast<unsigned>(driver.transferStats().cleaning_refreshes),
+                static_cast<unsigned>(driver.ghostBudget().maxCount()));
+    dump(panel, out_dir, "cleaned");
+
+    epd::DisplayService service(driver);
+    epd::ServiceConfig service_cfg;
+    service_cfg.buffer_count = 4;
+    service_cfg.buffer_bytes = kDigitWidth / 8 * kDigitRows;
+    ESP_ERROR_CHECK(service.init(service_cfg));
+    if (service.start() != ESP_ERR_NOT_SUPPORTED) {
+        std::fprintf(stderr, "unexpected service task on the host\n");
+        return 1;
+    }
+    // The frame itself must not touch the heap: buffers and queue were set up by init().
+    const uint32_t allocations_before = epd::host::heapStats().allocations;
+    ESP_ERROR_CHECK(showValueQueued(service, 24680));
+    const uint32_t frame_allocations = epd::host::heapStats().allocations - allocations_before;
+    dump(panel, out_dir, "service_24680");
+    const epd::ServiceStats service_stats = service.stats();
+    std::printf("service: %u/%u commands executed, %u errors, max depth %u, max buffers %u, "
+                "%u buffer waits, %u heap allocations, %u DMA bounces\n",
+                static_cast<unsigned>(service_stats.executed),
+                static_cast<unsigned>(service_stats.submitted),
+                static_cast<unsigned>(service_stats.errors),
+                static_cast<unsigned>(service_stats.max_queue_depth),
+                static_cast<unsigned>(service_stats.max_buffers_in_use),
+                static_cast<unsigned>(service_stats.buffer_waits),
+                static_cast<unsigned>(frame_allocations),
+                static_cast<unsigned>(service_stats.dma_bounce_transfers));
+    service.deinit();
+
+    // Bytes where the panel does not show RAM 0x24, i.e. pixels a partial update failed to drive.
+    std::printf("stale bytes (visible != 0x24): %zu\n",
+                panel.diffBytes(Ssd1677Emulator::Plane::kVisible, Ssd1677Emulator::Plane::kNew));
+
+    ESP_ERROR_CHECK(driver.deepSleep());
+    const epd::TransferStats &stats = driver.transferStats();
+    std::printf("driver: %u transactions, %llu data bytes, %u/%llu windows/bytes, %u resets, "
+                "%u skipped commands, %llu unchanged bytes, %u/%llu 0x26 windows/bytes, "
+                "%u/%u bounced/inline-edge transfers, busy wait %.1f ms\n",
+                static_cast<unsigned>(stats.transactions),
+                static_cast<unsigned long long>(stats.data_bytes),
+                static_cast<unsigned>(stats.partial_windows),
+                static_cast<unsigned long long>(stats.partial_window_bytes),
+                static_cast<unsigned>(stats.controller_resets),
+                static_cast<unsigned>(stats.skipped_commands),
+                static_cast<unsigned long long>(stats.unchanged_bytes),
+                static_cast<unsigned>(stats.old_plane_windows),
+                static_cast<unsigned long long>(stats.old_plane_bytes),
+                static_cast<unsigned>(stats.dma_bounce_transfers),
+                static_cast<unsigned>(stats.inline_edge_transfers),
+                stats.busy_wait_us / 1000.0);
+    driver.deinit();
+    return 0;
+}
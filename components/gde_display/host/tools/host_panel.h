@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdio>
+
+#include "epd_driver.h"
+#include "host_hal.h"
+#include "ssd1677_emulator.h"
+
+namespace epd::host {
+
+/** @brief The firmware's pin map (main/main.cpp), wired to @p panel. */
+inline Config firmwareConfig(Ssd1677Emulator &panel) {
+    Config cfg;
+    cfg.host = SPI2_HOST;
+    cfg.mosi = GPIO_NUM_0;
+    cfg.sclk = GPIO_NUM_1;
+    cfg.cs = GPIO_NUM_21;
+    cfg.dc = GPIO_NUM_15;
+    cfg.rst = GPIO_NUM_23;
+    cfg.busy = GPIO_NUM_20;
+    cfg.clk_speed_hz = 20 * 1000 * 1000;
+    connectPanel(&panel, cfg.dc, cfg.rst, cfg.busy);
+    return cfg;
+}
+
+/** @brief One-line summary of what the emulated controller has seen. */
+inline void printPanelStats(const char *label, const Ssd1677Emulator &panel) {
+    const Ssd1677Emulator::Stats &s = panel.stats();
+    std::printf("%-14s t=%9.3f ms  cmds=%5u data=%8llu ram=%8llu full=%u partial=%u resets=%u "
+                "busy_ms=%.1f violations=%u/%u clipped=%u\n",
+                label, nowUs() / 1000.0, static_cast<unsigned>(s.commands),
+                static_cast<unsigned long long>(s.data_bytes),
+                static_cast<unsigned long long>(s.ram_bytes),
+                static_cast<unsigned>(s.full_refreshes), static_cast<unsigned>(s.partial_refreshes),
+                static_cast<unsigned>(s.hardware_resets), s.busy_us / 1000.0,
+                static_cast<unsigned>(s.busy_violations), static_cast<unsigned>(s.sleep_violations),
+                static_cast<unsigned>(s.clipped_writes));
+}
+
+}  // namespace epd::host
@@ -0,0 +1,253 @@
+#include "pixel_convert.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace epd {
+namespace {
+
+/** @brief Weighted luminance (x100) below which a pixel is black. */
+constexpr uint32_t kBlackBelow = 128U * 100U;
+/** @brief Weighted luminance (x100) of a white pixel. */
+constexpr int32_t kWhiteLuma = 255 * 100;
+
+constexpr bool computeWhite(uint32_t pixel) {
+    const uint32_t red = ((pixel >> 11) & 0x1F) * 255 / 31;
+    const uint32_t green = ((pixel >> 5) & 0x3F) * 255 / 63;
+    const uint32_t blue = (pixel & 0x1F) * 255 / 31;
+    return red * 30 + green * 59 + blue * 11 >= kBlackBelow;
+}
+
+/** @brief One bit per RGB565 value: bit (v & 7) of byte (v >> 3) is set when v is white. */
+constexpr auto kWhiteBits = [] {
+    std::array<uint8_t, 65536 / 8> table{};
+    for (uint32_t pixel = 0; pixel < 65536; ++pixel) {
+        if (computeWhite(pixel)) {
+            table[pixel >> 3] |= static_cast<uint8_t>(1U << (pixel & 7));
+        }
+    }
+    return table;
+}();
+
+/** @brief Weighted contribution (x100) of each channel value, as in computeWhite(). */
+template <size_t Levels>
+constexpr auto channelLuma(uint32_t weight) {
+    std::array<uint16_t, Levels> table{};
+    for (uint32_t level = 0; level < Levels; ++level) {
+        table[level] = static_cast<uint16_t>(level * 255 / (Levels - 1) * weight);
+    }
+    return table;
+}
+
+constexpr auto kLumaRed = channelLuma<32>(30);
+constexpr auto kLumaGreen = channelLuma<64>(59);
+constexpr auto kLumaBlue = channelLuma<32>(11);
+
+/**
+ * @brief Ordered-dither thresholds (x100 luminance) for an N x N Bayer matrix.
+ *
+ * Entry [y][x] is (2 * rank + 1) * 12800 / N^2, so a flat 50 % grey lights half the cells and
+ * pure black/white stay solid.
+ */
+template <size_t N>
+constexpr auto bayerThresholds() {
+    uint32_t bits = 0;
+    while ((1U << bits) < N) {
+        ++bits;
+    }
+    std::array<std::array<uint16_t, N>, N> table{};
+    for (uint32_t y = 0; y < N; ++y) {
+        for (uint32_t x = 0; x < N; ++x) {
+            uint32_t rank = 0;
+            for (uint32_t k = 0; k < bits; ++k) {
+                const uint32_t shift = 2 * (bits - 1 - k);
+                rank |= (((x ^ y) >> k) & 1U) << (shift + 1);
+                rank |= ((y >> k) & 1U) << shift;
+            }
+            table[y][x] = static_cast<uint16_t>((2 * rank + 1) * kBlackBelow / (N * N));
+        }
+    }
+    return table;
+}
+
+constexpr auto kBayer4 = bayerThresholds<4>();
+constexpr auto kBayer8 = bayerThresholds<8>();
+
+inline uint16_t rgb565At(const uint8_t *px) {
+    return static_cast<uint16_t>(px[0] | (px[1] << 8));
+}
+
+inline uint32_t whiteBit(const uint8_t *px) {
+    const uint32_t pixel = rgb565At(px);
+    return (kWhiteBits[pixel >> 3] >> (pixel & 7)) & 1U;
+}
+
+inline int32_t luma(const uint8_t *px) {
+    const uint32_t pixel = rgb565At(px);
+    return kLumaRed[pixel >> 11] + kLumaGreen[(pixel >> 5) & 0x3F] + kLumaBlue[pixel & 0x1F];
+}
+
+/** @brief Read-modify-write @p n output bits starting at @p bit of @p *dst. */
+template <typename BitFn>
+inline const uint8_t *packPartialByte(const uint8_t *px, ptrdiff_t step, uint8_t *dst,
+                                      unsigned bit, size_t n, BitFn &bit_of) {
+    uint8_t byte = *dst;
+    for (size_t i = 0; i < n; ++i, ++bit, px += step) {
+        const uint8_t mask = static_cast<uint8_t>(0x80U >> bit);
+        byte = bit_of(px) ? static_cast<uint8_t>(byte | mask)
+                          : static_cast<uint8_t>(byte & ~mask);
+    }
+    *dst = byte;
+    return px;
+}
+
+/**
+ * @brief Shared row driver: @p bit_of is called once per pixel in output order and returns
+ *        1 for white. Handles the partial head/tail bytes and the 8/32-pixel stores.
+ */
+template <bool Mirror, PackStore Store, typename BitFn>
+inline void packBits(const uint8_t *src, size_t count, uint8_t *dst, unsigned dst_bit,
+                     BitFn &&bit_of) {
+    if (count == 0) {
+        return;
+    }
+    constexpr ptrdiff_t step = Mirror ? -2 : 2;
+    const uint8_t *px = Mirror ? src + (count - 1) * 2 : src;
+    dst += dst_bit / 8;
+    dst_bit %= 8;
+
+    // Head: finish the partially covered first byte.
+    if (dst_bit != 0) {
+        const size_t n = count < 8 - dst_bit ? count : 8 - dst_bit;
+        px = packPartialByte(px, step, dst, dst_bit, n, bit_of);
+        count -= n;
+        ++dst;
+    }
+
+    if constexpr (Store == PackStore::kWord) {
+        for (; count >= 32; count -= 32) {
+            uint32_t word = 0;
+            for (unsigned i = 0; i < 32; ++i, px += step) {
+                word = (word << 1) | bit_of(px);
+            }
+            word = __builtin_bswap32(word);  // MSB-first pixels, little-endian store
+            std::memcpy(dst, &word, sizeof(word));
+            dst += sizeof(word);
+        }
+    }
+    for (; count >= 8; count -= 8) {
+        uint32_t byte = 0;
+        for (unsigned i = 0; i < 8; ++i, px += step) {
+            byte = (byte << 1) | bit_of(px);
+        }
+        *dst++ = static_cast<uint8_t>(byte);
+    }
+
+    if (count != 0) {
+        packPartialByte(px, step, dst, 0, count, bit_of);
+    }
+}
+
+/** @brief Ordered dither: compare each pixel with its cell of the N x N threshold matrix. */
+template <bool Mirror, size_t N>
+void packOrdered(const std::array<std::array<uint16_t, N>, N> &matrix, const uint8_t *src,
+                 size_t count, int32_t x, int32_t y, uint8_t *dst, unsigned dst_bit) {
+    const auto &thresholds = matrix[static_cast<uint32_t>(y) % N];
+    uint32_t column = static_cast<uint32_t>(x) + (Mirror ? static_cast<uint32_t>(count - 1) : 0);
+    packBits<Mirror, PackStore::kWord>(src, count, dst, dst_bit, [&](const uint8_t *px) {
+        const uint32_t bit = luma(px) >= thresholds[column % N] ? 1U : 0U;
+        column = Mirror ? column - 1 : column + 1;
+        return bit;
+    });
+}
+
+/**
+ * @brief Floyd-Steinberg in output order: 7/16 to the next pixel, 3/16, 5/16 and 1/16 to the
+ *        three pixels below. The next-row shares are accumulated in registers and written
+ *        behind the scan, so one error row serves both the incoming and the outgoing error.
+ */
+template <bool Mirror>
+void packDiffused(int32_t *errors, const uint8_t *src, size_t count, uint8_t *dst,
+                  unsigned dst_bit) {
+    int32_t right = 0;       // share for the next pixel in this row
+    int32_t below_left = 0;  // next-row error of the previous output pixel so far
+    int32_t below = 0;       // next-row error of the current output pixel
+    int32_t *slot = errors;  // errors[i] = next-row slot of output pixel i - 1
+    packBits<Mirror, PackStore::kWord>(src, count, dst, dst_bit, [&](const uint8_t *px) {
+        const int32_t value = luma(px) + slot[1] + right;
+        const uint32_t bit = value >= static_cast<int32_t>(kBlackBelow) ? 1U : 0U;
+        const int32_t error = value - (bit != 0 ? kWhiteLuma : 0);
+        right = (error * 7) >> 4;
+        *slot++ = below_left + ((error * 3) >> 4);
+        below_left = below + ((error * 5) >> 4);
+        below = error >> 4;
+        return bit;
+    });
+    *slot = below_left;
+}
+
+}  // namespace
+
+void ErrorDiffusion::reset() {
+    next_y_ = -1;
+}
+
+int32_t *ErrorDiffusion::beginRow(int32_t x, int32_t y, size_t count) {
+    if (count > kMaxWidth) {
+        return nullptr;
+    }
+    if (y != next_y_ || x != x_ || count != count_) {
+        std::fill_n(errors_.begin(), count + 1, 0);
+        x_ = x;
+        count_ = count;
+    }
+    next_y_ = y + 1;
+    return errors_.data();
+}
+
+bool rgb565IsWhite(uint16_t pixel) {
+    return (kWhiteBits[pixel >> 3] >> (pixel & 7)) & 1U;
+}
+
+template <bool Mirror, PackStore Store>
+void packRgb565Row(const uint8_t *src, size_t count, uint8_t *dst, unsigned dst_bit) {
+    packBits<Mirror, Store>(src, count, dst, dst_bit, whiteBit);
+}
+
+template <bool Mirror>
+void ditherRgb565Row(Dither mode, const uint8_t *src, size_t count, int32_t x, int32_t y,
+                     uint8_t *dst, unsigned dst_bit, ErrorDiffusion *diffusion) {
+    switch (mode) {
+    case Dither::kBayer4:
+        packOrdered<Mirror>(kBayer4, src, count, x, y, dst, dst_bit);
+        return;
+    case Dither::kBayer8:
+        packOrdered<Mirror>(kBayer8, src, count, x, y, dst, dst_bit);
+        return;
+    case Dither::kFloydSteinberg:
+        if (int32_t *errors = diffusion != nullptr ? diffusion->beginRow(x, y, count) : nullptr) {
+            packDiffused<Mirror>(errors, src, count, dst, dst_bit);
+            return;
+        }
+        break;
+    case Dither::kThreshold:
+        break;
+    }
+    packRgb565Row<Mirror>(src, count, dst, dst_bit);
+}
+
+template void packRgb565Row<false, PackStore::kByte>(const uint8_t *, size_t, uint8_t *,
+                                                     unsigned);
+template void packRgb565Row<false, PackStore::kWord>(const uint8_t *, size_t, uint8_t *,
+                                                     unsigned);
+template void packRgb565Row<true, PackStore::kByte>(const uint8_t *, size_t, uint8_t *,
+                                                    unsigned);
+template void packRgb565Row<true, PackStore::kWord>(const uint8_t *, size_t, uint8_t *,
+                                                    unsigned);
+template void ditherRgb565Row<false>(Dither, const uint8_t *, size_t, int32_t, int32_t,
+                                     uint8_t *, unsigned, ErrorDiffusion *);
+template void ditherRgb565Row<true>(Dither, const uint8_t *, size_t, int32_t, int32_t,
+                                    uint8_t *, unsigned, ErrorDiffusion *);
+
+}  // namespace epd
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace epd {
+
+/** @brief How many packed pixels a conversion kernel assembles before each store. */
+enum class PackStore : uint8_t {
+    kByte,  ///< 8 pixels per store.
+    kWord,  ///< 32 pixels per store, falling back to bytes for the rest of the row.
+};
+
+/** @brief How grey levels between black and white are reproduced in 1bpp output. */
+enum class Dither : uint8_t {
+    kThreshold,       ///< Hard 50 % threshold, same result as packRgb565Row().
+    kBayer4,          ///< 4x4 ordered dither anchored to source coordinates.
+    kBayer8,          ///< 8x8 ordered dither anchored to source coordinates.
+    kFloydSteinberg,  ///< Error diffusion carried across rows and strips (ErrorDiffusion).
+};
+
+/**
+ * @brief Floyd-Steinberg error carried from one row to the next.
+ *
+ * Rows must be fed top to bottom. The error row is kept while each row continues the previous
+ * one over the same columns, so an area rendered in several strips dithers as one image; any
+ * other row (a new area or a new frame) starts from zero error.
+ */
+class ErrorDiffusion {
+public:
+    static constexpr size_t kMaxWidth = 800;  ///< Longest side of the panel.
+
+    /** @brief Forget the carried error; the next row starts clean. */
+    void reset();
+
+    /**
+     * @brief Error row for @p count pixels of row @p y starting at column @p x.
+     *
+     * Entry i + 1 holds the error diffused into output pixel i; entry 0 absorbs the error
+     * pushed left of the row. Returns nullptr when @p count exceeds kMaxWidth.
+     */
+    int32_t *beginRow(int32_t x, int32_t y, size_t count);
+
+private:
+    std::array<int32_t, kMaxWidth + 1> errors_{};
+    int32_t x_{0};
+    int32_t next_y_{-1};
+    size_t count_{0};
+};
+
+/**
+ * @brief True when an RGB565 pixel is white on the panel (luminance at or above 50 %).
+ *
+ * Uses the same weighting as the original flush loop (30/59/11 of the 8-bit expanded
+ * channels), precomputed into an 8 KB bit table.
+ */
+bool rgb565IsWhite(uint16_t pixel);
+
+/**
+ * @brief Pack one row of little-endian RGB565 pixels into 1bpp, MSB first, 1 = white.
+ *
+ * Output starts at bit @p dst_bit (counted from the MSB of @p dst); bits outside the
+ * @p count written ones keep their value. With @p Mirror the row is written right to left,
+ * i.e. source pixel i lands on output pixel count - 1 - i.
+ */
+template <bool Mirror, PackStore Store = PackStore::kWord>
+void packRgb565Row(const uint8_t *src, size_t count, uint8_t *dst, unsigned dst_bit = 0);
+
+extern template void packRgb565Row<false, PackStore::kByte>(const uint8_t *, size_t, uint8_t *,
+                                                            unsigned);
+extern template void packRgb565Row<false, PackStore::kWord>(const uint8_t *, size_t, uint8_t *,
+                                                            unsigned);
+extern template void packRgb565Row<true, PackStore::kByte>(const uint8_t *, size_t, uint8_t *,
+                                                           unsigned);
+extern template void packRgb565Row<true, PackStore::kWord>(const uint8_t *, size_t, uint8_t *,
+                                                           unsigned);
+
+/**
+ * @brief packRgb565Row() with dithering; @p x and @p y are the source coordinates of @p src[0].
+ *
+ * The ordered patterns are anchored to source coordinates so they stay put between partial
+ * refreshes. kFloydSteinberg needs @p diffusion and falls back to kThreshold without it.
+ */
+template <bool Mirror>
+void ditherRgb565Row(Dither mode, const uint8_t *src, size_t count, int32_t x, int32_t y,
+                     uint8_t *dst, unsigned dst_bit = 0, ErrorDiffusion *diffusion = nullptr);
+
+extern template void ditherRgb565Row<false>(Dither, const uint8_t *, size_t, int32_t, int32_t,
+                                            uint8_t *, unsigned, ErrorDiffusion *);
+extern template void ditherRgb565Row<true>(Dither, const uint8_t *, size_t, int32_t, int32_t,
+                                           uint8_t *, unsigned, ErrorDiffusion *);
+
+}  // namespace epd
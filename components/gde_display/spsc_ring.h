@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace epd {
+
+/**
+ * @brief Fixed-capacity ring for exactly one producer and one consumer thread.
+ *
+ * Each index is written by one side only and published with release ordering, so neither side
+ * takes a lock or disables interrupts. @p Capacity must be a power of two; one slot stays free
+ * to tell a full ring from an empty one.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "capacity must be a power of two");
+
+  public:
+    /** @brief Producer side: append @p item, or return false when the ring is full. */
+    bool push(const T &item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        const size_t next = (head + 1) & (Capacity - 1);
+        if (next == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        slots_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Consumer side: take the oldest item, or return false when the ring is empty. */
+    bool pop(T &item) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots_[tail];
+        tail_.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Items queued right now; exact only when called from either end. */
+    size_t size() const {
+        return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire)) &
+               (Capacity - 1);
+    }
+
+    static constexpr size_t capacity() { return Capacity - 1; }
+
+  private:
+    std::array<T, Capacity> slots_{};
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
+
+}  // namespace epd
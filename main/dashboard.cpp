@@ -0,0 +1,336 @@
+#include "dashboard.h"
+
+#include <cstdio>
+
+#include "sensor_table.h"
+
+namespace app {
+namespace {
+
+/** @brief ค่าคงที่ของแต่ละค่าเซ็นเซอร์ เรียงตาม SensorIndex */
+struct SensorSpec {
+  const char *name;
+  const char *format;  // ข้อความของ label (LVGL เก็บ pointer ไว้ตลอดอายุ binding)
+  int32_t hysteresis;  // ต้องห่างจากค่าที่แสดงอย่างน้อยเท่านี้จึงอัพเดท (1 = ทุกการเปลี่ยน)
+};
+
+constexpr SensorSpec kSensorSpecs[kSensorCount] = {
+    {"CO2", "%d", 10},
+    {"PM2.5", "%d", 1},
+    {"VOC", "%d", 5},
+    {"NOx", "%d", 1},
+    {"Temp", "%dC", 1},
+    {"Humi", "%d%%", 2},
+};
+
+/** @brief true ถ้าค่า @p index แสดงในช่องของ widget ตาราง แทน label */
+bool inSensorTable(const Dashboard &ui, size_t index) {
+  return ui.sensor_table != nullptr && index < kSensorTableCells;
+}
+
+/** @brief label ที่แสดงค่าของ @p index (nullptr ถ้าอยู่ใน widget ตาราง) */
+lv_obj_t *sensorLabel(const Dashboard &ui, size_t index) {
+  switch (index) {
+  case kCo2:
+  case kPm25:
+  case kVoc:
+    return ui.table_values[index];
+  case kNox:
+    return ui.nox_value_label;
+  case kTemperature:
+    return ui.status_temp_label;  // temp อยู่ซ้ายของ status bar
+  default:
+    return ui.status_humidity_label;  // humi อยู่ขวาของ status bar
+  }
+}
+
+/** @brief observer ของช่องค่าใน widget ตาราง: จัดรูปแบบเหมือน lv_label_bind_text() */
+void sensorTableObserver(lv_observer_t *observer, lv_subject_t *subject) {
+  const auto index = reinterpret_cast<uintptr_t>(lv_observer_get_user_data(observer));
+  char text[16];
+  std::snprintf(text, sizeof(text), kSensorSpecs[index].format,
+                static_cast<int>(lv_subject_get_int(subject)));
+  setSensorTableValue(lv_observer_get_target_obj(observer), index, text);
+}
+
+/** @brief ส่งค่าเดียวเข้า model คืน true ถ้าข้อความบนจอจะเปลี่ยน */
+bool publishSensor(Dashboard &ui, size_t index, int32_t value) {
+  const SensorSpec &spec = kSensorSpecs[index];
+  SensorMetric &metric = ui.sensors[index];
+  if (!metric.bound) {
+    lv_subject_init_int(&metric.subject, value);
+    if (inSensorTable(ui, index)) {
+      lv_subject_add_observer_obj(&metric.subject, sensorTableObserver, ui.sensor_table,
+                                  reinterpret_cast<void *>(static_cast<uintptr_t>(index)));
+    } else {
+      lv_label_bind_text(sensorLabel(ui, index), &metric.subject, spec.format);
+    }
+    metric.bound = true;
+    ++metric.updates;
+    return true;
+  }
+  const int32_t shown = lv_subject_get_int(&metric.subject);
+  const int32_t delta = value > shown ? value - shown : shown - value;
+  if (delta == 0 || delta < spec.hysteresis) {
+    ++metric.suppressed;
+    return false;
+  }
+  lv_subject_set_int(&metric.subject, value);
+  ++metric.updates;
+  return true;
+}
+
+}  // namespace
+
+const char *sensorName(size_t index) {
+  return index < kSensorCount ? kSensorSpecs[index].name : "?";
+}
+
+uint32_t publishReadings(Dashboard &ui, const SensorReadings &readings) {
+  uint32_t changed = 0;
+  for (size_t i = 0; i < kSensorCount; ++i) {
+    changed += publishSensor(ui, i, readings[i]) ? 1 : 0;
+  }
+  return changed;
+}
+
+uint32_t suppressedUpdates(const Dashboard &ui) {
+  uint32_t suppressed = 0;
+  for (const SensorMetric &metric : ui.sensors) {
+    suppressed += metric.suppressed;
+  }
+  return suppressed;
+}
+
+UiFootprint measureUi(lv_obj_t *root) {
+  UiFootprint footprint;
+  lv_obj_tree_walk(
+      root,
+      [](lv_obj_t *, void *user_data) {
+        ++static_cast<UiFootprint *>(user_data)->objects;
+        return LV_OBJ_TREE_WALK_NEXT;
+      },
+      &footprint);
+  --footprint.objects;  // ไม่นับ root
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+  lv_mem_monitor_t monitor;
+  lv_mem_monitor(&monitor);
+  footprint.heap_used = monitor.total_size - monitor.free_size;
+#endif
+  return footprint;
+}
+
+void setLiveLabelsHidden(Dashboard &ui, bool hidden) {
+  if (ui.sensor_table != nullptr) {
+    setSensorTableValuesHidden(ui.sensor_table, hidden);
+  }
+  for (size_t i = 0; i < kSensorCount; ++i) {
+    lv_obj_t *label = sensorLabel(ui, i);
+    if (label == nullptr) {
+      continue;  // ช่องของ widget ตาราง
+    } else if (hidden) {
+      lv_obj_add_flag(label, LV_OBJ_FLAG_HIDDEN);
+    } else {
+      lv_obj_remove_flag(label, LV_OBJ_FLAG_HIDDEN);
+    }
+  }
+}
+
+void dropStaticWidgets(lv_display_t *display, Dashboard &ui) {
+  lv_display_enable_invalidation(display, false);
+  if (ui.sensor_table != nullptr) {
+    setSensorTableStaticHidden(ui.sensor_table, true);
+  }
+  for (lv_obj_t *container : {ui.status_bar, ui.table_container}) {
+    if (container == nullptr) {
+      continue;
+    }
+    // border_opa แทน border_width: ความหนาขอบยังกันพื้นที่ content ไว้เท่าเดิม
+    lv_obj_set_style_border_opa(container, LV_OPA_TRANSP, LV_PART_MAIN);
+    for (int32_t i = static_cast<int32_t>(lv_obj_get_child_count(container)) - 1; i >= 0; --i) {
+      lv_obj_t *child = lv_obj_get_child(container, i);
+      bool live = false;
+      for (size_t sensor = 0; sensor < kSensorCount; ++sensor) {
+        live = live || child == sensorLabel(ui, sensor);
+      }
+      if (!live) {
+        lv_obj_delete(child);
+      }
+    }
+  }
+  for (size_t i = 0; i < 3; ++i) {
+    ui.table_headings[i] = nullptr;
+    ui.table_units[i] = nullptr;
+  }
+  lv_obj_update_layout(lv_obj_get_screen(ui.status_bar));  // จัด layout ตอนนี้ ไม่ใช่ตอน render
+  lv_display_enable_invalidation(display, true);
+}
+
+void createDashboard(lv_obj_t *screen, Dashboard &ui, TableImpl table) {
+  lv_obj_set_style_bg_color(screen, lv_color_white(), LV_PART_MAIN);
+  lv_obj_set_style_bg_opa(screen, LV_OPA_COVER, LV_PART_MAIN);
+
+  constexpr lv_coord_t kScreenMargin = 16;
+  constexpr lv_coord_t kStatusBarHeight = 64;
+  constexpr lv_coord_t kTableGap = 16;
+  constexpr lv_coord_t kHeaderRowHeight = 60;
+  constexpr lv_coord_t kValueRowHeight = 80;   // ลดลงเพื่อให้มีพื้นที่สำหรับแถวที่ 4
+  constexpr lv_coord_t kUnitRowHeight = 50;    // แถวหน่วย
+  constexpr lv_coord_t kDividerThickness = 8;  // เพิ่มจาก 4 เป็น 8 px
+
+  const lv_coord_t content_width = lv_obj_get_width(screen) - 2 * kScreenMargin;
+
+  ui.status_bar = lv_obj_create(screen);
+  lv_obj_set_size(ui.status_bar, content_width, kStatusBarHeight);
+  lv_obj_set_pos(ui.status_bar, kScreenMargin, kScreenMargin);
+  lv_obj_set_style_bg_opa(ui.status_bar, LV_OPA_TRANSP, LV_PART_MAIN);
+  lv_obj_set_style_border_color(ui.status_bar, lv_color_black(), LV_PART_MAIN);
+  lv_obj_set_style_border_width(ui.status_bar, 2, LV_PART_MAIN);
+  lv_obj_set_style_border_side(ui.status_bar, LV_BORDER_SIDE_BOTTOM, LV_PART_MAIN);
+  lv_obj_set_style_pad_all(ui.status_bar, 0, LV_PART_MAIN);
+
+  ui.status_temp_label = lv_label_create(ui.status_bar);
+  lv_obj_set_style_text_color(ui.status_temp_label, lv_color_black(), LV_PART_MAIN);
+  lv_obj_set_style_text_font(ui.status_temp_label, &lv_font_montserrat_24, LV_PART_MAIN);
+  lv_obj_set_style_text_align(ui.status_temp_label, LV_TEXT_ALIGN_LEFT, LV_PART_MAIN);
+  lv_label_set_text(ui.status_temp_label, "26.5C");
+  lv_obj_align(ui.status_temp_label, LV_ALIGN_LEFT_MID, 8, 0);
+
+  ui.status_humidity_label = lv_label_create(ui.status_bar);
+  lv_obj_set_style_text_color(ui.status_humidity_label, lv_color_black(), LV_PART_MAIN);
+  lv_obj_set_style_text_font(ui.status_humidity_label, &lv_font_montserrat_24,
+                             LV_PART_MAIN);
+  lv_obj_set_style_text_align(ui.status_humidity_label, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);
+  lv_label_set_text(ui.status_humidity_label, "72%");
+  lv_obj_align(ui.status_humidity_label, LV_ALIGN_RIGHT_MID, -8, 0);
+
+  const lv_coord_t table_y = kScreenMargin + kStatusBarHeight + kTableGap;
+  const lv_coord_t table_height = lv_obj_get_height(screen) - table_y - kScreenMargin;
+
+  if (table == TableImpl::kSensorTable) {
+    ui.sensor_table = createSensorTable(screen);
+    lv_obj_set_size(ui.sensor_table, content_width, table_height);
+    lv_obj_set_pos(ui.sensor_table, kScreenMargin, table_y);
+    const char *const samples[kSensorTableCells] = {"741", "0", "105", "105"};
+    for (size_t cell = 0; cell < kSensorTableCells; ++cell) {
+      setSensorTableValue(ui.sensor_table, cell, samples[cell]);
+    }
+    return;
+  }
+
+  ui.table_container = lv_obj_create(screen);
+  lv_obj_set_size(ui.table_container, content_width, table_height);
+  lv_obj_set_pos(ui.table_container, kScreenMargin, table_y);
+  lv_obj_set_style_bg_opa(ui.table_container, LV_OPA_TRANSP, LV_PART_MAIN);
+  lv_obj_set_style_border_color(ui.table_container, lv_color_black(), LV_PART_MAIN);
+  lv_obj_set_style_border_width(ui.table_container, 2, LV_PART_MAIN);
+  lv_obj_set_style_radius(ui.table_container, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_all(ui.table_container, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_row(ui.table_container, 0, LV_PART_MAIN);
+  lv_obj_set_style_pad_column(ui.table_container, 0, LV_PART_MAIN);
+
+  static lv_coord_t column_dsc[] = {LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1),
+                                    LV_GRID_TEMPLATE_LAST};
+  static lv_coord_t row_dsc[] = {
+      kHeaderRowHeight,      // แถวที่ 0: 60px (หัวตาราง: CO2, PM2.5, VOC)
+      kValueRowHeight,       // แถวที่ 1: 80px (ค่า: 741, 0, 105)
+      kUnitRowHeight,        // แถวที่ 2: 50px (หน่วย: ppm, ug/m3, NOx)
+      LV_GRID_FR(1),         // แถวที่ 3: ที่เหลือ (ว่าง, ว่าง, 105)
+      LV_GRID_TEMPLATE_LAST
+  };
+  lv_obj_set_layout(ui.table_container, LV_LAYOUT_GRID);
+  lv_obj_set_grid_dsc_array(ui.table_container, column_dsc, row_dsc);
+
+  const char *const headings[] = {"CO2", "PM2.5", "VOC"};
+  const char *const sample_values[] = {"741", "0", "105"};
+  const char *const units[] = {"ppm", "ug/m3", "NOx"};
+  const char *const nox_value = "105";
+
+  for (size_t i = 0; i < 3; ++i) {
+    // แถวที่ 0: หัวตาราง (CO2, PM2.5, VOC)
+    ui.table_headings[i] = lv_label_create(ui.table_container);
+    lv_obj_set_style_text_color(ui.table_headings[i], lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_style_text_font(ui.table_headings[i], &lv_font_montserrat_24, LV_PART_MAIN);
+    lv_obj_set_style_text_align(ui.table_headings[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+    lv_label_set_text(ui.table_headings[i], headings[i]);
+    lv_obj_set_grid_cell(ui.table_headings[i], LV_GRID_ALIGN_CENTER, i, 1,
+                         LV_GRID_ALIGN_CENTER, 0, 1);
+
+    // แถวที่ 1: ค่าหลัก (741, 0, 105)
+    ui.table_values[i] = lv_label_create(ui.table_container);
+    lv_obj_set_style_text_color(ui.table_values[i], lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_style_text_font(ui.table_values[i], &lv_font_montserrat_48, LV_PART_MAIN);
+    lv_obj_set_style_text_align(ui.table_values[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+    lv_label_set_text(ui.table_values[i], sample_values[i]);
+    lv_obj_set_grid_cell(ui.table_values[i], LV_GRID_ALIGN_CENTER, i, 1,
+                         LV_GRID_ALIGN_CENTER, 1, 1);
+
+    // แถวที่ 2: หน่วย (ppm, ug/m3, NOx)
+    ui.table_units[i] = lv_label_create(ui.table_container);
+    lv_obj_set_style_text_color(ui.table_units[i], lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_style_text_font(ui.table_units[i], &lv_font_montserrat_20, LV_PART_MAIN);
+    lv_obj_set_style_text_align(ui.table_units[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+    lv_label_set_text(ui.table_units[i], units[i]);
+    lv_obj_set_grid_cell(ui.table_units[i], LV_GRID_ALIGN_CENTER, i, 1, 
+                         LV_GRID_ALIGN_CENTER, 2, 1);
+  }
+
+  // แถวที่ 3: เฉพาะคอลัมน์ที่ 3 (NOx value = 105)
+  ui.nox_value_label = lv_label_create(ui.table_container);
+  lv_obj_set_style_text_color(ui.nox_value_label, lv_color_black(), LV_PART_MAIN);
+  lv_obj_set_style_text_font(ui.nox_value_label, &lv_font_montserrat_48, LV_PART_MAIN);
+  lv_obj_set_style_text_align(ui.nox_value_label, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
+  lv_label_set_text(ui.nox_value_label, nox_value);
+  lv_obj_set_grid_cell(ui.nox_value_label, LV_GRID_ALIGN_CENTER, 2, 1,  // คอลัมน์ที่ 2 (index 2)
+                       LV_GRID_ALIGN_CENTER, 3, 1);                  // แถวที่ 3 (index 3)
+
+
+  // วาดเส้นแบ่งหลังจากสร้าง labels เสร็จแล้ว
+  // ตำแหน่ง/ความกว้างไม่อ่านจากขนาด container: ตอนนี้ยังไม่ได้จัด layout (ได้ 0)
+  // 3 เส้นแนวนอน สำหรับแบ่ง 4 แถว
+  const lv_coord_t horizontal_positions[] = {
+      kHeaderRowHeight,                                  // y = 60
+      kHeaderRowHeight + kValueRowHeight,                // y = 60 + 80 = 140
+      kHeaderRowHeight + kValueRowHeight + kUnitRowHeight // y = 60 + 80 + 50 = 190
+  };
+
+  // ใช้ lv_line สำหรับวาดเส้นแนวตั้ง (ชัดเจนกว่า obj) ที่ x = 0 ของ object
+  static lv_point_precise_t vertical_line_points[] = {
+      {0, 0},
+      {0, 0}  // จะ set ใน runtime
+  };
+  vertical_line_points[1].y = table_height;
+
+  // เส้นแนวตั้ง 2 เส้นที่ขอบซ้ายของคอลัมน์ 1 และ 2 ให้ grid วางตำแหน่ง จึงตรงกับช่องของ label
+  for (int32_t column = 1; column < 3; ++column) {
+    lv_obj_t *vline = lv_line_create(ui.table_container);
+    lv_line_set_points(vline, vertical_line_points, 2);
+    lv_obj_set_style_line_width(vline, kDividerThickness, LV_PART_MAIN);
+    lv_obj_set_style_line_color(vline, lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_grid_cell(vline, LV_GRID_ALIGN_START, column, 1, LV_GRID_ALIGN_START, 0, 4);
+    lv_obj_move_foreground(vline);
+  }
+
+  // วาดเส้นแนวนอนด้วย obj ธรรมดา กว้างเต็ม content ของ container
+  auto add_horizontal_divider = [](lv_obj_t *parent, lv_coord_t y, lv_coord_t thickness) {
+    lv_obj_t *line = lv_obj_create(parent);
+    lv_obj_set_size(line, lv_pct(100), thickness);
+    lv_obj_set_pos(line, 0, y - thickness / 2);
+    lv_obj_set_style_bg_color(line, lv_color_black(), LV_PART_MAIN);
+    lv_obj_set_style_bg_opa(line, LV_OPA_COVER, LV_PART_MAIN);
+    lv_obj_set_style_border_width(line, 0, LV_PART_MAIN);
+    lv_obj_set_style_radius(line, 0, LV_PART_MAIN);
+    lv_obj_set_style_pad_all(line, 0, LV_PART_MAIN);
+    lv_obj_clear_flag(line, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_flag(line, LV_OBJ_FLAG_IGNORE_LAYOUT);
+    lv_obj_move_foreground(line);
+    lv_obj_invalidate(line);
+  };
+
+  // วาดเส้นแนวนอน 3 เส้น (แบ่ง 4 แถว)
+  for (lv_coord_t y : horizontal_positions) {
+    add_horizontal_divider(ui.table_container, y, kDividerThickness);
+  }
+}
+
+}  // namespace app
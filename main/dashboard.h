@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "lvgl.h"
+
+namespace app {
+
+/** @brief ลำดับค่าเซ็นเซอร์ใน SensorReadings และ Dashboard::sensors */
+enum SensorIndex : size_t { kCo2, kPm25, kVoc, kNox, kTemperature, kHumidity, kSensorCount };
+
+/** @brief ค่าที่อ่านได้หนึ่งรอบ เรียงตาม SensorIndex */
+using SensorReadings = std::array<int32_t, kSensorCount>;
+
+/**
+ * @brief ค่าเซ็นเซอร์หนึ่งตัวใน data model: lv_subject_t ที่ผูกกับ label ด้วย lv_label_bind_text()
+ *
+ * ค่าใหม่ที่ห่างจากค่าที่แสดงอยู่น้อยกว่า hysteresis ของตัวนั้นถูกทิ้งและนับใน @c suppressed label
+ * จึงไม่ถูก invalidate ไม่มีการวาด/ส่งภาพ/refresh ส่วน lv_subject_set_int() แจ้ง observer
+ * เฉพาะเมื่อค่าเปลี่ยน
+ */
+struct SensorMetric {
+  lv_subject_t subject{};
+  bool bound{false};
+  uint32_t updates{0};
+  uint32_t suppressed{0};
+};
+
+/** @brief วิธีสร้างตารางค่าเซ็นเซอร์ */
+enum class TableImpl : uint8_t {
+  kObjectTree,   // container แบบ grid + label/lv_line/lv_obj แยกกันแบบเดิม
+  kSensorTable,  // widget เดียว (sensor_table.h) วาดทั้งตารางใน draw pass เดียว
+};
+
+/** @brief widget ของหน้า Air Quality Monitor และ data model ที่ผูกกับ label ค่า */
+struct Dashboard {
+  lv_obj_t *status_bar{nullptr};
+  lv_obj_t *status_temp_label{nullptr};
+  lv_obj_t *status_humidity_label{nullptr};
+  lv_obj_t *table_container{nullptr};
+  lv_obj_t *table_headings[3]{};
+  lv_obj_t *table_values[3]{};
+  lv_obj_t *table_units[3]{};
+  lv_obj_t *nox_value_label{nullptr};
+  lv_obj_t *sensor_table{nullptr};  // TableImpl::kSensorTable: แทน table_* ทั้งหมดข้างบน
+  std::array<SensorMetric, kSensorCount> sensors{};
+};
+
+/** @brief ชื่อของค่า @p index สำหรับ log */
+const char *sensorName(size_t index);
+
+/**
+ * @brief สร้าง status bar, ตาราง 3x4 และเส้นแบ่งบน @p screen (ขนาดเท่าจอ)
+ *
+ * ค่าแสดงข้อความตัวอย่างจนกว่า publishReadings() ครั้งแรกจะผูกกับ subject ตารางสร้างตาม @p table
+ */
+void createDashboard(lv_obj_t *screen, Dashboard &ui, TableImpl table);
+
+/**
+ * @brief ส่งค่าอ่านใหม่เข้า model คืนจำนวน label ที่ข้อความจะเปลี่ยน
+ *
+ * ค่าแรกของแต่ละตัวสร้าง subject และผูก label (แทนข้อความตัวอย่าง) ค่าถัดไปผ่าน hysteresis ก่อน
+ */
+uint32_t publishReadings(Dashboard &ui, const SensorReadings &readings);
+
+/** @brief จำนวนการอัพเดทที่ถูกข้ามสะสมของทุกค่า */
+uint32_t suppressedUpdates(const Dashboard &ui);
+
+/** @brief จำนวน object ใต้ @p root (ไม่นับตัวมันเอง) และ heap ของ LVGL ที่ใช้อยู่ทั้งหมด */
+struct UiFootprint {
+  uint32_t objects{0};
+  size_t heap_used{0};  // 0 ถ้า LVGL ไม่ได้ใช้ allocator ของตัวเอง (LV_STDLIB_BUILTIN)
+};
+
+/** @brief วัด UiFootprint ของ @p root ใช้เทียบก่อน/หลัง createDashboard() */
+UiFootprint measureUi(lv_obj_t *root);
+
+/** @brief ซ่อน/แสดง label ค่าทั้งหมด ใช้ตอนวาด layer คงที่ให้เหลือเฉพาะส่วนที่ไม่เปลี่ยน */
+void setLiveLabelsHidden(Dashboard &ui, bool hidden);
+
+/**
+ * @brief ลบ widget คงที่ (เส้นแบ่ง, หัวตาราง, หน่วย) หลังถูกวาดลง base map แล้ว
+ *
+ * ปิด invalidation ของ @p display ระหว่างลบ LVGL จึงไม่วาดพื้นที่นั้นใหม่เป็นสีขาว ขอบของ
+ * status bar/ตารางถูกทำให้โปร่งใสแต่ยังอยู่เป็นกล่อง layout ตำแหน่งของ label จึงไม่เปลี่ยน
+ */
+void dropStaticWidgets(lv_display_t *display, Dashboard &ui);
+
+}  // namespace app
@@ -0,0 +1,425 @@
+/**
+ * @file Render the firmware's LVGL dashboard on the host and push it through the emulated panel.
+ *
+ * Usage: dashboard_host [--tree] [--prerender] [--compare golden_dir] [output_dir]. The
+ * dashboard from main/dashboard.cpp is drawn into I1 strips exactly as on the device, packed with
+ * app::packStrip() and uploaded by the real epd::Driver behind a DisplayService; the SSD1677
+ * emulator captures the 1bpp result.
+ * A fixed sequence of sensor readings is replayed, and for every step the tool prints the host
+ * CPU time LVGL spent rendering, the flushes, pixels converted and bytes sent to RAM 0x24, and
+ * writes the visible image as frame_NN.pbm. Every frame must also equal a full redraw of the same
+ * UI state, so a partial window that lands outside its own cell fails the run. With --compare
+ * each frame must match the PBM of the same name in golden_dir byte for byte (exit status 1
+ * otherwise); main/host/golden holds the committed frames and ctest runs the comparison. An
+ * unknown option, a second output_dir or --compare without a directory prints the usage and
+ * exits with status 2.
+ *
+ * --tree builds the sensor table from the original grid container, labels and divider objects
+ * instead of the app::createSensorTable() widget. Before the frames the tool prints the objects
+ * and LVGL heap the dashboard took; after them, the mean render time of a full-screen redraw and
+ * of a single value change, rendered into a scratch frame so the panel is not involved.
+ *
+ * --prerender follows main.cpp's kPrerenderStaticLayer: the static widgets are rendered once into
+ * the base map and only the value labels stay in LVGL, overlaid on that layer.
+ *
+ * Neither the widget nor --prerender may change a pixel: unless run with --tree alone, the tool
+ * first replays the sequence with the object tree and no static layer as a reference, and every
+ * frame must equal that run's frame (exit status 1 otherwise).
+ *
+ * Strips are converted inside the flush callback (kPipelinedFlush = false): the host has no
+ * service task, so the producer runs the queue itself.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+#include "assets.h"
+#include "dashboard.h"
+#include "dirty_tracker.h"
+#include "display_service.h"
+#include "host_panel.h"
+#include "lvgl.h"
+#include "strip_pack.h"
+
+namespace {
+
+using epd::host::Ssd1677Emulator;
+using Clock = std::chrono::steady_clock;
+
+constexpr int32_t kDisplayWidth = epd::kHeight;
+constexpr int32_t kDisplayHeight = epd::kWidth;
+constexpr size_t kLvglBufferLines = 32;
+constexpr size_t kLvglBufferSize =
+    LV_DRAW_BUF_SIZE(kDisplayWidth, kLvglBufferLines, LV_COLOR_FORMAT_I1);
+constexpr size_t kI1PaletteBytes = LV_COLOR_INDEXED_PALETTE_SIZE(LV_COLOR_FORMAT_I1) * 4;
+
+/**
+ * @brief Readings replayed after the first frame, in SensorIndex order.
+ *
+ * Step 1 repeats step 0 and step 2 stays mostly inside the hysteresis bands, so the model's
+ * change detection shows up as frames with few or no flushes.
+ */
+constexpr app::SensorReadings kSequence[] = {
+    {741, 0, 105, 3, 26, 55},
+    {741, 0, 105, 3, 26, 55},
+    {745, 1, 107, 3, 26, 56},
+    {812, 1, 140, 4, 27, 60},
+    {400, 10, 199, 1, 20, 40},
+    {400, 10, 199, 1, 30, 70},
+};
+
+alignas(LV_DRAW_BUF_ALIGN) uint8_t g_buf1[kLvglBufferSize];
+alignas(LV_DRAW_BUF_ALIGN) uint8_t g_buf2[kLvglBufferSize];
+
+struct HostDisplay {
+    epd::DisplayService *service = nullptr;
+    epd::DirtyTracker dirty{kDisplayWidth, kDisplayHeight, epd::kWindowOverheadBytes};
+    uint32_t flushes = 0;
+    uint64_t pixels = 0;
+    uint32_t errors = 0;
+    const uint8_t *static_layer = nullptr;
+    uint8_t *capture_frame = nullptr;
+    bool rendering = false;
+    Clock::duration flush_time{};
+};
+
+HostDisplay g_display;
+
+uint32_t tickMs() {
+    return static_cast<uint32_t>(epd::host::nowUs() / 1000);
+}
+
+/** @brief The synchronous branch of main.cpp's lvglFlushCallback(), without the logging. */
+void flushCallback(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map) {
+    const Clock::time_point started = Clock::now();
+    HostDisplay &ctx = g_display;
+    epd::Strip strip;
+    strip.x = area->x1;
+    strip.y = area->y1;
+    strip.width = area->x2 - area->x1 + 1;
+    strip.height = area->y2 - area->y1 + 1;
+    strip.stride = lv_draw_buf_width_to_stride(static_cast<uint32_t>(strip.width),
+                                               LV_COLOR_FORMAT_I1);
+    strip.pixels = px_map + kI1PaletteBytes;
+    if (ctx.capture_frame != nullptr) {
+        static uint8_t scratch[kDisplayWidth * kLvglBufferLines / 8];
+        epd::Region region;
+        size_t black_pixels = 0;
+        if (app::packStrip(strip, LV_COLOR_FORMAT_I1, epd::Dither::kThreshold, scratch,
+                           sizeof(scratch), region, black_pixels, nullptr) == ESP_OK) {
+            app::blitRegion(region, ctx.capture_frame);
+        }
+        ctx.flush_time += Clock::now() - started;
+        lv_display_flush_ready(disp);
+        return;
+    }
+    ++ctx.flushes;
+    ctx.pixels += static_cast<uint64_t>(strip.width) * static_cast<uint64_t>(strip.height);
+
+    esp_err_t result = ESP_ERR_NO_MEM;
+    if (uint8_t *buffer = ctx.service->acquireBuffer()) {
+        epd::Region region;
+        size_t black_pixels = 0;
+        result = app::packStrip(strip, LV_COLOR_FORMAT_I1, epd::Dither::kThreshold, buffer,
+                                ctx.service->bufferBytes(), region, black_pixels, nullptr);
+        if (result == ESP_OK && ctx.static_layer != nullptr) {
+            app::overlayStaticLayer(region, buffer, ctx.static_layer);
+        }
+        if (result == ESP_OK) {
+            result = ctx.service->submitRegion(region);
+        }
+    }
+    if (result == ESP_OK && lv_display_flush_is_last(disp)) {
+        result = ctx.service->submitCommit(epd::RefreshMode::kPartial);
+    }
+    if (result != ESP_OK) {
+        ++ctx.errors;
+        ctx.service->submitAbort();
+    }
+    ctx.flush_time += Clock::now() - started;
+    lv_display_flush_ready(disp);
+}
+
+/** @brief main.cpp's invalidateAreaCallback(): widen LVGL's area to the merged dirty area. */
+void invalidateAreaCallback(lv_event_t *event) {
+    if (g_display.rendering) {
+        return;  // LVGL asking how many rows fit in a buffer (get_max_row), not a dirty area
+    }
+    auto *area = static_cast<lv_area_t *>(lv_event_get_param(event));
+    const epd::DirtyArea tracked = g_display.dirty.add({area->x1, area->y1, area->x2, area->y2});
+    if (tracked.x2 >= tracked.x1) {
+        area->x1 = tracked.x1;
+        area->y1 = tracked.y1;
+        area->x2 = tracked.x2;
+        area->y2 = tracked.y2;
+    }
+}
+
+void renderEventCallback(lv_event_t *event) {
+    g_display.rendering = lv_event_get_code(event) == LV_EVENT_RENDER_START;
+    if (g_display.rendering) {  // also during the static-layer capture
+        g_display.dirty.clear();
+    }
+}
+
+/** @brief main.cpp's bakeStaticLayer(), with the layer kept in @p frame. */
+esp_err_t bakeStaticLayer(epd::Driver &driver, lv_display_t *display, app::Dashboard &ui,
+                          std::vector<uint8_t> &frame) {
+    frame.assign(epd::kBufferSize, 0xFF);
+    app::setLiveLabelsHidden(ui, true);
+    g_display.capture_frame = frame.data();
+    lv_obj_invalidate(lv_display_get_screen_active(display));
+    lv_refr_now(display);
+    g_display.capture_frame = nullptr;
+    app::dropStaticWidgets(display, ui);
+    app::setLiveLabelsHidden(ui, false);
+    g_display.static_layer = frame.data();
+    return driver.loadBaseMap(frame.data(), true);
+}
+
+/**
+ * @brief Bytes of the visible panel image that differ from a full redraw of the current UI.
+ *
+ * The whole screen is rendered into a scratch frame (ANDed with the static layer, as on the
+ * panel) and compared with what the partial updates left on the panel, so a window packed to the
+ * wrong place (an updated value outside its own cell, or a stale one left behind) shows up here.
+ */
+size_t mismatchWithFullRedraw(lv_display_t *display, const Ssd1677Emulator &panel) {
+    std::vector<uint8_t> frame(epd::kBufferSize, 0xFF);
+    g_display.capture_frame = frame.data();
+    lv_obj_invalidate(lv_display_get_screen_active(display));
+    lv_refr_now(display);
+    g_display.capture_frame = nullptr;
+
+    const uint8_t *visible = panel.plane(Ssd1677Emulator::Plane::kVisible);
+    size_t differing = 0;
+    for (size_t i = 0; i < frame.size(); ++i) {
+        const uint8_t expected =
+            g_display.static_layer != nullptr ? frame[i] & g_display.static_layer[i] : frame[i];
+        differing += expected != visible[i] ? 1 : 0;
+    }
+    return differing;
+}
+
+/** @brief Mean host CPU time of lv_refr_now() for @p runs redraws, without the flush callback. */
+template <typename Invalidate>
+double meanRenderUs(lv_display_t *display, size_t runs, Invalidate invalidate) {
+    std::vector<uint8_t> frame(epd::kBufferSize, 0xFF);
+    g_display.capture_frame = frame.data();
+    Clock::duration total{};
+    for (size_t run = 0; run < runs; ++run) {
+        invalidate(run);
+        g_display.flush_time = {};
+        const Clock::time_point started = Clock::now();
+        lv_refr_now(display);
+        total += Clock::now() - started - g_display.flush_time;
+    }
+    g_display.capture_frame = nullptr;
+    return std::chrono::duration<double, std::micro>(total).count() / static_cast<double>(runs);
+}
+
+std::vector<char> readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Replay kSequence on a fresh panel, LVGL instance and dashboard; false on any failure.
+ *
+ * Prints the statistics table, appends each frame's visible image to @p frames and, unless
+ * @p out_dir is empty, writes the PBMs and compares them with @p golden_dir.
+ */
+bool replay(app::TableImpl table, bool prerender, const std::string &out_dir,
+            const std::string &golden_dir, std::vector<std::vector<uint8_t>> &frames) {
+    g_display = HostDisplay{};
+
+    // Same panel setup as app_main(), minus the temperature read over 3-wire SPI.
+    Ssd1677Emulator panel;
+    epd::Config cfg = epd::host::firmwareConfig(panel);
+    cfg.async_upload = true;
+    cfg.shadow_framebuffer = true;
+    cfg.ghost_budget = 20;
+    cfg.ghost_hard_budget = 60;
+    epd::Driver driver;
+    ESP_ERROR_CHECK(driver.init(cfg));
+    ESP_ERROR_CHECK(driver.hardwareInit(false));
+    ESP_ERROR_CHECK(driver.clear(0xFF));
+    if (!prerender) {
+        ESP_ERROR_CHECK(driver.loadBaseMap(WhileBG, true));
+    }
+
+    epd::DisplayService service(driver);
+    epd::ServiceConfig service_cfg;
+    service_cfg.buffer_bytes = kDisplayWidth * kLvglBufferLines / 8;
+    ESP_ERROR_CHECK(service.init(service_cfg));
+    g_display.service = &service;
+
+    lv_init();
+    lv_tick_set_cb(tickMs);
+    lv_display_t *display = lv_display_create(kDisplayWidth, kDisplayHeight);
+    lv_display_set_color_format(display, LV_COLOR_FORMAT_I1);
+    lv_display_set_buffers(display, g_buf1, g_buf2, kLvglBufferSize,
+                           LV_DISPLAY_RENDER_MODE_PARTIAL);
+    lv_display_set_flush_cb(display, flushCallback);
+    lv_display_add_event_cb(display, renderEventCallback, LV_EVENT_RENDER_START, nullptr);
+    lv_display_add_event_cb(display, renderEventCallback, LV_EVENT_RENDER_READY, nullptr);
+    lv_display_add_event_cb(display, invalidateAreaCallback, LV_EVENT_INVALIDATE_AREA, nullptr);
+
+    app::Dashboard ui;
+    lv_obj_t *screen = lv_display_get_screen_active(display);
+    const app::UiFootprint before = app::measureUi(screen);
+    app::createDashboard(screen, ui, table);
+    const app::UiFootprint after = app::measureUi(screen);
+    std::printf("ui (%s): %u objects, %zu bytes of LVGL heap\n",
+                table == app::TableImpl::kSensorTable ? "sensor table widget" : "object tree",
+                static_cast<unsigned>(after.objects - before.objects),
+                after.heap_used - before.heap_used);
+    std::vector<uint8_t> static_layer;
+    if (prerender) {
+        ESP_ERROR_CHECK(bakeStaticLayer(driver, display, ui, static_layer));
+    }
+
+    std::printf("%-5s %7s %10s %10s %8s %10s %10s %9s %10s\n", "frame", "changed", "suppressed",
+                "render us", "flushes", "pixels", "0x24 bytes", "windows", "refresh ms");
+    bool ok = true;
+    for (size_t step = 0; step < std::size(kSequence); ++step) {
+        const epd::TransferStats before = driver.transferStats();
+        const int64_t started_us = epd::host::nowUs();
+        g_display.flushes = 0;
+        g_display.pixels = 0;
+        g_display.flush_time = {};
+
+        const uint32_t changed = app::publishReadings(ui, kSequence[step]);
+        const Clock::time_point render_started = Clock::now();
+        lv_refr_now(display);
+        const Clock::duration render_time =
+            Clock::now() - render_started - g_display.flush_time;
+        service.drain();
+
+        const epd::TransferStats &after = driver.transferStats();
+        std::printf("%5zu %7u %10u %10.1f %8u %10llu %10llu %9u %10.1f\n", step,
+                    static_cast<unsigned>(changed),
+                    static_cast<unsigned>(app::suppressedUpdates(ui)),
+                    std::chrono::duration<double, std::micro>(render_time).count(),
+                    static_cast<unsigned>(g_display.flushes),
+                    static_cast<unsigned long long>(g_display.pixels),
+                    static_cast<unsigned long long>(after.partial_window_bytes -
+                                                    before.partial_window_bytes),
+                    static_cast<unsigned>(after.partial_windows - before.partial_windows),
+                    (epd::host::nowUs() - started_us) / 1000.0);
+
+        if (const size_t differing = mismatchWithFullRedraw(display, panel)) {
+            std::printf("frame %zu: %zu bytes differ from a full redraw\n", step, differing);
+            ok = false;
+        }
+
+        const uint8_t *visible = panel.plane(Ssd1677Emulator::Plane::kVisible);
+        frames.emplace_back(visible, visible + Ssd1677Emulator::kPlaneBytes);
+        if (out_dir.empty()) {
+            continue;
+        }
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%02zu.pbm", step);
+        const std::string path = out_dir + "/" + name;
+        if (!panel.writePbm(path.c_str())) {
+            std::fprintf(stderr, "cannot write %s\n", path.c_str());
+            ok = false;
+            continue;
+        }
+        if (!golden_dir.empty()) {
+            const std::vector<char> golden = readFile(golden_dir + "/" + name);
+            if (golden.empty() || golden != readFile(path)) {
+                std::printf("%s differs from %s/%s\n", path.c_str(), golden_dir.c_str(), name);
+                ok = false;
+            }
+        }
+    }
+
+    constexpr size_t kRedrawRuns = 200;
+    const double full_us = meanRenderUs(display, kRedrawRuns, [screen](size_t) {
+        lv_obj_invalidate(screen);
+    });
+    app::SensorReadings readings = kSequence[std::size(kSequence) - 1];
+    const double value_us = meanRenderUs(display, kRedrawRuns, [&](size_t run) {
+        readings[app::kCo2] = run % 2 == 0 ? 900 : 400;  // beyond CO2's hysteresis every time
+        app::publishReadings(ui, readings);
+    });
+    std::printf("redraw (host us, mean of %zu): full screen %.1f, one value %.1f\n", kRedrawRuns,
+                full_us, value_us);
+
+    const epd::ServiceStats stats = service.stats();
+    std::printf("service: %u/%u commands, %u errors, %u flush errors; "
+                "stale bytes (visible != 0x24): %zu\n",
+                static_cast<unsigned>(stats.executed), static_cast<unsigned>(stats.submitted),
+                static_cast<unsigned>(stats.errors), static_cast<unsigned>(g_display.errors),
+                panel.diffBytes(Ssd1677Emulator::Plane::kVisible, Ssd1677Emulator::Plane::kNew));
+    ok = ok && stats.errors == 0 && g_display.errors == 0;
+
+    lv_display_delete(display);
+    lv_deinit();
+    service.deinit();
+    driver.deinit();
+    return ok;
+}
+
+/** @brief Print the command line to stderr; returns the exit status for a bad one. */
+int usage() {
+    std::fprintf(stderr,
+                 "usage: dashboard_host [--tree] [--prerender] [--compare golden_dir] "
+                 "[output_dir]\n");
+    return 2;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::string out_dir = ".";
+    std::string golden_dir;
+    bool prerender = false;
+    bool have_out_dir = false;
+    app::TableImpl table = app::TableImpl::kSensorTable;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--tree") == 0) {
+            table = app::TableImpl::kObjectTree;
+        } else if (std::strcmp(argv[i], "--prerender") == 0) {
+            prerender = true;
+        } else if (std::strcmp(argv[i], "--compare") == 0) {
+            if (i + 1 >= argc) {
+                return usage();
+            }
+            golden_dir = argv[++i];
+        } else if (argv[i][0] == '-' || have_out_dir) {
+            return usage();
+        } else {
+            out_dir = argv[i];
+            have_out_dir = true;
+        }
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    // Every other mode must reproduce the plain object-tree run exactly.
+    std::vector<std::vector<uint8_t>> reference;
+    if (table != app::TableImpl::kObjectTree || prerender) {
+        std::printf("reference run with --tree, without --prerender:\n");
+        if (!replay(app::TableImpl::kObjectTree, false, "", "", reference)) {
+            return 1;
+        }
+        std::printf("\n");
+    }
+    std::vector<std::vector<uint8_t>> frames;
+    bool ok = replay(table, prerender, out_dir, golden_dir, frames);
+    for (size_t step = 0; step < reference.size(); ++step) {
+        if (step >= frames.size() || frames[step] != reference[step]) {
+            std::printf("frame %zu: differs from the plain --tree run\n", step);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
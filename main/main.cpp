@@ -1,50 +1,132 @@
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
-#include <vector>
 #include <random>
 
+#include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_err.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_sleep.h"
 #include "esp_timer.h"
+#include "sdkconfig.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 #include "assets.h"
+#include "dashboard.h"
+#include "dirty_tracker.h"
+#include "display_service.h"
+#include "epd_bench.h"
 #include "epd_driver.h"
+#include "ft6336.h"
 #include "lvgl.h"
+#include "pixel_convert.h"
+#include "strip_pack.h"
 
 namespace {
 
 constexpr const char *TAG = "app";
 constexpr size_t kLvglBufferLines = 32;
-constexpr lv_color_format_t kLvglColorFormat = LV_COLOR_FORMAT_RGB565;
+// โหมดเทา 4 ระดับ: LVGL วาดเป็น L8 แล้วทุกเฟรมเป็น full refresh ด้วย LUT 4-gray (ไม่มี partial)
+constexpr bool kGrayscaleMode = false;
+// ให้ LVGL วาดเป็น I1 (1 บิต) ตรง ๆ: draw buffer เล็กลง 16 เท่า และ flush แค่กลับลำดับบิต
+// (false = วาด RGB565 แล้วแปลงเป็น 1 บิตด้วยค่าความสว่างทีละพิกเซล)
+constexpr bool kRenderI1 = true;
+constexpr lv_color_format_t kLvglColorFormat = kGrayscaleMode ? LV_COLOR_FORMAT_L8
+                                               : kRenderI1    ? LV_COLOR_FORMAT_I1
+                                                              : LV_COLOR_FORMAT_RGB565;
+// วิธีจำลองระดับเทาตอนแปลง RGB565 เป็น 1 บิต (ใช้เมื่อ kRenderI1 = false เท่านั้น เพราะ I1 ถูกตัด
+// ขาวดำตั้งแต่ตอน LVGL วาด): kBayer4/kBayer8 สำหรับรูปและขอบตัวอักษรที่ anti-alias, kFloydSteinberg
+// สำหรับรูปถ่าย (ส่ง error ต่อข้าม strip), kThreshold = ตัดที่ 50% แบบเดิม
+constexpr epd::Dither kDither = epd::Dither::kThreshold;
 constexpr uint32_t kDisplayWidth = epd::kHeight;
 constexpr uint32_t kDisplayHeight = epd::kWidth;
 constexpr size_t kLvglBufferSize =
     LV_DRAW_BUF_SIZE(kDisplayWidth, kLvglBufferLines, kLvglColorFormat);
+// ไบต์ palette (2 สี x 4 ไบต์) ที่ LVGL วางไว้หน้าพิกเซลของ buffer แบบ I1
+constexpr size_t kI1PaletteBytes = LV_COLOR_INDEXED_PALETTE_SIZE(LV_COLOR_FORMAT_I1) * 4;
 constexpr TickType_t kUpdateInterval = pdMS_TO_TICKS(5000);  // อัพเดททุก 5 วินาที
+// refresh ไม่ถี่กว่านี้: หลังแต่ละเฟรม LVGL หยุด render จนครบช่วง
+// ค่าที่เปลี่ยนระหว่างนั้นรวมเป็นเฟรมเดียว (0 = ไม่จำกัด)
+constexpr TickType_t kMinRefreshInterval = pdMS_TO_TICKS(1000);
+// รอให้จอว่างอย่างน้อยเท่านี้หลังอัพเดทค่า ก่อนทำ cleaning refresh (ไม่ชนกับรอบอัพเดทถัดไป)
+constexpr TickType_t kCleaningIdleDelay = pdMS_TO_TICKS(2000);
+// อ่านอุณหภูมิจอทุก 1 นาทีเพื่อเลือก waveform (LUT) ให้ตรงช่วงอุณหภูมิ
+constexpr TickType_t kTemperatureInterval = pdMS_TO_TICKS(60000);
+constexpr bool kRunUploadBenchmark = false;  // วัดเวลา upload แบบ polled/queued ตอนบูต
+// แปลง strip เป็น 1 บิตบน task ของจอ ซ้อนกับ DMA ของ strip ก่อนหน้า (false = แปลงใน flush callback)
+constexpr bool kPipelinedFlush = true;
+// วาด widget คงที่ (เส้นตาราง, หัวตาราง, หน่วย, ขอบ) ครั้งเดียวตอนบูตลง base map ของจอ แล้วให้
+// LVGL วาดแค่ label ค่าบนพื้นโปร่งใส (ต้องเป็นภาพ 1 บิต จึงปิดในโหมดเทา)
+constexpr bool kPrerenderStaticLayer = !kGrayscaleMode;
+// ตารางค่าเป็น widget เดียวที่วาดขอบ/เส้นแบ่ง/ข้อความเองใน draw pass เดียว (kObjectTree = grid +
+// label/เส้นแยก object แบบเดิม ไว้เทียบ log `UI footprint`)
+constexpr app::TableImpl kTableImpl = app::TableImpl::kSensorTable;
+// tick ของ LVGL แบบเดิม: esp_timer ทุก 1 ms เรียก lv_tick_inc(1) (ไว้เทียบ log `Idle load`)
+// false = LVGL อ่านเวลาจาก esp_timer_get_time() เองผ่าน lv_tick_set_cb() ไม่มี wakeup เพิ่ม
+constexpr bool kPeriodicLvglTick = false;
+// ช่วงที่ใช้สรุป wakeup ต่อนาทีและภาระ CPU ตอนว่าง
+constexpr int64_t kIdleStatsIntervalUs = 60 * 1000 * 1000;
+// เหตุที่ปลุก main loop ก่อนถึงกำหนด (บิตของ task notification)
+constexpr uint32_t kWakeRefreshDone = 1U << 0;  // จอ refresh เสร็จ (ISR ของขา BUSY)
+constexpr uint32_t kWakeInput = 1U << 1;        // แตะจอ (ISR ของขา INT ของ FT6336)
+constexpr uint32_t kWakeSensor = 1U << 2;       // ค่าเซ็นเซอร์ชุดใหม่พร้อม (timer ของเซ็นเซอร์)
+// ขาของ touch FT6336 บน I2C ต้องตรงกับสายบนบอร์ด ถ้าไม่มีแผง touch ตอบ ระบบทำงานต่อโดยไม่มี touch
+constexpr gpio_num_t kTouchSda = GPIO_NUM_6;
+constexpr gpio_num_t kTouchScl = GPIO_NUM_7;
+constexpr gpio_num_t kTouchRst = GPIO_NUM_18;
+constexpr gpio_num_t kTouchInt = GPIO_NUM_19;
+// buffer ของ display service ต้องจุ strip ที่แปลงแล้วหนึ่งก้อน (1 บิต หรือ 2 บิตในโหมดเทา)
+constexpr size_t kServiceBufferBytes = kDisplayWidth * kLvglBufferLines / (kGrayscaleMode ? 4 : 8);
 
 struct LvglDisplayContext {
-  epd::Driver *epd{nullptr};
-  lv_obj_t *status_bar{nullptr};  // เพิ่ม status_bar reference
-  lv_obj_t *status_temp_label{nullptr};
-  lv_obj_t *status_humidity_label{nullptr};
-  lv_obj_t *table_container{nullptr};
-  lv_obj_t *table_headings[3]{};
-  lv_obj_t *table_values[3]{};
-  lv_obj_t *table_units[3]{};
-  lv_obj_t *nox_value_label{nullptr};  // เพิ่ม label สำหรับ NOx
-  std::vector<uint8_t> scratch{};
-  int32_t flush_count{0};
-  int32_t expected_flushes{0};
-  TickType_t last_flush_time{0};  // เวลาของ flush ล่าสุด
+  epd::DisplayService *service{nullptr};  // task ของจอเป็นเจ้าของ driver; UI แค่ส่งคำสั่งเข้าคิว
+  app::Dashboard ui;  // widget ของหน้า dashboard และ data model ของค่าเซ็นเซอร์
+  lv_color_format_t color_format{kLvglColorFormat};
+  std::atomic<int64_t> convert_us{0};  // เวลาที่ใช้แปลง strip ของเฟรมปัจจุบัน (รวมทุก strip)
+  epd::ErrorDiffusion diffusion;  // error ของ Floyd-Steinberg ที่ส่งต่อจาก strip ก่อนหน้า
+  // พื้นที่ที่ถูก invalidate ของเฟรมถัดไป รวมตามต้นทุน window (ล้างทุก LV_EVENT_RENDER_START)
+  epd::DirtyTracker dirty{kDisplayWidth, kDisplayHeight, epd::kWindowOverheadBytes};
+  uint64_t rendered_pixels{0};  // พิกเซลที่ LVGL ส่งเข้า flush callback ของเฟรมปัจจุบัน
+  const uint8_t *static_layer{nullptr};  // ภาพ widget คงที่ใน base map (ทับลงทุก strip)
+  uint8_t *capture_frame{nullptr};  // ระหว่าง bakeStaticLayer(): flush เขียน strip ลงภาพนี้แทน
+  uint8_t *capture_scratch{nullptr};  // buffer ของ packStrip() ระหว่าง capture
+  bool rendering{false};  // ระหว่าง RENDER_START..RENDER_READY (INVALIDATE_AREA = ถามการปัดแถว)
 };
 
 // Global variables - ต้องประกาศก่อนใช้งาน
-esp_timer_handle_t g_lvgl_tick_timer = nullptr;
+esp_timer_handle_t g_lvgl_tick_timer = nullptr;  // ใช้เฉพาะ kPeriodicLvglTick
+std::atomic<uint32_t> g_tick_timer_wakeups{0};   // จำนวนครั้งที่ tick timer ปลุก esp_timer task
+TaskHandle_t g_main_task = nullptr;  // task ของ main loop ที่รอ notification ระหว่างกำหนดการ
+esp_timer_handle_t g_sensor_timer = nullptr;  // บอกว่าค่าเซ็นเซอร์ชุดใหม่พร้อมทุก kUpdateInterval
+ft6336::Driver g_touch;
+bool g_touch_ready = false;  // FT6336 ตอบและติดตั้ง ISR ของขา INT แล้ว
 lv_display_t *g_lvgl_display = nullptr;
 LvglDisplayContext g_lvgl_ctx{};
+std::atomic<bool> g_refresh_done{false};  // ตั้งจาก ISR ของขา BUSY เมื่อจอ refresh เสร็จ
+std::atomic<int64_t> g_refresh_done_us{0};  // เวลาที่ refresh เสร็จ (ตั้งจาก ISR เดียวกัน)
+SemaphoreHandle_t g_flush_done = nullptr;  // task ของจอ give เมื่อแปลง strip เสร็จ (โหมด pipeline)
+int64_t g_frame_started_us = 0;  // เวลาเริ่ม render เฟรมที่ยังรอ refresh อยู่ (0 = ไม่มี)
+int64_t g_render_us = 0;         // เวลาที่ LVGL ใช้ render + flush เฟรมล่าสุด
+int64_t g_input_changed_us = 0;  // lv_label_set_text ครั้งแรกที่ยังไม่ถูก render (0 = ไม่มี)
+int64_t g_frame_input_us = 0;    // เวลาเปลี่ยนค่าที่เฟรมซึ่งรอ refresh อยู่นำขึ้นจอ
+bool g_refresh_gated = false;    // refresh timer ของ LVGL ถูกหยุดรอ kMinRefreshInterval
+TickType_t g_refresh_gate_start = 0;
+uint32_t g_frame_heap_start = 0;    // ตัวนับการจอง heap ตอนเริ่มเฟรม
+uint32_t g_frame_bounce_start = 0;  // dma_bounce_transfers ของ service ตอนเริ่มเฟรม
+uint64_t g_frame_upload_start = 0;  // partial_window_bytes ของ service ตอนเริ่มเฟรม
+uint64_t g_frame_invalidated_pixels = 0;  // พิกเซลที่ widget invalidate ก่อนรวมพื้นที่
+uint32_t g_frame_dirty_areas = 0;         // จำนวนพื้นที่หลังรวมด้วย DirtyTracker
+#if CONFIG_HEAP_USE_HOOKS
+std::atomic<uint32_t> g_heap_allocations{0};  // นับทุกการจอง heap ผ่าน hook ด้านล่าง
+#endif
 
 alignas(LV_DRAW_BUF_ALIGN) uint8_t g_lvgl_buf1[kLvglBufferSize];
 alignas(LV_DRAW_BUF_ALIGN) uint8_t g_lvgl_buf2[kLvglBufferSize];
@@ -71,49 +153,240 @@ void updateSensorValues() {
   ESP_LOGI(TAG, "Updating values: CO2=%d, PM2.5=%d, VOC=%d, NOx=%d, Temp=%d, Humi=%d",
            co2, pm25, voc, nox, temp, humi);
 
-  // อัพเดท status bar
-  char temp_str[16];
-  snprintf(temp_str, sizeof(temp_str), "%dC", temp);
-  lv_label_set_text(g_lvgl_ctx.status_temp_label, temp_str);  // temp ไปที่ temp_label (ซ้าย)
+  // ส่งเข้า model: observer ตั้งข้อความเฉพาะ label ที่ค่าเปลี่ยนเกิน hysteresis ซึ่ง invalidate
+  // กล่องของตัวเอง (ไม่ต้อง invalidate status bar/ตารางทั้งก้อน ไดรเวอร์อัปเดต 0x26 เอง)
+  const uint32_t changed =
+      app::publishReadings(g_lvgl_ctx.ui, {co2, pm25, voc, nox, temp, humi});
+  if (changed != 0 && g_input_changed_us == 0) {
+    g_input_changed_us = esp_timer_get_time();  // เริ่มนับ latency จนจอเริ่ม refresh
+  }
+  ESP_LOGI(TAG, "Sensor model: %u/%u labels changed, %u updates suppressed so far",
+           static_cast<unsigned>(changed), static_cast<unsigned>(app::kSensorCount),
+           static_cast<unsigned>(app::suppressedUpdates(g_lvgl_ctx.ui)));
+}
 
-  char humi_str[16];
-  snprintf(humi_str, sizeof(humi_str), "%d%%", humi);
-  lv_label_set_text(g_lvgl_ctx.status_humidity_label, humi_str);  // humi ไปที่ humidity_label (ขวา)
+/** @brief tick ของ LVGL เป็น ms จากนาฬิกา esp_timer (LVGL เรียกเองเมื่อต้องการเวลา) */
+uint32_t lvglTickMs() { return static_cast<uint32_t>(esp_timer_get_time() / 1000); }
 
-  // อัพเดทตาราง
-  char co2_str[16];
-  snprintf(co2_str, sizeof(co2_str), "%d", co2);
-  lv_label_set_text(g_lvgl_ctx.table_values[0], co2_str);
+void lvglTickTimerCallback(void *) {
+  lv_tick_inc(1);
+  g_tick_timer_wakeups.fetch_add(1, std::memory_order_relaxed);
+}
 
-  char pm25_str[16];
-  snprintf(pm25_str, sizeof(pm25_str), "%d", pm25);
-  lv_label_set_text(g_lvgl_ctx.table_values[1], pm25_str);
+/** @brief เวลาสะสมของ idle task (µs) หรือ -1 ถ้าไม่ได้เปิด run time stats ของ FreeRTOS */
+int64_t idleRunTimeUs() {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+  return static_cast<int64_t>(ulTaskGetIdleRunTimeCounter());
+#else
+  return -1;
+#endif
+}
 
-  char voc_str[16];
-  snprintf(voc_str, sizeof(voc_str), "%d", voc);
-  lv_label_set_text(g_lvgl_ctx.table_values[2], voc_str);
+/** @brief ปลุก main loop ด้วยเหตุ @p reason (kWake*) จาก ISR */
+void wakeMainLoopFromIsr(uint32_t reason) {
+  BaseType_t woken = pdFALSE;
+  if (g_main_task != nullptr) {
+    xTaskNotifyFromISR(g_main_task, reason, eSetBits, &woken);
+  }
+  if (woken == pdTRUE) {
+    portYIELD_FROM_ISR(woken);
+  }
+}
 
-  // อัพเดท NOx value
-  char nox_str[16];
-  snprintf(nox_str, sizeof(nox_str), "%d", nox);
-  lv_label_set_text(g_lvgl_ctx.nox_value_label, nox_str);
-  
-  // Force invalidate ทั้ง container และ status bar เพื่อให้วาดเส้นขอบใหม่
-  if (g_lvgl_ctx.status_bar != nullptr) {
-    lv_obj_invalidate(g_lvgl_ctx.status_bar);
+/** @brief ปลุก main loop ด้วยเหตุ @p reason (kWake*) จาก task อื่น */
+void wakeMainLoop(uint32_t reason) {
+  if (g_main_task != nullptr) {
+    xTaskNotify(g_main_task, reason, eSetBits);
   }
-  if (g_lvgl_ctx.table_container != nullptr) {
-    lv_obj_invalidate(g_lvgl_ctx.table_container);
+}
+
+/** @brief จำนวน tick ที่ต้องรอจาก @p now ถึง @p deadline (0 ถ้าเลยกำหนดแล้ว) */
+TickType_t ticksUntil(TickType_t now, TickType_t deadline) {
+  const TickType_t remaining = deadline - now;
+  // ผลต่างแบบ unsigned ที่ "ติดลบ" คือเลยกำหนดแล้ว
+  return remaining > portMAX_DELAY / 2 ? 0 : remaining;
+}
+
+void refreshDoneCallback(void *) {
+  g_refresh_done_us = esp_timer_get_time();
+  g_refresh_done = true;
+  wakeMainLoopFromIsr(kWakeRefreshDone);
+}
+
+/**
+ * @brief ISR ของขา INT ของ FT6336 (ขอบลง) ปลุก main loop ให้อ่านจุดสัมผัส
+ *
+ * gpio_wakeup_enable() เปลี่ยนชนิด interrupt ของขาเป็น low level จึงปิด interrupt ไว้จนกว่า loop
+ * อ่านจุดสัมผัสแล้ว ไม่งั้นจะเข้า ISR ซ้ำตลอดเวลาที่นิ้วยังแตะอยู่
+ */
+void touchIsr(void *) {
+  gpio_intr_disable(kTouchInt);
+  wakeMainLoopFromIsr(kWakeInput);
+}
+
+/** @brief timer ของเซ็นเซอร์ (task ของ esp_timer): มีค่าชุดใหม่ให้ main loop ส่งเข้า model */
+void sensorTimerCallback(void *) { wakeMainLoop(kWakeSensor); }
+
+/**
+ * @brief ตัวนับการจอง heap: นับทุกครั้งผ่าน hook ถ้าเปิด CONFIG_HEAP_USE_HOOKS
+ *
+ * ถ้าไม่เปิดจะใช้จำนวน block ที่ยังจองค้างอยู่แทน ซึ่งไม่เห็นการจองที่คืนภายในเฟรมเดียวกัน
+ */
+uint32_t heapAllocationCount() {
+#if CONFIG_HEAP_USE_HOOKS
+  return g_heap_allocations.load(std::memory_order_relaxed);
+#else
+  multi_heap_info_t info{};
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  return static_cast<uint32_t>(info.allocated_blocks);
+#endif
+}
+
+/**
+ * @brief ขอบเฟรมของ LVGL: RENDER_START = เริ่มเฟรม, RENDER_READY = ส่ง strip สุดท้ายและ commit แล้ว
+ *
+ * flush สุดท้ายของเฟรมสั่ง refresh หนึ่งครั้งเสมอ หลัง RENDER_READY จึงหยุด refresh timer ของ LVGL
+ * ไว้ kMinRefreshInterval (main loop เป็นผู้เปิดคืน) เพื่อจำกัดความถี่ refresh
+ */
+void renderEventCallback(lv_event_t *event) {
+  const int64_t now = esp_timer_get_time();
+  if (g_lvgl_ctx.capture_frame != nullptr) {
+    // เฟรมของ bakeStaticLayer() ไม่ขึ้นจอผ่าน service จึงไม่นับสถิติและไม่หยุด refresh timer
+    g_lvgl_ctx.rendering = lv_event_get_code(event) == LV_EVENT_RENDER_START;
+    g_lvgl_ctx.dirty.clear();
+    return;
+  }
+  if (lv_event_get_code(event) == LV_EVENT_RENDER_START) {
+    if (g_frame_started_us == 0) {
+      g_frame_started_us = now;
+      g_frame_input_us = g_input_changed_us;
+      g_input_changed_us = 0;
+      g_frame_heap_start = heapAllocationCount();
+      const epd::ServiceStats stats = g_lvgl_ctx.service->stats();
+      g_frame_bounce_start = stats.dma_bounce_transfers;
+      g_frame_upload_start = stats.partial_window_bytes;
+      g_frame_invalidated_pixels = 0;
+      g_frame_dirty_areas = 0;
+      g_lvgl_ctx.rendered_pixels = 0;
+    }
+    // LVGL กำลังจะวาดพื้นที่ที่สะสมไว้: เก็บสถิติแล้วเริ่มนับของรอบถัดไป
+    g_frame_invalidated_pixels += g_lvgl_ctx.dirty.invalidatedPixels();
+    g_frame_dirty_areas += static_cast<uint32_t>(g_lvgl_ctx.dirty.count());
+    g_lvgl_ctx.dirty.clear();
+    g_lvgl_ctx.rendering = true;
+    return;
+  }
+  g_lvgl_ctx.rendering = false;
+  if (g_frame_started_us != 0) {
+    g_render_us = now - g_frame_started_us;
+  }
+  if (kMinRefreshInterval > 0) {
+    lv_timer_pause(lv_display_get_refr_timer(g_lvgl_display));
+    g_refresh_gated = true;
+    g_refresh_gate_start = xTaskGetTickCount();
   }
 }
 
-void lvglTickCallback(void *) { lv_tick_inc(1); }
+/**
+ * @brief LV_EVENT_INVALIDATE_AREA: ขยายพื้นที่ที่ LVGL จะวาดใหม่ให้เท่ากับที่ DirtyTracker รวมไว้
+ *
+ * กล่องที่อยู่ใกล้กันถูกรวมเมื่อส่งเป็น window เดียวถูกกว่าค่า kWindowOverheadBytes ของการตั้ง
+ * window ใหม่ LVGL จะรวมพื้นที่เดิมที่ถูกครอบไว้เองตอน render จึงวาดและส่งเฉพาะกล่องของ label
+ * ที่เปลี่ยน ระหว่าง render LVGL ส่ง event นี้เพื่อถามจำนวนแถวต่อ buffer (get_max_row) จึงไม่แตะ
+ */
+void invalidateAreaCallback(lv_event_t *event) {
+  if (g_lvgl_ctx.rendering) {
+    return;
+  }
+  auto *area = static_cast<lv_area_t *>(lv_event_get_param(event));
+  const epd::DirtyArea tracked =
+      g_lvgl_ctx.dirty.add({area->x1, area->y1, area->x2, area->y2});
+  if (tracked.x2 >= tracked.x1) {
+    area->x1 = tracked.x1;
+    area->y1 = tracked.y1;
+    area->x2 = tracked.x2;
+    area->y2 = tracked.y2;
+  }
+}
 
-void lvglFlushCallback(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map) {
-  (void)px_map;
+/** @brief StripConverter ของ display service: แปลง strip บน task ของจอ */
+esp_err_t convertStripCallback(void *user_ctx, const epd::Strip &strip, uint8_t *buffer,
+                               size_t buffer_bytes, epd::Region &region) {
+  auto *ctx = static_cast<LvglDisplayContext *>(user_ctx);
+  size_t black_pixels = 0;  // ไม่ใช้: โหมด I1 ไม่นับ และ log ต่อ strip บน task ของจอแพงกว่าการแปลง
+  const int64_t started = esp_timer_get_time();
+  const esp_err_t result = app::packStrip(strip, ctx->color_format, kDither, buffer,
+                                          buffer_bytes, region, black_pixels, &ctx->diffusion);
+  if (result == ESP_OK && ctx->static_layer != nullptr) {
+    app::overlayStaticLayer(region, buffer, ctx->static_layer);
+  }
+  ctx->convert_us += esp_timer_get_time() - started;
+  return result;
+}
+
+/** @brief strip ถูกแปลงแล้ว LVGL ใช้ draw buffer นั้นต่อได้ */
+void stripDoneCallback(void *) { xSemaphoreGive(g_flush_done); }
+
+/** @brief LVGL เรียกแทนการวนรอ flushing; บล็อกจน task ของจอแปลง strip ก่อนหน้าเสร็จ */
+void flushWaitCallback(lv_display_t *) { xSemaphoreTake(g_flush_done, portMAX_DELAY); }
+
+/**
+ * @brief แปลงพื้นที่ L8 จาก LVGL เป็นเทา 2 บิต (0 = ดำ .. 3 = ขาว) แล้วส่งเข้าคิวให้แยกลง 0x24/0x26
+ *
+ * ใช้ buffer จาก pool ของ display service ซึ่งจะคืนเองหลัง writeGrayRegion() ทำงานเสร็จ
+ * flush สุดท้ายของเฟรมจะสั่ง refresh ด้วย LUT 4-gray ครั้งเดียว
+ */
+esp_err_t flushGrayArea(LvglDisplayContext *ctx, lv_display_t *disp, int32_t x_start,
+                        int32_t y_start, int32_t width, int32_t height, const uint8_t *px_map) {
+  const int32_t ram_x = app::ramX(x_start, width);  // กลับตำแหน่งเหมือน packStrip()
+  const int32_t aligned_x_start = ram_x - (ram_x % 8);
+  const int32_t leading_padding = ram_x - aligned_x_start;
+  const int32_t aligned_width = (width + leading_padding + 7) / 8 * 8;
+  const size_t row_bytes = static_cast<size_t>(aligned_width) / 4;
+  const size_t strip_bytes = row_bytes * static_cast<size_t>(height);
+  if (strip_bytes > ctx->service->bufferBytes()) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  uint8_t *strip = ctx->service->acquireBuffer();
+  if (strip == nullptr) {
+    return ESP_ERR_NO_MEM;
+  }
+  std::fill_n(strip, strip_bytes, 0xFF);  // padding เป็นสีขาว
+
+  const uint32_t row_stride = lv_draw_buf_width_to_stride(width, LV_COLOR_FORMAT_L8);
+  for (int32_t row = 0; row < height; ++row) {
+    const uint8_t *src = px_map + static_cast<size_t>(row) * row_stride;
+    uint8_t *dst = strip + static_cast<size_t>(row) * row_bytes;
+    for (int32_t col = 0; col < width; ++col) {
+      // กลับเนื้อหาในแถวเหมือนเส้นทาง 1 บิต
+      const size_t pixel = static_cast<size_t>(leading_padding + (width - 1 - col));
+      const uint8_t level = src[col] >> 6;
+      const unsigned shift = 6 - 2 * (pixel % 4);
+      dst[pixel / 4] = static_cast<uint8_t>((dst[pixel / 4] & ~(0x03 << shift)) |
+                                            (level << shift));
+    }
+  }
 
+  epd::Region region;
+  region.x = static_cast<uint16_t>(aligned_x_start);
+  region.y = static_cast<uint16_t>(y_start);
+  region.width = static_cast<uint16_t>(aligned_width);
+  region.height = static_cast<uint16_t>(height);
+  region.data = strip;
+  esp_err_t result = ctx->service->submitGrayRegion(region);
+  if (result != ESP_OK) {
+    ctx->service->releaseBuffer(strip);  // ไม่ได้เข้าคิว ต้องคืนเอง
+    return result;
+  }
+  if (lv_display_flush_is_last(disp)) {
+    result = ctx->service->submitGrayRefresh();
+  }
+  return result;
+}
+
+void lvglFlushCallback(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map) {
   auto *ctx = static_cast<LvglDisplayContext *>(lv_display_get_user_data(disp));
-  if (ctx == nullptr || ctx->epd == nullptr || area == nullptr) {
+  if (ctx == nullptr || ctx->service == nullptr || area == nullptr) {
     lv_display_flush_ready(disp);
     return;
   }
@@ -134,322 +407,297 @@ void lvglFlushCallback(lv_display_t *disp, const lv_area_t *area, uint8_t *px_ma
     return;
   }
 
-  // บันทึกเวลาของ flush
-  ctx->last_flush_time = xTaskGetTickCount();
+  if (kGrayscaleMode) {
+    const esp_err_t err = flushGrayArea(ctx, disp, x_start, y_start, width, height, px_map);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "gray flush failed: %s", esp_err_to_name(err));
+    }
+    lv_display_flush_ready(disp);
+    return;
+  }
 
-  ESP_LOGI(TAG, "LVGL flush (%d,%d) -> (%d,%d) size %dx%d", 
-           x_start, y_start, x_end, y_end, width, height);
+  // log ต่อ strip เป็นระดับ debug: เขียน UART นานกว่าแปลง strip และอยู่ในช่วงที่วัด render+flush
+  ESP_LOGD(TAG, "LVGL flush (%d,%d) -> (%d,%d) size %dx%d", x_start, y_start, x_end, y_end, width,
+           height);
+  ctx->rendered_pixels += static_cast<uint64_t>(width) * static_cast<uint64_t>(height);
+
+  epd::Strip strip;
+  strip.pixels = px_map;
+  strip.stride = lv_draw_buf_width_to_stride(width, ctx->color_format);
+  strip.x = x_start;
+  strip.y = y_start;
+  strip.width = width;
+  strip.height = height;
+  if (strip.pixels == nullptr) {
+    lv_draw_buf_t *draw_buf = lv_display_get_buf_active(disp);
+    if (draw_buf == nullptr) {
+      lv_display_flush_ready(disp);
+      return;
+    }
+    strip.pixels = draw_buf->data;
+    strip.stride = draw_buf->header.stride;
+  }
+  if (ctx->color_format == LV_COLOR_FORMAT_I1) {
+    strip.pixels += kI1PaletteBytes;  // ข้าม palette หน้าพิกเซล
+  }
 
-  const int32_t aligned_x_start = x_start - (x_start % 8);
-  const int32_t leading_padding = x_start - aligned_x_start;
-  int32_t aligned_width = width + leading_padding;
-  const int32_t trailing_padding = (8 - (aligned_width % 8)) % 8;
-  aligned_width += trailing_padding;
+  // bakeStaticLayer(): เก็บ strip ลงภาพเต็มจอ ไม่ส่งเข้าคิวของจอ
+  if (ctx->capture_frame != nullptr) {
+    epd::Region region;
+    size_t black_pixels = 0;
+    if (app::packStrip(strip, ctx->color_format, kDither, ctx->capture_scratch,
+                       kServiceBufferBytes, region, black_pixels, nullptr) == ESP_OK) {
+      app::blitRegion(region, ctx->capture_frame);
+    }
+    lv_display_flush_ready(disp);
+    return;
+  }
 
-  const size_t bit_count = static_cast<size_t>(aligned_width) * static_cast<size_t>(height);
-  ctx->scratch.assign((bit_count + 7) / 8, 0xFF);
+  // ขอ buffer จาก pool (รอได้ถ้าทุกก้อนยังอยู่ในคิว) service จะคืนให้เองหลัง commit
+  const size_t strip_bytes = app::stripBytes(x_start, width, height);
+  uint8_t *buffer = strip_bytes <= ctx->service->bufferBytes() ? ctx->service->acquireBuffer()
+                                                               : nullptr;
+  if (buffer == nullptr) {
+    ESP_LOGE(TAG, "no display buffer for %u bytes", static_cast<unsigned>(strip_bytes));
+    lv_display_flush_ready(disp);
+    return;
+  }
 
+  // pipeline: ส่ง strip ดิบเข้าคิว task ของจอแปลงระหว่างที่ DMA ของ strip ก่อนหน้ายังวิ่งอยู่
+  // ไม่ pipeline: แปลงที่นี่แล้วส่ง region; driver จะจัดลำดับ/รวม window ตอน commit
+  esp_err_t result = ESP_OK;
+  bool strip_queued = false;
+  bool buffer_queued = false;
   size_t black_pixels = 0;
-
-  const lv_color_format_t color_format = lv_display_get_color_format(disp);
-  const uint32_t pixel_size = lv_color_format_get_size(color_format);
-  const uint32_t row_stride =
-      lv_draw_buf_width_to_stride(width, color_format ? color_format : kLvglColorFormat);
-
-  for (int32_t row = 0; row < height; ++row) {
-    const uint8_t *row_ptr =
-        px_map ? px_map + static_cast<size_t>(row) * static_cast<size_t>(row_stride) : nullptr;
-    if (row_ptr == nullptr) {
-      lv_draw_buf_t *draw_buf = lv_display_get_buf_active(disp);
-      if (draw_buf == nullptr) {
-        lv_display_flush_ready(disp);
-        return;
-      }
-      row_ptr = draw_buf->data + static_cast<size_t>(row) * draw_buf->header.stride;
+  if (kPipelinedFlush) {
+    result = ctx->service->submitStrip(strip, buffer);
+    strip_queued = result == ESP_OK;
+    buffer_queued = strip_queued;
+  } else {
+    epd::Region region;
+    const int64_t started = esp_timer_get_time();
+    result = app::packStrip(strip, ctx->color_format, kDither, buffer,
+                            ctx->service->bufferBytes(), region, black_pixels, &ctx->diffusion);
+    if (result == ESP_OK && ctx->static_layer != nullptr) {
+      app::overlayStaticLayer(region, buffer, ctx->static_layer);
     }
-
-    for (int32_t col = 0; col < width; ++col) {
-      const uint8_t *pixel_ptr =
-          row_ptr + static_cast<size_t>(col) * static_cast<size_t>(pixel_size);
-
-      uint8_t red = 0;
-      uint8_t green = 0;
-      uint8_t blue = 0;
-
-      if (color_format == LV_COLOR_FORMAT_RGB565 || color_format == LV_COLOR_FORMAT_RGB565A8 ||
-          color_format == LV_COLOR_FORMAT_RGB565_SWAPPED) {
-        const uint16_t value =
-            static_cast<uint16_t>(pixel_ptr[0]) | (static_cast<uint16_t>(pixel_ptr[1]) << 8);
-        red = static_cast<uint8_t>(((value >> 11) & 0x1F) * 255 / 31);
-        green = static_cast<uint8_t>(((value >> 5) & 0x3F) * 255 / 63);
-        blue = static_cast<uint8_t>((value & 0x1F) * 255 / 31);
-      } else {
-        // Assume little-endian BGR[A].
-        blue = pixel_ptr[0];
-        if (pixel_size > 1) {
-          green = pixel_ptr[1];
-        }
-        if (pixel_size > 2) {
-          red = pixel_ptr[2];
-        }
-      }
-
-      const uint16_t luminance = static_cast<uint16_t>(red) * 30 +
-                                 static_cast<uint16_t>(green) * 59 +
-                                 static_cast<uint16_t>(blue) * 11;
-      const bool is_black = luminance < (128U * 100U);
-
-      const size_t dst_index = static_cast<size_t>(row) * static_cast<size_t>(aligned_width) +
-                               static_cast<size_t>(leading_padding + (width - 1 - col));
-      const size_t byte_index = dst_index / 8;
-      const uint8_t bit_mask = static_cast<uint8_t>(1U << (7 - (dst_index % 8)));
-
-      if (is_black) {
-        ctx->scratch[byte_index] &= static_cast<uint8_t>(~bit_mask);
-        ++black_pixels;
-      } else {
-        ctx->scratch[byte_index] |= bit_mask;
-      }
+    ctx->convert_us += esp_timer_get_time() - started;
+    if (result == ESP_OK) {
+      result = ctx->service->submitRegion(region);
+      buffer_queued = result == ESP_OK;
     }
   }
+  // buffer ที่ไม่ได้เข้าคิวต้องคืนเอง submitAbort() คืนเฉพาะ buffer ที่อยู่ในเฟรมแล้ว
+  if (!buffer_queued) {
+    ctx->service->releaseBuffer(buffer);
+  }
+
+  // flush สุดท้ายของเฟรม: สั่ง commit เข้าคิว task ของจออัปโหลดและ refresh ครั้งเดียว (UI ไม่รอจอ)
+  if (result == ESP_OK && lv_display_flush_is_last(disp)) {
+    result = ctx->service->submitCommit(epd::RefreshMode::kPartial);
+  }
 
-  // ส่งข้อมูลไปจอ โดย skip refresh ทุกครั้ง
-  // จะ refresh ครั้งเดียวหลังจากไม่มี flush มาสัก 200ms
-  const esp_err_t result = ctx->epd->drawBitmap(
-      static_cast<uint16_t>(aligned_x_start), static_cast<uint16_t>(y_start), ctx->scratch.data(),
-      static_cast<uint16_t>(aligned_width), static_cast<uint16_t>(height), true);  // skip_refresh = true
-  
   if (result != ESP_OK) {
-    ESP_LOGE(TAG, "drawBitmap failed: %s", esp_err_to_name(result));
-  } else {
-    ESP_LOGI(TAG, "flush done, black pixels: %u", static_cast<unsigned>(black_pixels));
+    ESP_LOGE(TAG, "frame update failed: %s", esp_err_to_name(result));
+    ctx->service->submitAbort();
+  } else if (!kPipelinedFlush) {
+    ESP_LOGD(TAG, "flush done, black pixels: %u", static_cast<unsigned>(black_pixels));
   }
 
-  lv_display_flush_ready(disp);
+  // strip ที่เข้าคิวแล้วจะปล่อย draw buffer ผ่าน flushWaitCallback เมื่อแปลงเสร็จ
+  if (!strip_queued) {
+    lv_display_flush_ready(disp);
+  }
 }
 
-void initLvgl(epd::Driver &epd_driver) {
+void initLvgl(epd::DisplayService &display_service) {
   lv_init();
+  if (!kPeriodicLvglTick) {
+    lv_tick_set_cb(lvglTickMs);
+  }
 
-  g_lvgl_ctx.epd = &epd_driver;
+  g_lvgl_ctx.service = &display_service;
+  g_lvgl_ctx.color_format = kLvglColorFormat;
   g_lvgl_display = lv_display_create(kDisplayWidth, kDisplayHeight);
-  lv_display_set_color_format(g_lvgl_display, kLvglColorFormat);
+  lv_display_set_color_format(g_lvgl_display, g_lvgl_ctx.color_format);
   lv_display_set_buffers(g_lvgl_display, g_lvgl_buf1, g_lvgl_buf2, kLvglBufferSize,
                          LV_DISPLAY_RENDER_MODE_PARTIAL);
   lv_display_set_user_data(g_lvgl_display, &g_lvgl_ctx);
   lv_display_set_flush_cb(g_lvgl_display, lvglFlushCallback);
+  if (kPipelinedFlush) {
+    g_flush_done = xSemaphoreCreateBinary();
+    display_service.setStripHandlers(convertStripCallback, stripDoneCallback, &g_lvgl_ctx);
+    lv_display_set_flush_wait_cb(g_lvgl_display, flushWaitCallback);
+  }
+  lv_display_add_event_cb(g_lvgl_display, renderEventCallback, LV_EVENT_RENDER_START, nullptr);
+  lv_display_add_event_cb(g_lvgl_display, renderEventCallback, LV_EVENT_RENDER_READY, nullptr);
+  lv_display_add_event_cb(g_lvgl_display, invalidateAreaCallback, LV_EVENT_INVALIDATE_AREA,
+                          nullptr);
   lv_display_set_default(g_lvgl_display);
 
-  // สำหรับ PARTIAL mode จะไม่รู้จำนวน flush ล่วงหน้า
-  // เราจะใช้วิธีรอ delay หลังจาก render เสร็จแทน
-  g_lvgl_ctx.flush_count = 0;
-  g_lvgl_ctx.expected_flushes = 0;
-
-  const esp_timer_create_args_t tick_timer_args = {
-      .callback = &lvglTickCallback,
-      .arg = nullptr,
-      .dispatch_method = ESP_TIMER_TASK,
-      .name = "lvgl_tick",
-      .skip_unhandled_events = false,
-  };
-  ESP_ERROR_CHECK(esp_timer_create(&tick_timer_args, &g_lvgl_tick_timer));
-  ESP_ERROR_CHECK(esp_timer_start_periodic(g_lvgl_tick_timer, 1000));
+  if (kPeriodicLvglTick) {
+    const esp_timer_create_args_t tick_timer_args = {
+        .callback = &lvglTickTimerCallback,
+        .arg = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "lvgl_tick",
+        .skip_unhandled_events = false,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&tick_timer_args, &g_lvgl_tick_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(g_lvgl_tick_timer, 1000));
+  }
 
   lv_obj_t *screen = lv_scr_act();
-  lv_obj_set_style_bg_color(screen, lv_color_white(), LV_PART_MAIN);
-  lv_obj_set_style_bg_opa(screen, LV_OPA_COVER, LV_PART_MAIN);
-
-  // g_lvgl_ctx.label = lv_label_create(screen);
-  // lv_obj_set_style_text_color(g_lvgl_ctx.label, lv_color_black(), LV_PART_MAIN);
-  // lv_obj_set_style_text_font(g_lvgl_ctx.label, &lv_font_montserrat_48, LV_PART_MAIN);
-  // lv_label_set_text(g_lvgl_ctx.label, kMessages[0]);
-  // lv_obj_center(g_lvgl_ctx.label);
-
-  constexpr lv_coord_t kScreenMargin = 16;
-  constexpr lv_coord_t kStatusBarHeight = 64;
-  constexpr lv_coord_t kTableGap = 16;
-  constexpr lv_coord_t kHeaderRowHeight = 60;
-  constexpr lv_coord_t kValueRowHeight = 80;   // ลดลงเพื่อให้มีพื้นที่สำหรับแถวที่ 4
-  constexpr lv_coord_t kUnitRowHeight = 50;    // แถวหน่วย
-  constexpr lv_coord_t kDividerThickness = 8;  // เพิ่มจาก 4 เป็น 8 px
-
-  const lv_coord_t content_width =
-      static_cast<lv_coord_t>(kDisplayWidth) - 2 * kScreenMargin;
-
-  g_lvgl_ctx.status_bar = lv_obj_create(screen);
-  lv_obj_set_size(g_lvgl_ctx.status_bar, content_width, kStatusBarHeight);
-  lv_obj_set_pos(g_lvgl_ctx.status_bar, kScreenMargin, kScreenMargin);
-  lv_obj_set_style_bg_opa(g_lvgl_ctx.status_bar, LV_OPA_TRANSP, LV_PART_MAIN);
-  lv_obj_set_style_border_color(g_lvgl_ctx.status_bar, lv_color_black(), LV_PART_MAIN);
-  lv_obj_set_style_border_width(g_lvgl_ctx.status_bar, 2, LV_PART_MAIN);
-  lv_obj_set_style_border_side(g_lvgl_ctx.status_bar, LV_BORDER_SIDE_BOTTOM, LV_PART_MAIN);
-  lv_obj_set_style_pad_all(g_lvgl_ctx.status_bar, 0, LV_PART_MAIN);
-
-  g_lvgl_ctx.status_temp_label = lv_label_create(g_lvgl_ctx.status_bar);
-  lv_obj_set_style_text_color(g_lvgl_ctx.status_temp_label, lv_color_black(), LV_PART_MAIN);
-  lv_obj_set_style_text_font(g_lvgl_ctx.status_temp_label, &lv_font_montserrat_24, LV_PART_MAIN);
-  lv_obj_set_style_text_align(g_lvgl_ctx.status_temp_label, LV_TEXT_ALIGN_LEFT, LV_PART_MAIN);
-  lv_label_set_text(g_lvgl_ctx.status_temp_label, "26.5C");
-  lv_obj_align(g_lvgl_ctx.status_temp_label, LV_ALIGN_LEFT_MID, 8, 0);
-
-  g_lvgl_ctx.status_humidity_label = lv_label_create(g_lvgl_ctx.status_bar);
-  lv_obj_set_style_text_color(g_lvgl_ctx.status_humidity_label, lv_color_black(), LV_PART_MAIN);
-  lv_obj_set_style_text_font(g_lvgl_ctx.status_humidity_label, &lv_font_montserrat_24,
-                             LV_PART_MAIN);
-  lv_obj_set_style_text_align(g_lvgl_ctx.status_humidity_label, LV_TEXT_ALIGN_RIGHT, LV_PART_MAIN);
-  lv_label_set_text(g_lvgl_ctx.status_humidity_label, "72%");
-  lv_obj_align(g_lvgl_ctx.status_humidity_label, LV_ALIGN_RIGHT_MID, -8, 0);
-
-  const lv_coord_t table_y = kScreenMargin + kStatusBarHeight + kTableGap;
-  const lv_coord_t table_height =
-      static_cast<lv_coord_t>(kDisplayHeight) - table_y - kScreenMargin;
-
-  g_lvgl_ctx.table_container = lv_obj_create(screen);
-  lv_obj_set_size(g_lvgl_ctx.table_container, content_width, table_height);
-  lv_obj_set_pos(g_lvgl_ctx.table_container, kScreenMargin, table_y);
-  lv_obj_set_style_bg_opa(g_lvgl_ctx.table_container, LV_OPA_TRANSP, LV_PART_MAIN);
-  lv_obj_set_style_border_color(g_lvgl_ctx.table_container, lv_color_black(), LV_PART_MAIN);
-  lv_obj_set_style_border_width(g_lvgl_ctx.table_container, 2, LV_PART_MAIN);
-  lv_obj_set_style_radius(g_lvgl_ctx.table_container, 0, LV_PART_MAIN);
-  lv_obj_set_style_pad_all(g_lvgl_ctx.table_container, 0, LV_PART_MAIN);
-  lv_obj_set_style_pad_row(g_lvgl_ctx.table_container, 0, LV_PART_MAIN);
-  lv_obj_set_style_pad_column(g_lvgl_ctx.table_container, 0, LV_PART_MAIN);
-
-  static lv_coord_t column_dsc[] = {LV_GRID_FR(1), LV_GRID_FR(1), LV_GRID_FR(1),
-                                    LV_GRID_TEMPLATE_LAST};
-  static lv_coord_t row_dsc[] = {
-      kHeaderRowHeight,      // แถวที่ 0: 60px (หัวตาราง: CO2, PM2.5, VOC)
-      kValueRowHeight,       // แถวที่ 1: 80px (ค่า: 741, 0, 105)
-      kUnitRowHeight,        // แถวที่ 2: 50px (หน่วย: ppm, ug/m3, NOx)
-      LV_GRID_FR(1),         // แถวที่ 3: ที่เหลือ (ว่าง, ว่าง, 105)
-      LV_GRID_TEMPLATE_LAST
-  };
-  lv_obj_set_layout(g_lvgl_ctx.table_container, LV_LAYOUT_GRID);
-  lv_obj_set_grid_dsc_array(g_lvgl_ctx.table_container, column_dsc, row_dsc);
-
-  const char *const headings[] = {"CO2", "PM2.5", "VOC"};
-  const char *const sample_values[] = {"741", "0", "105"};
-  const char *const units[] = {"ppm", "ug/m3", "NOx"};
-  const char *const nox_value = "105";
-
-  for (size_t i = 0; i < 3; ++i) {
-    // แถวที่ 0: หัวตาราง (CO2, PM2.5, VOC)
-    g_lvgl_ctx.table_headings[i] = lv_label_create(g_lvgl_ctx.table_container);
-    lv_obj_set_style_text_color(g_lvgl_ctx.table_headings[i], lv_color_black(), LV_PART_MAIN);
-    lv_obj_set_style_text_font(g_lvgl_ctx.table_headings[i], &lv_font_montserrat_24, LV_PART_MAIN);
-    lv_obj_set_style_text_align(g_lvgl_ctx.table_headings[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
-    lv_label_set_text(g_lvgl_ctx.table_headings[i], headings[i]);
-    lv_obj_set_grid_cell(g_lvgl_ctx.table_headings[i], LV_GRID_ALIGN_CENTER, i, 1,
-                         LV_GRID_ALIGN_CENTER, 0, 1);
-
-    // แถวที่ 1: ค่าหลัก (741, 0, 105)
-    g_lvgl_ctx.table_values[i] = lv_label_create(g_lvgl_ctx.table_container);
-    lv_obj_set_style_text_color(g_lvgl_ctx.table_values[i], lv_color_black(), LV_PART_MAIN);
-    lv_obj_set_style_text_font(g_lvgl_ctx.table_values[i], &lv_font_montserrat_48, LV_PART_MAIN);
-    lv_obj_set_style_text_align(g_lvgl_ctx.table_values[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
-    lv_label_set_text(g_lvgl_ctx.table_values[i], sample_values[i]);
-    lv_obj_set_grid_cell(g_lvgl_ctx.table_values[i], LV_GRID_ALIGN_CENTER, i, 1,
-                         LV_GRID_ALIGN_CENTER, 1, 1);
-
-    // แถวที่ 2: หน่วย (ppm, ug/m3, NOx)
-    g_lvgl_ctx.table_units[i] = lv_label_create(g_lvgl_ctx.table_container);
-    lv_obj_set_style_text_color(g_lvgl_ctx.table_units[i], lv_color_black(), LV_PART_MAIN);
-    lv_obj_set_style_text_font(g_lvgl_ctx.table_units[i], &lv_font_montserrat_20, LV_PART_MAIN);
-    lv_obj_set_style_text_align(g_lvgl_ctx.table_units[i], LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
-    lv_label_set_text(g_lvgl_ctx.table_units[i], units[i]);
-    lv_obj_set_grid_cell(g_lvgl_ctx.table_units[i], LV_GRID_ALIGN_CENTER, i, 1, 
-                         LV_GRID_ALIGN_CENTER, 2, 1);
-  }
-
-  // แถวที่ 3: เฉพาะคอลัมน์ที่ 3 (NOx value = 105)
-  g_lvgl_ctx.nox_value_label = lv_label_create(g_lvgl_ctx.table_container);
-  lv_obj_set_style_text_color(g_lvgl_ctx.nox_value_label, lv_color_black(), LV_PART_MAIN);
-  lv_obj_set_style_text_font(g_lvgl_ctx.nox_value_label, &lv_font_montserrat_48, LV_PART_MAIN);
-  lv_obj_set_style_text_align(g_lvgl_ctx.nox_value_label, LV_TEXT_ALIGN_CENTER, LV_PART_MAIN);
-  lv_label_set_text(g_lvgl_ctx.nox_value_label, nox_value);
-  lv_obj_set_grid_cell(g_lvgl_ctx.nox_value_label, LV_GRID_ALIGN_CENTER, 2, 1,  // คอลัมน์ที่ 2 (index 2)
-                       LV_GRID_ALIGN_CENTER, 3, 1);                                // แถวที่ 3 (index 3)
-
-
-  // วาดเส้นแบ่งหลังจากสร้าง labels เสร็จแล้ว
-  const lv_coord_t column_width = lv_obj_get_width(g_lvgl_ctx.table_container) / 3;
-  const lv_coord_t table_width = lv_obj_get_width(g_lvgl_ctx.table_container);
-  
-  ESP_LOGI(TAG, "Table container size: %dx%d", (int)table_width, (int)table_height);
-  ESP_LOGI(TAG, "Column width: %d", (int)column_width);
-  
-  // 3 เส้นแนวนอน สำหรับแบ่ง 4 แถว
-  const lv_coord_t horizontal_positions[] = {
-      kHeaderRowHeight,                                  // y = 60
-      kHeaderRowHeight + kValueRowHeight,                // y = 60 + 80 = 140
-      kHeaderRowHeight + kValueRowHeight + kUnitRowHeight // y = 60 + 80 + 50 = 190
-  };
+  const app::UiFootprint before = app::measureUi(screen);
+  app::createDashboard(screen, g_lvgl_ctx.ui, kTableImpl);
+  const app::UiFootprint after = app::measureUi(screen);
+  ESP_LOGI(TAG, "UI footprint: %u objects, %u bytes of LVGL heap (%s)",
+           static_cast<unsigned>(after.objects - before.objects),
+           static_cast<unsigned>(after.heap_used - before.heap_used),
+           kTableImpl == app::TableImpl::kSensorTable ? "sensor table widget" : "object tree");
+}
 
-  // ใช้ lv_line สำหรับวาดเส้นแนวตั้ง (ชัดเจนกว่า obj)
-  static lv_point_precise_t vertical_line1_points[] = {
-      {0, 0}, 
-      {0, 0}  // จะ set ใน runtime
-  };
-  static lv_point_precise_t vertical_line2_points[] = {
-      {0, 0}, 
-      {0, 0}
-  };
-  
-  // เส้นแนวตั้งที่ 1 (ระหว่าง CO2 กับ PM2.5)
-  vertical_line1_points[0].x = column_width;
-  vertical_line1_points[0].y = 0;
-  vertical_line1_points[1].x = column_width;
-  vertical_line1_points[1].y = table_height;
-  
-  lv_obj_t *vline1 = lv_line_create(g_lvgl_ctx.table_container);
-  lv_line_set_points(vline1, vertical_line1_points, 2);
-  lv_obj_set_style_line_width(vline1, kDividerThickness, LV_PART_MAIN);
-  lv_obj_set_style_line_color(vline1, lv_color_black(), LV_PART_MAIN);
-  lv_obj_add_flag(vline1, LV_OBJ_FLAG_IGNORE_LAYOUT);
-  lv_obj_move_foreground(vline1);
-  
-  ESP_LOGI(TAG, "Vertical line 1: x=%d, height=%d", (int)column_width, (int)table_height);
-  
-  // เส้นแนวตั้งที่ 2 (ระหว่าง PM2.5 กับ VOC)
-  vertical_line2_points[0].x = column_width * 2;
-  vertical_line2_points[0].y = 0;
-  vertical_line2_points[1].x = column_width * 2;
-  vertical_line2_points[1].y = table_height;
-  
-  lv_obj_t *vline2 = lv_line_create(g_lvgl_ctx.table_container);
-  lv_line_set_points(vline2, vertical_line2_points, 2);
-  lv_obj_set_style_line_width(vline2, kDividerThickness, LV_PART_MAIN);
-  lv_obj_set_style_line_color(vline2, lv_color_black(), LV_PART_MAIN);
-  lv_obj_add_flag(vline2, LV_OBJ_FLAG_IGNORE_LAYOUT);
-  lv_obj_move_foreground(vline2);
-  
-  ESP_LOGI(TAG, "Vertical line 2: x=%d, height=%d", (int)(column_width * 2), (int)table_height);
-  
-  // วาดเส้นแนวนอนด้วย obj ธรรมดา (เหมือนเดิม)
-  auto add_horizontal_divider = [](lv_obj_t *parent, lv_coord_t y, lv_coord_t width, lv_coord_t thickness) {
-    lv_obj_t *line = lv_obj_create(parent);
-    lv_obj_set_size(line, width, thickness);
-    lv_obj_set_pos(line, 0, y - thickness / 2);
-    lv_obj_set_style_bg_color(line, lv_color_black(), LV_PART_MAIN);
-    lv_obj_set_style_bg_opa(line, LV_OPA_COVER, LV_PART_MAIN);
-    lv_obj_set_style_border_width(line, 0, LV_PART_MAIN);
-    lv_obj_set_style_radius(line, 0, LV_PART_MAIN);
-    lv_obj_set_style_pad_all(line, 0, LV_PART_MAIN);
-    lv_obj_clear_flag(line, LV_OBJ_FLAG_SCROLLABLE);
-    lv_obj_add_flag(line, LV_OBJ_FLAG_IGNORE_LAYOUT);
-    lv_obj_move_foreground(line);
-    lv_obj_invalidate(line);
-  };
-  
-  // วาดเส้นแนวนอน 3 เส้น (แบ่ง 4 แถว)
-  for (lv_coord_t y : horizontal_positions) {
-    ESP_LOGI(TAG, "Drawing horizontal line at y=%d, width=%d", (int)y, (int)table_width);
-    add_horizontal_divider(g_lvgl_ctx.table_container, y, table_width, kDividerThickness);
+/** @brief อ่านอุณหภูมิจากเซ็นเซอร์ในจอ ถ้าอ่านไม่ได้จะใช้ waveform เดิมต่อไป */
+void readPanelTemperature(epd::Driver &driver) {
+  int celsius = 0;
+  const esp_err_t err = driver.readTemperature(celsius);
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Panel temperature read failed: %s", esp_err_to_name(err));
+    return;
   }
+  ESP_LOGI(TAG, "Panel temperature %d C", celsius);
 }
 
 } // namespace
 
+#if CONFIG_HEAP_USE_HOOKS
+/** @brief hook ของ heap: นับทุกการจอง (รวม bounce buffer ของ spi_master) ใช้ยืนยันว่าเฟรมไม่จอง */
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void *, size_t, uint32_t) {
+  g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void *) {}
+#endif
+
+/**
+ * @brief วาด widget คงที่ของ dashboard ครั้งเดียวลง base map แล้วเหลือแต่ label ค่าใน LVGL
+ *
+ * ซ่อน label ค่า วาดทั้งจอผ่าน flush เดิมลงภาพ 1 บิตเต็มจอ (แปลงด้วย packStrip() เหมือนเฟรม
+ * ปกติ) โหลดเป็น base map ด้วย full refresh แล้วลบ widget คงที่ออกจาก LVGL ภาพนี้ถูกเก็บไว้
+ * ทับลงทุก strip ที่ส่งหลังจากนี้ เรียกหลัง initLvgl() และก่อน display_service.start() เท่านั้น
+ * (ยังใช้ driver ได้โดยตรง)
+ */
+esp_err_t bakeStaticLayer(epd::Driver &driver) {
+  auto *frame = static_cast<uint8_t *>(heap_caps_malloc(epd::kBufferSize, MALLOC_CAP_DEFAULT));
+  auto *scratch =
+      static_cast<uint8_t *>(heap_caps_malloc(kServiceBufferBytes, MALLOC_CAP_DEFAULT));
+  if (frame == nullptr || scratch == nullptr) {
+    heap_caps_free(frame);
+    heap_caps_free(scratch);
+    return ESP_ERR_NO_MEM;
+  }
+  std::fill_n(frame, epd::kBufferSize, 0xFF);
+
+  const int64_t started = esp_timer_get_time();
+  app::setLiveLabelsHidden(g_lvgl_ctx.ui, true);
+  g_lvgl_ctx.capture_frame = frame;
+  g_lvgl_ctx.capture_scratch = scratch;
+  lv_obj_invalidate(lv_display_get_screen_active(g_lvgl_display));
+  lv_refr_now(g_lvgl_display);
+  g_lvgl_ctx.capture_frame = nullptr;
+  g_lvgl_ctx.capture_scratch = nullptr;
+  heap_caps_free(scratch);
+  const int64_t render_us = esp_timer_get_time() - started;
+
+  app::dropStaticWidgets(g_lvgl_display, g_lvgl_ctx.ui);
+  app::setLiveLabelsHidden(g_lvgl_ctx.ui, false);  // invalidate เฉพาะกล่องของ label ค่า
+  g_lvgl_ctx.static_layer = frame;
+  ESP_LOGI(TAG, "Static layer rendered in %lld us, loading as base map",
+           static_cast<long long>(render_us));
+  return driver.loadBaseMap(frame, true);
+}
+
+/**
+ * @brief เปิด FT6336 และ ISR ของขา INT ที่ปลุก main loop (kWakeInput) แม้อยู่ใน light sleep
+ *
+ * ถ้า controller ไม่ตอบหรือติดตั้ง ISR ไม่ได้ จะทำงานต่อโดยไม่มี touch (g_touch_ready = false)
+ */
+void initTouch() {
+  ft6336::Config touch_cfg;
+  touch_cfg.port = I2C_NUM_0;
+  touch_cfg.sda = kTouchSda;
+  touch_cfg.scl = kTouchScl;
+  touch_cfg.rst = kTouchRst;
+  touch_cfg.interrupt = kTouchInt;
+  esp_err_t err = g_touch.init(touch_cfg);
+  if (err == ESP_OK) {
+    err = gpio_set_intr_type(kTouchInt, GPIO_INTR_NEGEDGE);
+  }
+  if (err == ESP_OK) {
+    err = gpio_install_isr_service(0);  // ไดรเวอร์จอติดตั้งไว้แล้วจะได้ ESP_ERR_INVALID_STATE
+    if (err == ESP_ERR_INVALID_STATE) {
+      err = ESP_OK;
+    }
+  }
+  if (err == ESP_OK) {
+    err = gpio_isr_handler_add(kTouchInt, touchIsr, nullptr);
+  }
+  // ขอบของ GPIO ปลุกชิปจาก light sleep ไม่ได้ ต้องใช้ GPIO wakeup แบบ level
+  if (err == ESP_OK) {
+    err = gpio_wakeup_enable(kTouchInt, GPIO_INTR_LOW_LEVEL);
+  }
+  if (err == ESP_OK) {
+    err = esp_sleep_enable_gpio_wakeup();
+  }
+  if (err != ESP_OK) {
+    ESP_LOGW(TAG, "Touch disabled: %s", esp_err_to_name(err));
+    return;
+  }
+  g_touch_ready = true;
+  ESP_LOGI(TAG, "Touch ready, INT on GPIO %d wakes the main loop", static_cast<int>(kTouchInt));
+}
+
+/** @brief เริ่ม timer ที่บอก main loop ว่าค่าเซ็นเซอร์ชุดใหม่พร้อม (kWakeSensor) */
+void startSensorTimer() {
+  const esp_timer_create_args_t sensor_timer_args = {
+      .callback = &sensorTimerCallback,
+      .arg = nullptr,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "sensor",
+      .skip_unhandled_events = true,
+  };
+  ESP_ERROR_CHECK(esp_timer_create(&sensor_timer_args, &g_sensor_timer));
+  ESP_ERROR_CHECK(esp_timer_start_periodic(
+      g_sensor_timer, static_cast<uint64_t>(pdTICKS_TO_MS(kUpdateInterval)) * 1000));
+}
+
+/**
+ * @brief เปิด DFS และ automatic light sleep ของ ESP-IDF
+ *
+ * ต้องเปิด CONFIG_PM_ENABLE และ CONFIG_FREERTOS_USE_TICKLESS_IDLE (ดู sdkconfig.defaults)
+ * idle task จะหลับเมื่อทุก task รอนานกว่า CONFIG_FREERTOS_IDLE_TIME_BEFORE_SLEEP ส่วน SPI และ
+ * การรอขา BUSY ของไดรเวอร์ถือ PM lock ไว้ระหว่างทำงาน
+ */
+void configurePowerManagement() {
+#if CONFIG_PM_ENABLE
+  esp_pm_config_t pm_config = {};
+  pm_config.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+  pm_config.min_freq_mhz = CONFIG_XTAL_FREQ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  pm_config.light_sleep_enable = true;
+#endif
+  const esp_err_t result = esp_pm_configure(&pm_config);
+  if (result != ESP_OK) {
+    ESP_LOGW(TAG, "esp_pm_configure failed: %s", esp_err_to_name(result));
+    return;
+  }
+  ESP_LOGI(TAG, "Power management: %d-%d MHz, automatic light sleep %s", pm_config.max_freq_mhz,
+           pm_config.min_freq_mhz, pm_config.light_sleep_enable ? "on" : "off");
+#else
+  ESP_LOGI(TAG, "Power management disabled (CONFIG_PM_ENABLE not set)");
+#endif
+}
+
 /** @brief Application entry point created by ESP-IDF. */
 extern "C" void app_main(void) {
   epd::Config epd_cfg;
@@ -461,21 +709,39 @@ extern "C" void app_main(void) {
   epd_cfg.rst = GPIO_NUM_23;
   epd_cfg.busy = GPIO_NUM_20;
   epd_cfg.clk_speed_hz = 20 * 1000 * 1000;
+  epd_cfg.async_upload = true;
+  epd_cfg.shadow_framebuffer = true;  // ส่งเฉพาะไบต์ที่เปลี่ยนจากภาพที่อยู่บนจอ
+  epd_cfg.ghost_budget = 20;          // tile ที่ partial refresh ครบ 20 ครั้งจะถูกล้างตอนว่าง
+  epd_cfg.ghost_hard_budget = 60;     // ถ้าไม่ได้ล้างจนครบ 60 ครั้ง บังคับ full refresh
+  epd_cfg.read_temperature = true;    // ใช้ SDA แบบ 3-wire อ่านเซ็นเซอร์อุณหภูมิในจอ
 
   epd::Driver epd_driver;
 
   ESP_LOGI(TAG, "USB CDC support disabled");
 
+  configurePowerManagement();
+
   ESP_LOGI(TAG, "initialising peripherals");
   ESP_ERROR_CHECK(epd_driver.init(epd_cfg));
 
   ESP_LOGI(TAG, "display full refresh for clean start");
   ESP_ERROR_CHECK(epd_driver.hardwareInit(false));
+  readPanelTemperature(epd_driver);
   ESP_ERROR_CHECK(epd_driver.clear(0xFF));
   vTaskDelay(pdMS_TO_TICKS(1000));
 
   // ESP_ERROR_CHECK(epd_driver.hardwareInit(true));
-  ESP_ERROR_CHECK(epd_driver.loadBaseMap(WhileBG, true));
+  if (!kPrerenderStaticLayer) {
+    ESP_ERROR_CHECK(epd_driver.loadBaseMap(WhileBG, true));  // ไม่งั้น bakeStaticLayer() โหลดให้
+  }
+
+  if (kRunUploadBenchmark) {
+    ESP_ERROR_CHECK(epd::bench::runUploadBenchmark(epd_driver, epd_cfg, WhileBG));
+    ESP_ERROR_CHECK(epd::bench::runPartialSessionBenchmark(epd_driver, epd_cfg, WhileBG));
+    ESP_ERROR_CHECK(epd::bench::runGrayBenchmark(epd_driver, epd_cfg, WhileBG));
+    ESP_ERROR_CHECK(epd_driver.hardwareInit(false));
+    ESP_ERROR_CHECK(epd_driver.loadBaseMap(WhileBG, true));
+  }
 
   // initLvgl(epd_driver);
   // size_t message_index = 0;
@@ -495,45 +761,183 @@ extern "C" void app_main(void) {
   //   vTaskDelay(pdMS_TO_TICKS(50));
   // }
 
-  initLvgl(epd_driver);
+  epd_driver.setRefreshDoneCallback(refreshDoneCallback, nullptr);
+
+  // ตั้งแต่นี้ไป task ของจอเป็นผู้ใช้ driver คนเดียว; UI ส่งงานผ่านคิวและไม่ถูกบล็อกด้วย SPI/BUSY
+  epd::DisplayService display_service(epd_driver);
+  epd::ServiceConfig service_cfg;
+  service_cfg.buffer_bytes = kServiceBufferBytes;
+  ESP_ERROR_CHECK(display_service.init(service_cfg));
+  initLvgl(display_service);  // ติดตั้ง strip handler ก่อน task เริ่ม
+  if (kPrerenderStaticLayer) {
+    ESP_ERROR_CHECK(bakeStaticLayer(epd_driver));
+  }
+  ESP_ERROR_CHECK(display_service.start());
 
-  TickType_t last_refresh_check = xTaskGetTickCount();
   TickType_t last_update = xTaskGetTickCount();  // เวลาอัพเดทค่าล่าสุด
-  constexpr TickType_t kRefreshCheckInterval = pdMS_TO_TICKS(100);  // ตรวจสอบทุก 100ms
-  constexpr TickType_t kRefreshDelay = pdMS_TO_TICKS(200);          // รอ 200ms หลัง flush สุดท้าย
+  TickType_t last_temperature = last_update;     // เวลาอ่านอุณหภูมิล่าสุด
+  bool cleaning_queued = false;                  // ส่ง cleaning ไปแล้วในช่วงว่างนี้
+  int logged_temperature = display_service.temperature();
 
   // อัพเดทค่าเริ่มต้นครั้งแรก
   updateSensorValues();
 
+  // สถิติตอนว่าง: wakeup ของ main loop และ tick timer, เวลาที่ loop ทำงาน และเวลาของ idle task
+  g_main_task = xTaskGetCurrentTaskHandle();
+  int64_t idle_window_start = esp_timer_get_time();
+  int64_t idle_run_start = idleRunTimeUs();
+  int64_t loop_busy_us = 0;
+  uint32_t loop_wakeups = 0;
+  // ตื่นเพราะ notification ก่อนถึงกำหนด แยกตามเหตุ: refresh เสร็จ, แตะจอ, ค่าเซ็นเซอร์ใหม่
+  uint32_t refresh_wakeups = 0;
+  uint32_t input_wakeups = 0;
+  uint32_t sensor_wakeups = 0;
+  uint32_t wake_reasons = 0;  // บิต kWake* ของ notification ที่ปลุกรอบนี้
+  g_tick_timer_wakeups = 0;
+  initTouch();
+  startSensorTimer();
+
   while (true) {
-    lv_timer_handler();
-    
+    const int64_t woke_us = esp_timer_get_time();
+    ++loop_wakeups;
+    // flush สุดท้ายของแต่ละเฟรมจะ commit และเริ่ม refresh เอง ไม่ต้องเดาจากเวลาอีกต่อไป
+    // เปิด refresh timer คืนเมื่อพ้นช่วงขั้นต่ำนับจากเฟรมก่อน
     TickType_t now = xTaskGetTickCount();
-    
-    // อัพเดทค่าเซ็นเซอร์ทุก 5 วินาที
-    if (now - last_update >= kUpdateInterval) {
+    if (g_refresh_gated && now - g_refresh_gate_start >= kMinRefreshInterval) {
+      g_refresh_gated = false;
+      lv_timer_resume(lv_display_get_refr_timer(g_lvgl_display));
+    }
+
+    // แตะจอ: scan() อ่านจุดสัมผัส (ปล่อยขา INT) แล้วเปิด interrupt คืน แตะแล้วอ่านค่าใหม่ทันที
+    if ((wake_reasons & kWakeInput) != 0 && g_touch_ready) {
+      ft6336::TouchData touch;
+      if (g_touch.scan(touch) == ESP_OK && touch.count > 0) {
+        ESP_LOGI(TAG, "Touch at (%u,%u), publishing readings now",
+                 static_cast<unsigned>(touch.points[0].x),
+                 static_cast<unsigned>(touch.points[0].y));
+        wake_reasons |= kWakeSensor;
+      }
+      gpio_intr_enable(kTouchInt);
+    }
+
+    // ค่าเซ็นเซอร์ชุดใหม่ (timer ทุก 5 วินาทีหรือการแตะ) ส่งเข้า model ทันทีที่ตื่น
+    if ((wake_reasons & kWakeSensor) != 0) {
       last_update = now;
       updateSensorValues();
+      cleaning_queued = false;
       ESP_LOGI(TAG, "Sensor values updated");
     }
-    
-    // ตรวจสอบว่าควร refresh จอหรือไม่
-    if (now - last_refresh_check >= kRefreshCheckInterval) {
-      last_refresh_check = now;
-      
-      // ถ้ามี flush มาแล้ว และผ่านไป 200ms โดยไม่มี flush ใหม่
-      if (g_lvgl_ctx.last_flush_time > 0 && 
-          now - g_lvgl_ctx.last_flush_time >= kRefreshDelay) {
-        ESP_LOGI(TAG, "Triggering delayed refresh...");
-        
-        // เรียก triggerRefresh เพื่อ refresh จอด้วยข้อมูลที่อัพโหลดไปแล้ว
-        ESP_ERROR_CHECK(epd_driver.triggerRefresh());
-        
-        g_lvgl_ctx.last_flush_time = 0;  // รีเซ็ต
-        ESP_LOGI(TAG, "Refresh completed");
+    wake_reasons = 0;
+
+    // อ่านอุณหภูมิผ่านคิว คำสั่งจะรันต่อจากเฟรมที่ค้างอยู่ จึงไม่ชนกับ refresh
+    // ไดรเวอร์จะส่ง LUT ใหม่เฉพาะตอนเปลี่ยนช่วงอุณหภูมิ
+    if (now - last_temperature >= kTemperatureInterval) {
+      last_temperature = now;
+      display_service.submitReadTemperature();
+    }
+    if (display_service.temperature() != logged_temperature) {
+      logged_temperature = display_service.temperature();
+      ESP_LOGI(TAG, "Panel temperature %d C", logged_temperature);
+    }
+
+    // ล้างเงา (ghosting) ครั้งเดียวต่อช่วงว่าง; ถ้ายังไม่มี tile ไหนครบงบ service จะไม่ทำอะไร
+    if (!cleaning_queued && now - last_update >= kCleaningIdleDelay) {
+      cleaning_queued = true;
+      display_service.submitCleaning();
+    }
+
+    if (g_refresh_done.exchange(false)) {
+      const epd::ServiceStats stats = display_service.stats();
+      ESP_LOGI(TAG, "Refresh completed (%u/%u commands, %u errors, max queue %u, max buffers %u, "
+               "UI waited %lld us)",
+               static_cast<unsigned>(stats.executed), static_cast<unsigned>(stats.submitted),
+               static_cast<unsigned>(stats.errors), static_cast<unsigned>(stats.max_queue_depth),
+               static_cast<unsigned>(stats.max_buffers_in_use),
+               static_cast<long long>(stats.producer_wait_us));
+      // เวลาเฟรมตั้งแต่ LVGL เริ่ม render จนจอ refresh เสร็จ (cleaning refresh ไม่มีเฟรมจึงไม่นับ)
+      if (g_frame_started_us != 0) {
+        ESP_LOGI(TAG, "Frame time %lld us end-to-end, LVGL render+flush %lld us, convert %lld us "
+                 "(%s, %s flush, draw buffers %u bytes, %ld heap allocations, %u DMA bounces)",
+                 static_cast<long long>(g_refresh_done_us - g_frame_started_us),
+                 static_cast<long long>(g_render_us),
+                 static_cast<long long>(g_lvgl_ctx.convert_us.exchange(0)),
+                 kRenderI1 ? "I1" : "RGB565", kPipelinedFlush ? "pipelined" : "synchronous",
+                 static_cast<unsigned>(2 * kLvglBufferSize),
+                 static_cast<long>(
+                     static_cast<int32_t>(heapAllocationCount() - g_frame_heap_start)),
+                 static_cast<unsigned>(stats.dma_bounce_transfers - g_frame_bounce_start));
+        // พิกเซลที่ widget invalidate -> ที่ LVGL วาดหลังรวมพื้นที่ -> ที่ส่งลง 0x24 จริง
+        ESP_LOGI(TAG, "Dirty pixels: %llu invalidated, %llu rendered, %llu uploaded (%u areas)",
+                 static_cast<unsigned long long>(g_frame_invalidated_pixels),
+                 static_cast<unsigned long long>(g_lvgl_ctx.rendered_pixels),
+                 static_cast<unsigned long long>(
+                     (stats.partial_window_bytes - g_frame_upload_start) * 8),
+                 static_cast<unsigned>(g_frame_dirty_areas));
+        g_frame_started_us = 0;
+      }
+      // latency จาก lv_label_set_text ถึงจอเริ่ม refresh (รวมเวลาที่รอ kMinRefreshInterval)
+      if (g_frame_input_us != 0 && stats.last_refresh_start_us >= g_frame_input_us) {
+        ESP_LOGI(TAG, "Update latency %lld us (label set -> refresh start, min interval %u ms)",
+                 static_cast<long long>(stats.last_refresh_start_us - g_frame_input_us),
+                 static_cast<unsigned>(pdTICKS_TO_MS(kMinRefreshInterval)));
+        g_frame_input_us = 0;
       }
     }
-    
-    vTaskDelay(pdMS_TO_TICKS(50));
+
+    // LVGL ทำงานท้ายสุดเพื่อวาดสิ่งที่ขั้นบนเพิ่ง invalidate และบอกว่า timer ถัดไปครบเมื่อไร
+    // (LV_NO_TIMER_READY = ไม่มี timer ที่ทำงานอยู่ เช่นเมื่อไม่มีพื้นที่รอวาดและไม่มี animation)
+    const uint32_t lvgl_wait_ms = lv_timer_handler();
+    now = xTaskGetTickCount();
+    TickType_t wait = portMAX_DELAY;
+    if (lvgl_wait_ms != LV_NO_TIMER_READY) {
+      wait = (lvgl_wait_ms + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS;  // ปัดขึ้น
+    }
+    wait = std::min(wait, ticksUntil(now, last_temperature + kTemperatureInterval));
+    if (!cleaning_queued) {
+      wait = std::min(wait, ticksUntil(now, last_update + kCleaningIdleDelay));
+    }
+    if (g_refresh_gated) {
+      wait = std::min(wait, ticksUntil(now, g_refresh_gate_start + kMinRefreshInterval));
+    }
+
+    const int64_t loop_end_us = esp_timer_get_time();
+    loop_busy_us += loop_end_us - woke_us;
+    const int64_t window_us = loop_end_us - idle_window_start;
+    if (window_us >= kIdleStatsIntervalUs) {
+      const uint32_t tick_wakeups = g_tick_timer_wakeups.exchange(0);
+      const int64_t idle_run = idleRunTimeUs();
+      // idle % ต้องเปิด CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS (นับด้วย esp_timer เป็น µs)
+      const int idle_percent =
+          idle_run < 0 ? -1
+                       : static_cast<int>((idle_run - idle_run_start) * 100 / window_us);
+      ESP_LOGI(TAG, "Idle load: %lld wakeups/min (%lld loop: %lu refresh, %lu touch, %lu sensor; "
+               "%lld LVGL tick timer), loop busy %lld us/s, idle task %d%% (%s tick)",
+               static_cast<long long>((loop_wakeups + tick_wakeups) * 60000000LL / window_us),
+               static_cast<long long>(loop_wakeups * 60000000LL / window_us),
+               static_cast<unsigned long>(refresh_wakeups),
+               static_cast<unsigned long>(input_wakeups),
+               static_cast<unsigned long>(sensor_wakeups),
+               static_cast<long long>(tick_wakeups * 60000000LL / window_us),
+               static_cast<long long>(loop_busy_us * 1000000LL / window_us), idle_percent,
+               kPeriodicLvglTick ? "1 kHz esp_timer" : "esp_timer_get_time");
+#if CONFIG_PM_PROFILING
+      esp_pm_dump_locks(stdout);  // เวลาที่อยู่ในแต่ละโหมด (รวม light sleep) ไว้ประมาณกระแสเฉลี่ย
+#endif
+      idle_window_start = loop_end_us;
+      idle_run_start = idle_run;
+      loop_busy_us = 0;
+      loop_wakeups = 0;
+      refresh_wakeups = 0;
+      input_wakeups = 0;
+      sensor_wakeups = 0;
+    }
+
+    // หลับจนถึงกำหนดถัดไปหรือจนมี notification ระหว่างนี้ idle task ของ FreeRTOS เข้า light sleep
+    // ได้เอง (tickless idle + esp_pm) ถ้าไม่มี task อื่นทำงานและไม่มีใครถือ PM lock
+    if (xTaskNotifyWait(0, UINT32_MAX, &wake_reasons, wait) == pdTRUE) {
+      refresh_wakeups += (wake_reasons & kWakeRefreshDone) != 0 ? 1 : 0;
+      input_wakeups += (wake_reasons & kWakeInput) != 0 ? 1 : 0;
+      sensor_wakeups += (wake_reasons & kWakeSensor) != 0 ? 1 : 0;
+    }
   }
 }
@@ -0,0 +1,231 @@
+#include "sensor_table.h"
+
+#include <cstring>
+
+#include "src/core/lv_obj_class_private.h"
+#include "src/core/lv_obj_private.h"
+#include "src/misc/lv_area_private.h"
+
+namespace app {
+namespace {
+
+constexpr int32_t kBorderWidth = 2;
+constexpr int32_t kDividerThickness = 8;
+constexpr int32_t kColumns = 3;
+// ขอบบนของแต่ละแถวนับจากขอบใน: หัวตาราง 60, ค่า 80, หน่วย 50, ที่เหลือเป็นแถว NOx
+constexpr int32_t kRowTops[] = {0, 60, 140, 190};
+constexpr int32_t kRows = sizeof(kRowTops) / sizeof(kRowTops[0]);
+constexpr size_t kValueChars = 12;  // "-2147483648" + '\0'
+
+const char *const kHeadings[kColumns] = {"CO2", "PM2.5", "VOC"};
+const char *const kUnits[kColumns] = {"ppm", "ug/m3", "NOx"};
+
+/** @brief ตำแหน่ง (คอลัมน์, แถว) ของช่องค่า เรียงตาม SensorIndex */
+struct CellPosition {
+  int32_t column;
+  int32_t row;
+};
+constexpr CellPosition kValueCells[kSensorTableCells] = {{0, 1}, {1, 1}, {2, 1}, {2, 3}};
+
+/** @brief instance ของ widget: LVGL จองขนาด instance_size และเข้าถึงผ่าน lv_obj_t ตัวแรก */
+struct SensorTable {
+  lv_obj_t obj;
+  char values[kSensorTableCells][kValueChars];
+  bool values_hidden;
+  bool static_hidden;
+};
+
+/** @brief พื้นที่ภายในขอบของตาราง (พิกัดจอ) */
+lv_area_t contentArea(const lv_obj_t *obj) {
+  lv_area_t area;
+  lv_obj_get_coords(obj, &area);
+  lv_area_increase(&area, -kBorderWidth, -kBorderWidth);
+  return area;
+}
+
+/**
+ * @brief ขอบซ้ายของคอลัมน์ @p column นับจากขอบใน ปัดเศษแบบเดียวกับ LV_GRID_FR(1) ของ lv_grid
+ *
+ * lv_grid ให้แต่ละคอลัมน์ได้ความกว้างที่เหลือหารจำนวนคอลัมน์ที่เหลือ ปัดไปค่าใกล้สุด ตารางแบบ
+ * object tree จึงวาง label และเส้นแบ่งตรงกับ widget นี้ทุกพิกเซล
+ */
+int32_t columnStart(int32_t width, int32_t column) {
+  int32_t x = 0;
+  for (int32_t i = 0; i < column; ++i) {
+    const int32_t remaining = kColumns - i;
+    x += (width - x + remaining / 2) / remaining;
+  }
+  return x;
+}
+
+/** @brief ช่อง (@p column, @p row) ของ @p content */
+lv_area_t cellArea(const lv_area_t &content, int32_t column, int32_t row) {
+  const int32_t width = lv_area_get_width(&content);
+  lv_area_t area;
+  area.x1 = content.x1 + columnStart(width, column);
+  area.x2 = content.x1 + columnStart(width, column + 1) - 1;
+  area.y1 = content.y1 + kRowTops[row];
+  area.y2 = row + 1 < kRows ? content.y1 + kRowTops[row + 1] - 1 : content.y2;
+  return area;
+}
+
+/** @brief กรอบของ @p text เมื่อจัดกึ่งกลาง @p cell */
+lv_area_t textArea(const lv_font_t *font, const char *text, const lv_area_t &cell) {
+  lv_point_t size;
+  lv_text_get_size(&size, text, font, 0, 0, LV_COORD_MAX, LV_TEXT_FLAG_NONE);
+  lv_area_t area;
+  area.x1 = cell.x1 + (lv_area_get_width(&cell) - size.x) / 2;
+  area.y1 = cell.y1 + (lv_area_get_height(&cell) - size.y) / 2;
+  area.x2 = area.x1 + size.x - 1;
+  area.y2 = area.y1 + size.y - 1;
+  return area;
+}
+
+/** @brief กรอบข้อความของช่องค่า @p cell ตามข้อความปัจจุบัน */
+lv_area_t valueArea(const SensorTable &table, size_t cell) {
+  const CellPosition &position = kValueCells[cell];
+  return textArea(&lv_font_montserrat_48, table.values[cell],
+                  cellArea(contentArea(&table.obj), position.column, position.row));
+}
+
+void drawText(lv_layer_t *layer, const lv_font_t *font, const char *text, const lv_area_t &cell) {
+  const lv_area_t area = textArea(font, text, cell);
+  if (!lv_area_is_on(&area, &layer->_clip_area)) {
+    return;  // ไม่อยู่ใน strip ที่กำลังวาด
+  }
+  lv_draw_label_dsc_t label;
+  lv_draw_label_dsc_init(&label);
+  label.font = font;
+  label.color = lv_color_black();
+  label.text = text;
+  lv_draw_label(layer, &label, &area);
+}
+
+/** @brief วาดขอบ 4 ด้าน เส้นแบ่งแนวตั้ง 2 เส้น และแนวนอน 3 เส้นเป็นสี่เหลี่ยมทึบ */
+void drawRules(lv_layer_t *layer, const lv_obj_t *obj, const lv_area_t &content) {
+  lv_area_t coords;
+  lv_obj_get_coords(obj, &coords);
+  lv_area_t rules[4 + (kColumns - 1) + (kRows - 1)] = {
+      {coords.x1, coords.y1, coords.x2, content.y1 - 1},
+      {coords.x1, content.y2 + 1, coords.x2, coords.y2},
+      {coords.x1, content.y1, content.x1 - 1, content.y2},
+      {content.x2 + 1, content.y1, coords.x2, content.y2},
+  };
+  size_t count = 4;
+  constexpr int32_t kBefore = kDividerThickness / 2;
+  constexpr int32_t kAfter = kDividerThickness - kBefore - 1;
+  for (int32_t column = 1; column < kColumns; ++column) {
+    const int32_t x = cellArea(content, column, 0).x1;
+    rules[count++] = {x - kBefore, content.y1, x + kAfter, content.y2};
+  }
+  for (int32_t row = 1; row < kRows; ++row) {
+    const int32_t y = content.y1 + kRowTops[row];
+    rules[count++] = {content.x1, y - kBefore, content.x2, y + kAfter};
+  }
+
+  lv_draw_fill_dsc_t fill;
+  lv_draw_fill_dsc_init(&fill);
+  fill.color = lv_color_black();
+  for (const lv_area_t &rule : rules) {
+    if (lv_area_is_on(&rule, &layer->_clip_area)) {
+      lv_draw_fill(layer, &fill, &rule);
+    }
+  }
+}
+
+void drawSensorTable(const SensorTable &table, lv_layer_t *layer) {
+  const lv_area_t content = contentArea(&table.obj);
+  if (!table.static_hidden) {
+    drawRules(layer, &table.obj, content);
+    for (int32_t column = 0; column < kColumns; ++column) {
+      drawText(layer, &lv_font_montserrat_24, kHeadings[column], cellArea(content, column, 0));
+      drawText(layer, &lv_font_montserrat_20, kUnits[column], cellArea(content, column, 2));
+    }
+  }
+  if (!table.values_hidden) {
+    for (size_t cell = 0; cell < kSensorTableCells; ++cell) {
+      const CellPosition &position = kValueCells[cell];
+      drawText(layer, &lv_font_montserrat_48, table.values[cell],
+               cellArea(content, position.column, position.row));
+    }
+  }
+}
+
+void sensorTableConstructor(const lv_obj_class_t *, lv_obj_t *obj) {
+  lv_obj_remove_flag(obj, LV_OBJ_FLAG_SCROLLABLE);
+  lv_obj_remove_flag(obj, LV_OBJ_FLAG_CLICKABLE);
+}
+
+void sensorTableEvent(const lv_obj_class_t *class_p, lv_event_t *event) {
+  if (lv_obj_event_base(class_p, event) != LV_RESULT_OK) {
+    return;
+  }
+  if (lv_event_get_code(event) == LV_EVENT_DRAW_MAIN) {
+    const auto *table = reinterpret_cast<const SensorTable *>(lv_event_get_current_target(event));
+    drawSensorTable(*table, lv_event_get_layer(event));
+  }
+}
+
+const lv_obj_class_t kSensorTableClass = {
+    .base_class = &lv_obj_class,
+    .constructor_cb = sensorTableConstructor,
+    .destructor_cb = nullptr,
+    .event_cb = sensorTableEvent,
+    .user_data = nullptr,
+    .name = "sensor_table",
+    .width_def = LV_PCT(100),
+    .height_def = LV_PCT(100),
+    .editable = LV_OBJ_CLASS_EDITABLE_FALSE,
+    .group_def = LV_OBJ_CLASS_GROUP_DEF_FALSE,
+    .instance_size = sizeof(SensorTable),
+    .theme_inheritable = LV_OBJ_CLASS_THEME_INHERITABLE_FALSE,
+};
+
+SensorTable &tableOf(lv_obj_t *obj) {
+  LV_ASSERT_OBJ(obj, &kSensorTableClass);
+  return *reinterpret_cast<SensorTable *>(obj);
+}
+
+}  // namespace
+
+lv_obj_t *createSensorTable(lv_obj_t *parent) {
+  lv_obj_t *obj = lv_obj_class_create_obj(&kSensorTableClass, parent);
+  lv_obj_class_init_obj(obj);
+  return obj;
+}
+
+void setSensorTableValue(lv_obj_t *obj, size_t cell, const char *text) {
+  SensorTable &table = tableOf(obj);
+  if (cell >= kSensorTableCells || std::strncmp(table.values[cell], text, kValueChars) == 0) {
+    return;
+  }
+  const bool visible = !table.values_hidden;
+  if (visible) {
+    const lv_area_t old_area = valueArea(table, cell);
+    lv_obj_invalidate_area(obj, &old_area);
+  }
+  std::strncpy(table.values[cell], text, kValueChars - 1);
+  table.values[cell][kValueChars - 1] = '\0';
+  if (visible) {
+    const lv_area_t new_area = valueArea(table, cell);
+    lv_obj_invalidate_area(obj, &new_area);
+  }
+}
+
+void setSensorTableValuesHidden(lv_obj_t *obj, bool hidden) {
+  SensorTable &table = tableOf(obj);
+  if (table.values_hidden == hidden) {
+    return;
+  }
+  table.values_hidden = hidden;
+  for (size_t cell = 0; cell < kSensorTableCells; ++cell) {
+    const lv_area_t area = valueArea(table, cell);
+    lv_obj_invalidate_area(obj, &area);
+  }
+}
+
+void setSensorTableStaticHidden(lv_obj_t *obj, bool hidden) {
+  tableOf(obj).static_hidden = hidden;
+}
+
+}  // namespace app
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+#include "lvgl.h"
+
+namespace app {
+
+/** @brief จำนวนช่องค่าของตาราง เรียงตาม SensorIndex (CO2, PM2.5, VOC, NOx) */
+constexpr size_t kSensorTableCells = 4;
+
+/**
+ * @brief สร้าง widget ตารางค่าเซ็นเซอร์บน @p parent (class ของตัวเองที่สืบจาก lv_obj)
+ *
+ * ขอบ เส้นแบ่ง หัวตาราง หน่วย และค่าทั้ง 4 ช่องถูกวาดใน LV_EVENT_DRAW_MAIN รอบเดียวด้วย
+ * lv_draw_fill()/lv_draw_label() แทน container แบบ grid + label 10 ตัว + lv_line 2 + divider 3
+ * ที่ต่างมี local style ของตัวเอง ไม่มี child จึงไม่มี layout และ style lookup ต่อ object
+ * ผู้เรียกกำหนดตำแหน่ง/ขนาดเอง
+ */
+lv_obj_t *createSensorTable(lv_obj_t *parent);
+
+/**
+ * @brief ตั้งข้อความของช่องค่า @p cell (ไม่เกิน 11 ตัวอักษร)
+ *
+ * invalidate เฉพาะกรอบข้อความเดิมและใหม่ของช่องนั้น ข้อความเดิมซ้ำไม่ invalidate
+ */
+void setSensorTableValue(lv_obj_t *table, size_t cell, const char *text);
+
+/** @brief ซ่อน/แสดงค่าทุกช่อง (invalidate กรอบข้อความของทุกช่อง) */
+void setSensorTableValuesHidden(lv_obj_t *table, bool hidden);
+
+/**
+ * @brief หยุด/กลับมาวาดส่วนคงที่ (ขอบ, เส้นแบ่ง, หัวตาราง, หน่วย) ใช้หลังวาดส่วนนี้ลง base map แล้ว
+ *
+ * ไม่ invalidate: ผู้เรียกเลือกเองว่าจะให้ LVGL วาดพื้นที่นั้นใหม่หรือไม่
+ */
+void setSensorTableStaticHidden(lv_obj_t *table, bool hidden);
+
+}  // namespace app
@@ -0,0 +1,142 @@
+#include "strip_pack.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace app {
+namespace {
+
+/** @brief ตารางกลับลำดับบิตในไบต์ ใช้กลับด้าน strip แบบ I1 ทีละไบต์ */
+constexpr auto kReverseBits = [] {
+  std::array<uint8_t, 256> table{};
+  for (unsigned value = 0; value < 256; ++value) {
+    unsigned reversed = 0;
+    for (unsigned bit = 0; bit < 8; ++bit) {
+      reversed |= ((value >> bit) & 1U) << (7 - bit);
+    }
+    table[value] = static_cast<uint8_t>(reversed);
+  }
+  return table;
+}();
+
+}  // namespace
+
+size_t stripBytes(int32_t x_start, int32_t width, int32_t height) {
+  const int32_t aligned_width = (ramX(x_start, width) % 8 + width + 7) / 8 * 8;
+  return static_cast<size_t>(aligned_width) / 8 * static_cast<size_t>(height);
+}
+
+esp_err_t packStrip(const epd::Strip &strip, lv_color_format_t color_format, epd::Dither dither,
+                    uint8_t *buffer, size_t buffer_bytes, epd::Region &region,
+                    size_t &black_pixels, epd::ErrorDiffusion *diffusion) {
+  // ตำแหน่งใน RAM: pixel col ของ strip ลงที่ ram_x + (width - 1 - col)
+  const int32_t ram_x = ramX(strip.x, strip.width);
+  const int32_t aligned_x_start = ram_x - (ram_x % 8);
+  const int32_t leading_padding = ram_x - aligned_x_start;
+  const int32_t aligned_width = (leading_padding + strip.width + 7) / 8 * 8;
+  const size_t strip_bytes = stripBytes(strip.x, strip.width, strip.height);
+  if (strip_bytes > buffer_bytes) {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  region.x = static_cast<uint16_t>(aligned_x_start);
+  region.y = static_cast<uint16_t>(strip.y);
+  region.width = static_cast<uint16_t>(aligned_width);
+  region.height = static_cast<uint16_t>(strip.height);
+  region.data = buffer;
+  black_pixels = 0;
+
+  // I1: LVGL ปัดพื้นที่ให้ชิดขอบ 8 พิกเซลแล้ว (window ใน RAM จึงชิดขอบ 8 ด้วยเพราะ
+  // kRamColumns หาร 8 ลงตัว) และ bit 1 = ขาวเหมือน RAM ของจอ จึงเหลือแค่กลับลำดับไบต์ในแถว
+  // และกลับบิตในไบต์
+  if (color_format == LV_COLOR_FORMAT_I1) {
+    if (leading_padding != 0 || strip.width % 8 != 0) {
+      return ESP_ERR_INVALID_ARG;
+    }
+    const size_t row_bytes = static_cast<size_t>(strip.width) / 8;
+    for (int32_t row = 0; row < strip.height; ++row) {
+      const uint8_t *src = strip.pixels + static_cast<size_t>(row) * strip.stride;
+      uint8_t *dst = buffer + static_cast<size_t>(row) * row_bytes;
+      for (size_t i = 0; i < row_bytes; ++i) {
+        dst[i] = kReverseBits[src[row_bytes - 1 - i]];
+      }
+    }
+    return ESP_OK;
+  }
+
+  std::fill_n(buffer, strip_bytes, 0xFF);
+
+  // RGB565: ใช้ kernel ตาราง (ขาว/ดำหรือ dither ตาม @p dither) ที่ประกอบทีละ 32 พิกเซลต่อการเขียน
+  // แบบกลับด้าน
+  if (color_format == LV_COLOR_FORMAT_RGB565 || color_format == LV_COLOR_FORMAT_RGB565A8 ||
+      color_format == LV_COLOR_FORMAT_RGB565_SWAPPED) {
+    const size_t row_bytes = static_cast<size_t>(aligned_width) / 8;
+    size_t white_bits = 0;
+    for (int32_t row = 0; row < strip.height; ++row) {
+      uint8_t *dst = buffer + static_cast<size_t>(row) * row_bytes;
+      epd::ditherRgb565Row<true>(dither, strip.pixels + static_cast<size_t>(row) * strip.stride,
+                                 static_cast<size_t>(strip.width), strip.x, strip.y + row, dst,
+                                 static_cast<unsigned>(leading_padding), diffusion);
+      for (size_t i = 0; i < row_bytes; ++i) {
+        white_bits += static_cast<size_t>(std::popcount(dst[i]));
+      }
+    }
+    black_pixels = strip_bytes * 8 - white_bits;  // padding เป็นสีขาวจึงไม่ถูกนับ
+    return ESP_OK;
+  }
+
+  const uint32_t pixel_size = lv_color_format_get_size(color_format);
+  for (int32_t row = 0; row < strip.height; ++row) {
+    const uint8_t *row_ptr = strip.pixels + static_cast<size_t>(row) * strip.stride;
+
+    for (int32_t col = 0; col < strip.width; ++col) {
+      const uint8_t *pixel_ptr =
+          row_ptr + static_cast<size_t>(col) * static_cast<size_t>(pixel_size);
+
+      // Assume little-endian BGR[A].
+      const uint8_t blue = pixel_ptr[0];
+      const uint8_t green = pixel_size > 1 ? pixel_ptr[1] : 0;
+      const uint8_t red = pixel_size > 2 ? pixel_ptr[2] : 0;
+
+      const uint16_t luminance = static_cast<uint16_t>(red) * 30 +
+                                 static_cast<uint16_t>(green) * 59 +
+                                 static_cast<uint16_t>(blue) * 11;
+      const bool is_black = luminance < (128U * 100U);
+
+      const size_t dst_index = static_cast<size_t>(row) * static_cast<size_t>(aligned_width) +
+                               static_cast<size_t>(leading_padding + (strip.width - 1 - col));
+      const size_t byte_index = dst_index / 8;
+      const uint8_t bit_mask = static_cast<uint8_t>(1U << (7 - (dst_index % 8)));
+
+      if (is_black) {
+        buffer[byte_index] &= static_cast<uint8_t>(~bit_mask);
+        ++black_pixels;
+      } else {
+        buffer[byte_index] |= bit_mask;
+      }
+    }
+  }
+  return ESP_OK;
+}
+
+void blitRegion(const epd::Region &region, uint8_t *frame) {
+  const size_t row_bytes = region.width / 8;
+  const size_t stride = region.stride != 0 ? region.stride : row_bytes;
+  for (size_t row = 0; row < region.height; ++row) {
+    std::copy_n(region.data + row * stride, row_bytes,
+                frame + (region.y + row) * kFrameStride + region.x / 8);
+  }
+}
+
+void overlayStaticLayer(const epd::Region &region, uint8_t *buffer, const uint8_t *layer) {
+  const size_t row_bytes = region.width / 8;
+  for (size_t row = 0; row < region.height; ++row) {
+    uint8_t *dst = buffer + row * row_bytes;
+    const uint8_t *src = layer + (region.y + row) * kFrameStride + region.x / 8;
+    for (size_t i = 0; i < row_bytes; ++i) {
+      dst[i] &= src[i];
+    }
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "esp_err.h"
+
+#include "display_service.h"
+#include "epd_driver.h"
+#include "lvgl.h"
+#include "pixel_convert.h"
+
+namespace app {
+
+/**
+ * @brief x แรกใน RAM ของจอของพื้นที่ LVGL [@p x, @p x + @p width)
+ *
+ * จอกลับด้านแนวนอนเทียบกับพิกัด LVGL ทั้งจอ (x ของ LVGL = kRamColumns - 1 - x ของ RAM) window
+ * จึงต้องกลับตำแหน่งด้วย ไม่ใช่แค่กลับเนื้อหาภายใน window
+ */
+constexpr int32_t ramX(int32_t x, int32_t width) { return epd::kRamColumns - x - width; }
+
+/** @brief ขนาด strip 1 บิตของพื้นที่ LVGL หลังขยาย window ใน RAM ให้ชิดขอบ 8 พิกเซล */
+size_t stripBytes(int32_t x_start, int32_t width, int32_t height);
+
+/**
+ * @brief แปลง strip จาก LVGL เป็น 1 บิตลง buffer (กลับด้านทั้งตำแหน่งและเนื้อหา ดู ramX())
+ *        แล้วเติม region ที่พร้อมส่ง
+ *
+ * เรียกได้ทั้งจาก flush callback และจาก task ของจอ (โหมด pipeline) จึงไม่แตะ state ของ LVGL
+ * @p diffusion เก็บ error ของ Floyd-Steinberg ข้าม strip จึงต้องเรียกจาก task เดียวตามลำดับ strip
+ */
+esp_err_t packStrip(const epd::Strip &strip, lv_color_format_t color_format, epd::Dither dither,
+                    uint8_t *buffer, size_t buffer_bytes, epd::Region &region,
+                    size_t &black_pixels, epd::ErrorDiffusion *diffusion);
+
+/** @brief ไบต์ต่อแถวของภาพเต็มจอแบบเดียวกับ RAM ของจอ (รูปแบบของ loadBaseMap()) */
+constexpr size_t kFrameStride = epd::kRamColumns / 8;
+
+/** @brief คัดลอก region ที่ packStrip() สร้างลงตำแหน่งเดียวกันในภาพเต็มจอ @p frame */
+void blitRegion(const epd::Region &region, uint8_t *frame);
+
+/**
+ * @brief ทับ layer คงที่ลงใน region ที่เพิ่งแปลง: พิกเซลดำของ @p layer ชนะเสมอ (AND เพราะ 1 = ขาว)
+ *
+ * @p buffer คือข้อมูลของ @p region (แถวละ width / 8 ไบต์) และ @p layer เป็นภาพเต็มจอ
+ * แบบ loadBaseMap() label ที่วาดบนพื้นโปร่งใสจึงไม่ลบเส้นตารางแม้ DirtyTracker รวมกล่องข้ามเส้น
+ */
+void overlayStaticLayer(const epd::Region &region, uint8_t *buffer, const uint8_t *layer);
+
+}  // namespace app